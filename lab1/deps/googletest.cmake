@@ -0,0 +1,17 @@
+find_package(GTest QUIET)
+
+if (NOT GTest_FOUND)
+    message(STATUS "GoogleTest not found, downloading from source...")
+
+    include(FetchContent)
+    FetchContent_Declare(
+            googletest
+            GIT_REPOSITORY https://github.com/google/googletest.git
+            GIT_TAG v1.14.0
+    )
+
+    set(INSTALL_GTEST OFF CACHE BOOL "" FORCE)
+    FetchContent_MakeAvailable(googletest)
+else()
+    message(STATUS "GoogleTest was found in system!")
+endif()
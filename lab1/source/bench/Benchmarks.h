@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+#include "ChurnGenerator.h"
+
+struct PipelineBenchOptions {
+    ChurnGenerator::Options churn;
+    std::chrono::milliseconds coalesceWindow{0};
+    /// Значение ключа watcher.dispatch_threads конфига
+    std::size_t dispatchThreads = 0;
+    /// Значения ключей trace.file и trace.sample_every конфига, пустой файл - без трассировки
+    std::filesystem::path traceFile;
+    std::uint64_t traceEvery = 100;
+    /// Значения ключей logging.mode и logging.level конфига
+    std::string logMode = "file";
+    std::string logLevel = "info";
+};
+
+/// Весь конвейер DirectoriesWatcher -> EventCoalescer -> DiskMonitor в одном процессе под нагрузкой ChurnGenerator
+int runPipelineBench(const PipelineBenchOptions &options);
+
+/// Пропускная способность очередей сообщений: несколько производителей, один потребитель, как в DiskMonitor
+int runQueueBench(std::size_t messagesPerProducer);
+
+/// Стоимость рассылки сообщений через Subject, в том числе через почтовые ящики, и разбора через std::visit
+int runDispatchBench(std::size_t messages);
+
+/// Стоимость вызова логгера в каждом режиме
+int runLoggerBench(std::size_t messages);
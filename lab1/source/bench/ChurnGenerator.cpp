@@ -0,0 +1,94 @@
+#include "ChurnGenerator.h"
+
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+ChurnGenerator::ChurnGenerator(Options options) : m_options{std::move(options)} {
+}
+
+void ChurnGenerator::prepare() const {
+    for (std::size_t directory = 0; directory < m_options.directories; ++directory) {
+        std::filesystem::create_directories(filePath(directory, 0).parent_path());
+        for (std::size_t file = 0; file < m_options.filesPerDirectory; file += 2) {
+            if (const int fd = open(filePath(directory, file).c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644); fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+}
+
+ChurnGenerator::Result ChurnGenerator::run() const {
+    Result result;
+    if (m_options.directories == 0 || m_options.filesPerDirectory == 0) {
+        return result;
+    }
+
+    // Пути строятся заранее, чтобы генератор не тратил время на форматирование
+    std::vector<std::string> paths;
+    paths.reserve(m_options.directories * m_options.filesPerDirectory);
+    for (std::size_t directory = 0; directory < m_options.directories; ++directory) {
+        for (std::size_t file = 0; file < m_options.filesPerDirectory; ++file) {
+            paths.push_back(filePath(directory, file).string());
+        }
+    }
+
+    std::mt19937_64 random{m_options.seed};
+    std::uniform_int_distribution<std::size_t> pathDistribution{0, paths.size() - 1};
+    std::discrete_distribution<int> actionDistribution{
+        static_cast<double>(m_options.createWeight),
+        static_cast<double>(m_options.modifyWeight),
+        static_cast<double>(m_options.deleteWeight),
+    };
+    static constexpr char PAYLOAD[] = "disk_monitor_bench payload\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + m_options.duration;
+    const std::size_t burst = std::max<std::size_t>(m_options.burst, 1);
+
+    for (std::uint64_t operations = 0;;) {
+        for (std::size_t i = 0; i < burst; ++i, ++operations) {
+            const auto &path = paths[pathDistribution(random)];
+            switch (actionDistribution(random)) {
+                case 0:
+                    if (const int fd = open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644); fd >= 0) {
+                        close(fd);
+                        ++result.creates;
+                    }
+                    break;
+                case 1:
+                    if (const int fd = open(path.c_str(), O_WRONLY | O_APPEND); fd >= 0) {
+                        if (write(fd, PAYLOAD, sizeof(PAYLOAD) - 1) > 0) {
+                            ++result.modifies;
+                        }
+                        close(fd);
+                    }
+                    break;
+                default:
+                    if (unlink(path.c_str()) == 0) {
+                        ++result.deletes;
+                    }
+                    break;
+            }
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        if (m_options.rate > 0) {
+            const auto due = start + std::chrono::nanoseconds{operations * 1'000'000'000 / m_options.rate};
+            if (due > now) {
+                std::this_thread::sleep_until(std::min(due, deadline));
+            }
+        }
+    }
+    return result;
+}
+
+std::filesystem::path ChurnGenerator::filePath(const std::size_t directory, const std::size_t file) const {
+    return m_options.root / ("d" + std::to_string(directory)) / ("f" + std::to_string(file));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+/// Синтетическая нагрузка на файловую систему: создание, изменение и удаление файлов в дереве директорий
+class ChurnGenerator {
+public:
+    struct Options {
+        /// Корень, под которым создаются директории d0..dN-1
+        std::filesystem::path root;
+        std::size_t directories = 16;
+        /// Сколько имён файлов используется в каждой директории
+        std::size_t filesPerDirectory = 256;
+        /// Доли операций создания, изменения и удаления
+        unsigned createWeight = 1;
+        unsigned modifyWeight = 2;
+        unsigned deleteWeight = 1;
+        /// Операций в секунду, 0 - без ограничения
+        std::uint64_t rate = 0;
+        /// Сколько операций выполняется подряд без пауз. 1 - равномерная нагрузка
+        std::size_t burst = 1;
+        std::chrono::milliseconds duration{5000};
+        std::uint64_t seed = 1;
+    };
+
+    struct Result {
+        std::uint64_t creates = 0;
+        std::uint64_t modifies = 0;
+        std::uint64_t deletes = 0;
+
+        [[nodiscard]] std::uint64_t total() const { return creates + modifies + deletes; }
+    };
+
+    explicit ChurnGenerator(Options options);
+
+    /// Создаёт директории и заполняет половину имён файлами, чтобы изменять и удалять было что
+    void prepare() const;
+
+    Result run() const;
+
+private:
+    [[nodiscard]] std::filesystem::path filePath(std::size_t directory, std::size_t file) const;
+
+    Options m_options;
+};
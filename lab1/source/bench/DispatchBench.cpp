@@ -0,0 +1,110 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Observer/Message.h"
+#include "Observer/Observer.h"
+#include "Observer/Subject.h"
+
+namespace {
+    /// Разбирает сообщения так же, как DiskMonitor::handleMessage
+    class CountingObserver : public Observer {
+    public:
+        void put(const Message &message) override {
+            std::visit(Overloaded{
+                           [this](const FileChangedInd &fileChangedInd) { m_events += fileChangedInd.count; },
+                           [this](const ReloadConfigRequest &) { ++m_control; },
+                           [this](const StopRequest &) { ++m_control; },
+                       }, message);
+        }
+
+        [[nodiscard]] std::uint64_t events() const { return m_events; }
+
+    private:
+        std::uint64_t m_events = 0;
+        std::uint64_t m_control = 0;
+    };
+
+    /// Наблюдатель с заметной работой на каждое сообщение, как ContentFilter или журнал
+    class BusyObserver : public CountingObserver {
+    public:
+        void put(const Message &message) override {
+            if (const auto *fileChangedInd = std::get_if<FileChangedInd>(&message)) {
+                for (int i = 0; i < 16; ++i) {
+                    m_hash ^= std::hash<std::string_view>{}(fileChangedInd->fileName()) + i;
+                }
+            }
+            CountingObserver::put(message);
+        }
+
+    private:
+        std::size_t m_hash = 0;
+    };
+
+    class BenchSubject : public Subject<> {
+    };
+
+    template<typename Body>
+    void measure(const std::string &name, const std::size_t messages, Body body) {
+        const auto start = std::chrono::steady_clock::now();
+        const std::uint64_t events = body();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << name << ": " << seconds * 1e9 / static_cast<double>(messages) << " ns/msg"
+                << (events == messages ? "" : " (lost messages)") << std::endl;
+    }
+}
+
+int runDispatchBench(const std::size_t messages) {
+    constexpr std::size_t BATCH = 1024;
+    const std::vector<Message> batch(BATCH, Message{FileChangedInd{0, "file.txt", FileChangedInd::Action::MODIFIED}});
+
+    measure("std::visit", messages, [&] {
+        CountingObserver observer;
+        for (std::size_t i = 0; i < messages; ++i) {
+            observer.put(batch[i % BATCH]);
+        }
+        return observer.events();
+    });
+
+    measure("Subject::notify (single)", messages, [&] {
+        CountingObserver observer;
+        BenchSubject subject;
+        subject.attach(&observer);
+        for (std::size_t i = 0; i < messages; ++i) {
+            subject.notify(batch[i % BATCH]);
+        }
+        return observer.events();
+    });
+
+    measure("Subject::notify (batch)", messages, [&] {
+        CountingObserver observer;
+        BenchSubject subject;
+        subject.attach(&observer);
+        for (std::size_t i = 0; i < messages; i += BATCH) {
+            subject.notify(std::span{batch}.first(std::min(BATCH, messages - i)));
+        }
+        return observer.events();
+    });
+
+    // Время производителя и доставки двум наблюдателям: по очереди в его потоке или параллельно из ящиков
+    for (const std::size_t threads: {0, 2}) {
+        measure(threads ? "Subject::notify (2 busy observers, mailboxes)" : "Subject::notify (2 busy observers)",
+                messages, [&] {
+                    BusyObserver first, second;
+                    {
+                        BenchSubject subject;
+                        subject.attach(&first);
+                        subject.attach(&second);
+                        subject.setDispatch(threads, 1 << 14);
+                        for (std::size_t i = 0; i < messages; i += BATCH) {
+                            subject.notify(std::span{batch}.first(std::min(BATCH, messages - i)));
+                        }
+                    }
+                    return std::min(first.events(), second.events());
+                });
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,46 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "Benchmarks.h"
+#include "Logger/SystemLogger.h"
+
+namespace {
+    void measure(const std::string &name, const std::size_t messages, const SystemLogger::LogLevel level) {
+        auto &logger = SystemLogger::instance();
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < messages; ++i) {
+            logger.log(level, SystemLogger::LOCAL0, "{} {} {} in directory {}",
+                       "Modified", "file", "file.txt", "/tmp/disk_monitor_bench");
+        }
+        const auto logged = std::chrono::steady_clock::now();
+        logger.flush();
+        const auto flushed = std::chrono::steady_clock::now();
+
+        std::cout << name << ": " << std::chrono::duration<double, std::nano>(logged - start).count()
+                / static_cast<double>(messages) << " ns/call, "
+                << std::chrono::duration<double, std::nano>(flushed - start).count()
+                / static_cast<double>(messages) << " ns/msg including flush" << std::endl;
+    }
+}
+
+int runLoggerBench(const std::size_t messages) {
+    const auto logFile = std::filesystem::temp_directory_path() / "disk_monitor_bench.log";
+    SystemLogger::create("disk_monitor_bench");
+    auto &logger = SystemLogger::instance();
+
+    logger.configure(SystemLogger::Mode::SYNC, SystemLogger::INFO);
+    measure("Filtered out (sync)", messages, SystemLogger::DEBUG);
+    measure("syslog (sync)", messages, SystemLogger::INFO);
+
+    logger.configure(SystemLogger::Mode::ASYNC_SYSLOG, SystemLogger::INFO);
+    measure("syslog (async)", messages, SystemLogger::INFO);
+
+    logger.configure(SystemLogger::Mode::ASYNC_FILE, SystemLogger::INFO, logFile);
+    measure("File (async)", messages, SystemLogger::INFO);
+
+    SystemLogger::destroy();
+    std::filesystem::remove(logFile);
+    return EXIT_SUCCESS;
+}
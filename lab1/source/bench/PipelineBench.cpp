@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Benchmarks.h"
+#include "Coalescer/EventCoalescer.h"
+#include "Content/ContentFilter.h"
+#include "Config/ConfigFileWatcher.h"
+#include "Config/YamlConfigLoader.h"
+#include "Daemon/DiskMonitor.h"
+#include "DirectoriesWatcher/DirectoriesWatcher.h"
+#include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Paths/DirectoryRegistry.h"
+#include "Reactor/MainReactor.h"
+#include "Snapshot/SnapshotIndex.h"
+#include "Trace/EventTrace.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    struct MetricsSample {
+        std::uint64_t eventsRead;
+        std::uint64_t eventsHandled;
+        std::uint64_t overflows;
+        std::int64_t droppedOldest;
+        std::int64_t droppedNewest;
+        LatencyHistogram::Snapshot endToEnd;
+        LatencyHistogram::Snapshot queueWait;
+    };
+
+    MetricsSample sample() {
+        const auto &metrics = Metrics::instance();
+        return {
+            metrics.eventsRead.value(), metrics.eventsHandled.value(), metrics.inotifyOverflows.value(),
+            metrics.queueDroppedOldest.value(), metrics.queueDroppedNewest.value(),
+            metrics.snapshot(Metrics::Stage::END_TO_END), metrics.snapshot(Metrics::Stage::QUEUE_WAIT),
+        };
+    }
+
+    LatencyHistogram::Snapshot difference(const LatencyHistogram::Snapshot &after,
+                                          const LatencyHistogram::Snapshot &before) {
+        LatencyHistogram::Snapshot result;
+        for (std::size_t i = 0; i < result.buckets.size(); ++i) {
+            result.buckets[i] = after.buckets[i] - before.buckets[i];
+        }
+        result.count = after.count - before.count;
+        result.sum = after.sum - before.sum;
+        return result;
+    }
+
+    double cpuSeconds() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)
+               + static_cast<double>(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    void printLatency(const char *name, const LatencyHistogram::Snapshot &snapshot) {
+        std::cout << name << " latency, us: p50 " << static_cast<double>(snapshot.quantile(0.5)) / 1e3
+                << ", p99 " << static_cast<double>(snapshot.quantile(0.99)) / 1e3
+                << ", p999 " << static_cast<double>(snapshot.quantile(0.999)) / 1e3 << std::endl;
+    }
+
+    void writeConfig(const std::filesystem::path &path, const PipelineBenchOptions &options) {
+        std::ofstream config{path};
+        config << "coalesce_window_ms: " << options.coalesceWindow.count() << "\n"
+                << "logging:\n"
+                << "  mode: " << options.logMode << "\n"
+                << "  level: " << options.logLevel << "\n"
+                << "  file: " << (options.churn.root.parent_path() / "events.log").string() << "\n"
+                << "directories:\n"
+                << "  - path: " << options.churn.root.string() << "\n"
+                << "    recursive: true\n"
+                << "watcher:\n"
+                << "  dispatch_threads: " << options.dispatchThreads << "\n";
+        if (!options.traceFile.empty()) {
+            config << "trace:\n"
+                    << "  file: " << options.traceFile.string() << "\n"
+                    << "  sample_every: " << options.traceEvery << "\n";
+        }
+    }
+
+    /// Генератор работает в дочернем процессе, чтобы его процессорное время не попало в замер конвейера.
+    /// Процесс ждёт байт из startFd и возвращает результат через resultFd
+    pid_t forkGenerator(const ChurnGenerator &generator, int &startFd, int &resultFd) {
+        int startPipe[2];
+        int resultPipe[2];
+        if (pipe(startPipe) < 0 || pipe(resultPipe) < 0) {
+            std::cerr << "pipe failed: " << strerror(errno) << std::endl;
+            return -1;
+        }
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << "fork failed: " << strerror(errno) << std::endl;
+            return -1;
+        }
+        if (pid == 0) {
+            close(startPipe[1]);
+            close(resultPipe[0]);
+            char start;
+            if (read(startPipe[0], &start, 1) == 1) {
+                const auto result = generator.run();
+                if (write(resultPipe[1], &result, sizeof(result)) < 0) {
+                    _exit(EXIT_FAILURE);
+                }
+            }
+            _exit(EXIT_SUCCESS);
+        }
+
+        close(startPipe[0]);
+        close(resultPipe[1]);
+        startFd = startPipe[1];
+        resultFd = resultPipe[0];
+        return pid;
+    }
+
+    /// Ждёт, пока DiskMonitor не начнёт получать события из только что настроенных наблюдений
+    bool waitForWatches(const std::filesystem::path &root) {
+        const auto probe = root / "probe";
+        const auto deadline = std::chrono::steady_clock::now() + 10s;
+        while (Metrics::instance().eventsHandled.value() == 0) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            if (const int fd = open(probe.c_str(), O_CREAT | O_WRONLY, 0644); fd >= 0) {
+                close(fd);
+            }
+            unlink(probe.c_str());
+            std::this_thread::sleep_for(10ms);
+        }
+        // Даём дочитать события пробного файла, чтобы они не попали в замер
+        std::this_thread::sleep_for(100ms);
+        return true;
+    }
+
+    /// Время, когда DiskMonitor обработал последнее событие: счётчик не меняется в течение quiet
+    std::chrono::steady_clock::time_point waitForDrain(const std::chrono::milliseconds quiet) {
+        auto handled = Metrics::instance().eventsHandled.value();
+        auto lastChange = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - lastChange < quiet) {
+            std::this_thread::sleep_for(5ms);
+            if (const auto current = Metrics::instance().eventsHandled.value(); current != handled) {
+                handled = current;
+                lastChange = std::chrono::steady_clock::now();
+            }
+        }
+        return lastChange;
+    }
+}
+
+int runPipelineBench(const PipelineBenchOptions &options) {
+    const auto workDirectory = options.churn.root.parent_path();
+    const ChurnGenerator generator{options.churn};
+    generator.prepare();
+    const auto configPath = workDirectory / "bench.yaml";
+    writeConfig(configPath, options);
+
+    int startFd = -1;
+    int resultFd = -1;
+    const pid_t generatorPid = forkGenerator(generator, startFd, resultFd);
+    if (generatorPid < 0) {
+        return EXIT_FAILURE;
+    }
+
+    const std::string name = "disk_monitor_bench";
+    SystemLogger::create(name);
+    DirectoryRegistry::create();
+    Metrics::create();
+    EventTrace::create();
+    SnapshotIndex::create();
+    DiskMonitor::create(name, configPath, std::make_shared<YamlConfigLoader>(), true);
+    std::thread monitorThread{[] {
+        DiskMonitor::instance().run([] {
+            MainReactor::create();
+            DirectoriesWatcher::create();
+            EventCoalescer::create();
+            ContentFilter::create();
+            ConfigFileWatcher::create();
+            DirectoriesWatcher::instance().attach(&EventCoalescer::instance());
+            EventCoalescer::instance().attach(&ContentFilter::instance());
+            ContentFilter::instance().attach(&DiskMonitor::instance());
+            ConfigFileWatcher::instance().attach(&DiskMonitor::instance());
+            DiskMonitor::instance().put(ReloadConfigRequest{});
+        });
+    }};
+
+    int status = EXIT_SUCCESS;
+    if (waitForWatches(options.churn.root)) {
+        const auto before = sample();
+        const double cpuBefore = cpuSeconds();
+        const auto start = std::chrono::steady_clock::now();
+
+        ChurnGenerator::Result churn;
+        if (write(startFd, "s", 1) != 1 || read(resultFd, &churn, sizeof(churn)) != sizeof(churn)) {
+            std::cerr << "Churn generator failed" << std::endl;
+        }
+        const auto end = waitForDrain(500ms);
+        const double cpu = cpuSeconds() - cpuBefore;
+        const auto after = sample();
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const auto handled = after.eventsHandled - before.eventsHandled;
+        std::cout << "File operations: " << churn.total() << " (" << churn.creates << " created, "
+                << churn.modifies << " modified, " << churn.deletes << " deleted)\n"
+                << "Events read: " << after.eventsRead - before.eventsRead
+                << ", handled: " << handled << ", in " << seconds << " s\n"
+                << "Sustained throughput: " << static_cast<std::uint64_t>(static_cast<double>(handled) / seconds)
+                << " events/s\n"
+                << "Kernel queue overflows: " << after.overflows - before.overflows
+                << ", dropped from monitor queue: " << after.droppedOldest - before.droppedOldest
+                + after.droppedNewest - before.droppedNewest << "\n"
+                << "CPU per event: " << (handled ? cpu / static_cast<double>(handled) * 1e6 : 0.0) << " us"
+                << std::endl;
+        printLatency("End-to-end", difference(after.endToEnd, before.endToEnd));
+        printLatency("Queue wait", difference(after.queueWait, before.queueWait));
+    } else {
+        std::cerr << "Watches were not set up in time" << std::endl;
+        status = EXIT_FAILURE;
+    }
+
+    close(startFd);
+    close(resultFd);
+    waitpid(generatorPid, nullptr, 0);
+
+    DiskMonitor::instance().put(StopRequest{});
+    monitorThread.join();
+    ConfigFileWatcher::destroy();
+    DirectoriesWatcher::destroy();
+    EventCoalescer::destroy();
+    ContentFilter::destroy();
+    MainReactor::destroy();
+    DiskMonitor::destroy();
+    SnapshotIndex::destroy();
+    EventTrace::destroy();
+    Metrics::destroy();
+    DirectoryRegistry::destroy();
+    SystemLogger::destroy();
+    return status;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmarks.h"
+#include "Observer/Message.h"
+#include "Queue/MpscRingQueue.h"
+#include "Queue/ThreadSafeQueue.h"
+
+namespace {
+    struct Result {
+        double seconds;
+        std::size_t messages;
+    };
+
+    template<typename Push, typename Pop>
+    Result run(const std::size_t producers, const std::size_t messagesPerProducer, Push push, Pop pop) {
+        const Message message{FileChangedInd{0, "file.txt", FileChangedInd::Action::MODIFIED}};
+        const std::size_t total = producers * messagesPerProducer;
+
+        const auto start = std::chrono::steady_clock::now();
+        std::thread consumer{[&] { pop(total); }};
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < producers; ++i) {
+            threads.emplace_back([&] {
+                for (std::size_t j = 0; j < messagesPerProducer; ++j) {
+                    push(message);
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        consumer.join();
+
+        return {std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), total};
+    }
+
+    void print(const std::string &name, const std::size_t producers, const Result &result) {
+        std::cout << name << ", producers: " << producers << ", "
+                << static_cast<std::size_t>(result.messages / result.seconds) << " msg/s" << std::endl;
+    }
+}
+
+int runQueueBench(const std::size_t messagesPerProducer) {
+    for (const std::size_t producers: {1, 2, 4, 8}) {
+        ThreadSafeQueue<Message> mutexQueue;
+        print("ThreadSafeQueue", producers, run(producers, messagesPerProducer,
+                                                [&](const Message &message) { mutexQueue.push(message); },
+                                                [&](const std::size_t total) {
+                                                    for (std::size_t i = 0; i < total; ++i) {
+                                                        mutexQueue.pop();
+                                                    }
+                                                }));
+
+        MpscRingQueue<Message> ringQueue{1 << 16};
+        print("MpscRingQueue", producers, run(producers, messagesPerProducer,
+                                              [&](const Message &message) { ringQueue.push(message); },
+                                              [&](const std::size_t total) {
+                                                  for (std::size_t i = 0; i < total; ++i) {
+                                                      ringQueue.pop();
+                                                  }
+                                              }));
+
+        MpscRingQueue<Message> batchQueue{1 << 16};
+        print("MpscRingQueue (batch pop)", producers, run(producers, messagesPerProducer,
+                                                          [&](const Message &message) { batchQueue.push(message); },
+                                                          [&](const std::size_t total) {
+                                                              std::vector<Message> batch;
+                                                              for (std::size_t i = 0; i < total;) {
+                                                                  batch.clear();
+                                                                  i += batchQueue.popBatch(batch, 1024);
+                                                              }
+                                                          }));
+    }
+
+    return EXIT_SUCCESS;
+}
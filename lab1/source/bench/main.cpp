@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+#include "Benchmarks.h"
+
+namespace {
+    void printUsage(const char *program) {
+        std::cerr << "Usage:\n"
+                << "  " << program << " pipeline [--root DIR] [--duration SECONDS] [--rate OPS] [--burst OPS]\n"
+                << "      [--dirs N] [--files N] [--mix CREATE:MODIFY:DELETE] [--coalesce-ms MS]\n"
+                << "      [--dispatch-threads N] [--trace FILE] [--trace-every N]\n"
+                << "      [--log-mode sync|syslog|file] [--log-level debug|info|warning|error]\n"
+                << "  " << program << " queue [MESSAGES_PER_PRODUCER]\n"
+                << "  " << program << " dispatch [MESSAGES]\n"
+                << "  " << program << " logger [MESSAGES]\n"
+                << "--root should be on tmpfs, /dev/shm by default. --rate 0 means as fast as possible" << std::endl;
+    }
+
+    bool parseMix(const std::string &value, ChurnGenerator::Options &churn) {
+        if (std::sscanf(value.c_str(), "%u:%u:%u", &churn.createWeight, &churn.modifyWeight,
+                        &churn.deleteWeight) != 3) {
+            return false;
+        }
+        return churn.createWeight + churn.modifyWeight + churn.deleteWeight > 0;
+    }
+
+    int pipeline(const int argc, char *argv[]) {
+        PipelineBenchOptions options;
+        std::filesystem::path root = "/dev/shm";
+
+        for (int i = 2; i < argc; i += 2) {
+            const std::string option = argv[i];
+            if (i + 1 >= argc) {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            const std::string value = argv[i + 1];
+            try {
+                if (option == "--root") {
+                    root = value;
+                } else if (option == "--duration") {
+                    options.churn.duration = std::chrono::milliseconds{
+                        static_cast<std::int64_t>(std::stod(value) * 1000)
+                    };
+                } else if (option == "--rate") {
+                    options.churn.rate = std::stoull(value);
+                } else if (option == "--burst") {
+                    options.churn.burst = std::stoull(value);
+                } else if (option == "--dirs") {
+                    options.churn.directories = std::stoull(value);
+                } else if (option == "--files") {
+                    options.churn.filesPerDirectory = std::stoull(value);
+                } else if (option == "--mix") {
+                    if (!parseMix(value, options.churn)) {
+                        throw std::invalid_argument{value};
+                    }
+                } else if (option == "--coalesce-ms") {
+                    options.coalesceWindow = std::chrono::milliseconds{std::stoll(value)};
+                } else if (option == "--dispatch-threads") {
+                    options.dispatchThreads = std::stoull(value);
+                } else if (option == "--trace") {
+                    options.traceFile = value;
+                } else if (option == "--trace-every") {
+                    options.traceEvery = std::stoull(value);
+                } else if (option == "--log-mode") {
+                    options.logMode = value;
+                } else if (option == "--log-level") {
+                    options.logLevel = value;
+                } else {
+                    printUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+            } catch (const std::exception &) {
+                std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::string workTemplate = (root / "disk_monitor_bench.XXXXXX").string();
+        if (!mkdtemp(workTemplate.data())) {
+            std::cerr << "Cannot create work directory in " << root.string() << std::endl;
+            return EXIT_FAILURE;
+        }
+        const std::filesystem::path workDirectory = workTemplate;
+        options.churn.root = workDirectory / "tree";
+
+        const int status = runPipelineBench(options);
+        std::filesystem::remove_all(workDirectory);
+        return status;
+    }
+
+    std::size_t count(const int argc, char *argv[], const std::size_t defaultCount) {
+        return argc > 2 ? std::stoull(argv[2]) : defaultCount;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string command = argv[1];
+    if (command == "pipeline") {
+        return pipeline(argc, argv);
+    }
+    if (command == "queue") {
+        return runQueueBench(count(argc, argv, 1'000'000));
+    }
+    if (command == "dispatch") {
+        return runDispatchBench(count(argc, argv, 10'000'000));
+    }
+    if (command == "logger") {
+        return runLoggerBench(count(argc, argv, 100'000));
+    }
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,196 @@
+#include "EventCoalescer.h"
+
+#include <algorithm>
+
+#include "Logger/SystemLogger.h"
+#include "Reactor/MainReactor.h"
+
+using namespace std::chrono_literals;
+
+EventCoalescer::EventCoalescer() : m_flushTimer{MainReactor::instance().addTimer([this] { flush(); })} {
+}
+
+EventCoalescer::~EventCoalescer() {
+    MainReactor::instance().removeTimer(m_flushTimer);
+}
+
+void EventCoalescer::setWindow(const std::chrono::milliseconds window) {
+    {
+        std::lock_guard lock{m_mutex};
+        m_window = window;
+        armFlush();
+    }
+    SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Event coalescing window set to {} ms",
+                                 window.count());
+}
+
+void EventCoalescer::put(const Message &message) {
+    put(std::span{&message, 1});
+}
+
+void EventCoalescer::put(const std::span<const Message> messages) {
+    std::lock_guard deliveryLock{m_deliveryMutex};
+    std::unique_lock lock{m_mutex};
+    // После уменьшения окна до нуля ожидающие события ещё не разосланы, новые встают за ними
+    if (m_window == 0ms && m_pending.empty()) {
+        lock.unlock();
+        notify(messages);
+        return;
+    }
+
+    const bool wasEmpty = m_pending.empty();
+    const auto now = Clock::now();
+    for (const auto &message: messages) {
+        if (const auto *event = std::get_if<FileChangedInd>(&message)) {
+            merge(*event, now);
+            if (m_pending.size() >= MAX_PENDING_EVENTS) {
+                takeExpired(now, MAX_PENDING_EVENTS / 2);
+            }
+            continue;
+        }
+        // Управляющие сообщения не задерживаются, но уходят после всех событий до них: иначе, например,
+        // StopRequest остановил бы DiskMonitor раньше, чем до него дошли ожидающие события
+        takeExpired(now, 0);
+        m_expired.push_back(message);
+    }
+    if (wasEmpty || !m_expired.empty()) {
+        armFlush();
+    }
+    lock.unlock();
+    deliverExpired();
+}
+
+std::optional<FileChangedInd::Action> EventCoalescer::merge(const std::optional<FileChangedInd::Action> current,
+                                                            const FileChangedInd::Action next) {
+    using Action = FileChangedInd::Action;
+    if (!current) {
+        return next;
+    }
+    const bool removed = next == Action::DELETED || next == Action::MOVED_OUT;
+    switch (*current) {
+        case Action::CREATED:
+        case Action::MOVED_IN:
+            // Файл появился и исчез в пределах окна - наружу ничего не уходит
+            return removed ? std::nullopt : current;
+        case Action::DELETED:
+        case Action::MOVED_OUT:
+            // Файл удалён и создан заново - для наблюдателя это изменение
+            return removed ? current : std::optional{Action::MODIFIED};
+        case Action::MODIFIED:
+        case Action::CLOSE_WRITE:
+        case Action::ATTRIB:
+            if (removed) {
+                return next;
+            }
+            // Из изменений остаётся самое содержательное: атрибуты < содержимое < законченная запись
+            return rank(next) > rank(*current) ? next : *current;
+        case Action::RENAMED:
+            // Переименования не объединяются, см. merge(event, now)
+            break;
+    }
+    return next;
+}
+
+int EventCoalescer::rank(const FileChangedInd::Action action) {
+    switch (action) {
+        case FileChangedInd::Action::ATTRIB:
+            return 0;
+        case FileChangedInd::Action::MODIFIED:
+            return 1;
+        default:
+            return 2;
+    }
+}
+
+void EventCoalescer::merge(const FileChangedInd &event, const Clock::time_point now) {
+    if (event.action == FileChangedInd::Action::RENAMED) {
+        mergeRename(event, now);
+        return;
+    }
+
+    if (const auto it = m_pendingIndexes.find(Key{event.directoryId, event.fileName()});
+        it != m_pendingIndexes.end()) {
+        auto &pending = m_pending[it->second - m_pendingOffset];
+        const auto action = merge(pending.alive ? std::optional{pending.event.action} : std::nullopt, event.action);
+        pending.alive = action.has_value();
+        if (action) {
+            pending.event.action = *action;
+        }
+        pending.event.count += event.count;
+        return;
+    }
+
+    auto &pending = m_pending.emplace_back(Pending{event, true, now});
+    m_pendingIndexes.emplace(Key{event.directoryId, pending.event.fileName()}, m_pendingOffset + m_pending.size() - 1);
+}
+
+void EventCoalescer::mergeRename(const FileChangedInd &event, const Clock::time_point now) {
+    const auto previous = m_pendingIndexes.find(Key{event.previousDirectoryId, event.previousName()});
+    if (previous != m_pendingIndexes.end()) {
+        auto &pending = m_pending[previous->second - m_pendingOffset];
+        const bool created = pending.alive && (pending.event.action == FileChangedInd::Action::CREATED ||
+                                               pending.event.action == FileChangedInd::Action::MOVED_IN);
+        m_pendingIndexes.erase(previous);
+        if (created) {
+            // Файл создан, записан и переименован в пределах окна (атомарная запись через временный файл):
+            // наблюдатель видит только появление файла под новым именем
+            pending.alive = false;
+            FileChangedInd appeared{event.directoryId, event.fileName(), pending.event.action,
+                                    pending.event.count + event.count, pending.event.timestampNs};
+            merge(appeared, now);
+            return;
+        }
+    }
+
+    // Ожидающие события о новом имени относятся к файлу, который переименование заменило:
+    // они уходят как есть, а переименование - отдельной записью, к которой ничего не присоединяется
+    m_pendingIndexes.erase(Key{event.directoryId, event.fileName()});
+    m_pending.emplace_back(Pending{event, true, now});
+}
+
+void EventCoalescer::takeExpired(const Clock::time_point now, const std::size_t keep) {
+    while (!m_pending.empty() && (m_pending.size() > keep || now - m_pending.front().firstSeen >= m_window)) {
+        const auto &pending = m_pending.front();
+        // Ключ мог уже указывать на более позднюю запись, если эту отцепило переименование
+        if (const auto it = m_pendingIndexes.find(Key{pending.event.directoryId, pending.event.fileName()});
+            it != m_pendingIndexes.end() && it->second == m_pendingOffset) {
+            m_pendingIndexes.erase(it);
+        }
+        if (pending.alive) {
+            m_expired.emplace_back(pending.event);
+        }
+        m_pending.pop_front();
+        ++m_pendingOffset;
+    }
+
+    if (m_pending.empty()) {
+        m_pendingOffset = 0;
+    }
+}
+
+void EventCoalescer::armFlush() {
+    if (m_pending.empty()) {
+        Reactor::armTimer(m_flushTimer, {});
+        return;
+    }
+    // Нулевая задержка остановила бы таймер, а окно уже могло истечь
+    const auto delay = m_pending.front().firstSeen + m_window - Clock::now();
+    Reactor::armTimer(m_flushTimer, std::max<std::chrono::nanoseconds>(delay, 1ns));
+}
+
+void EventCoalescer::flush() {
+    std::lock_guard deliveryLock{m_deliveryMutex};
+    {
+        std::lock_guard lock{m_mutex};
+        takeExpired(Clock::now());
+        armFlush();
+    }
+    deliverExpired();
+}
+
+void EventCoalescer::deliverExpired() {
+    if (!m_expired.empty()) {
+        notify(std::span<const Message>{m_expired});
+        m_expired.clear();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Observer/Message.h"
+#include "Observer/Observer.h"
+#include "Observer/Subject.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Промежуточная стадия между DirectoriesWatcher и потребителями. Повторные события об одном файле
+/// в пределах окна объединяются в одно с итоговым действием и счётчиком исходных событий.
+/// При нулевом окне события пропускаются без изменений. Окна закрываются по таймеру MainReactor, а раньше срока -
+/// при переполнении ожидающих и перед управляющим сообщением, которое уходит дальше после всех событий до него
+class EventCoalescer : public Observer, public Subject<>, public OnceInstantiated<EventCoalescer> {
+    friend class OnceInstantiated;
+
+public:
+    ~EventCoalescer() override;
+
+    void put(const Message &message) override;
+
+    void put(std::span<const Message> messages) override;
+
+    /// Ожидающие окна закрываются уже по новому окну, после уменьшения до нуля - сразу. Новые события до этого
+    /// встают за ними, а не обгоняют их
+    void setWindow(std::chrono::milliseconds window);
+
+    /// Итоговое действие после next в том же окне, nullopt - файл появился и исчез, наружу ничего не уходит.
+    /// current nullopt - событий в окне ещё не было. RENAMED сюда не попадает, переименования объединяются отдельно
+    static std::optional<FileChangedInd::Action> merge(std::optional<FileChangedInd::Action> current,
+                                                       FileChangedInd::Action next);
+
+protected:
+    EventCoalescer();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Сверх этого самые старые окна закрываются досрочно, до половины
+    static constexpr std::size_t MAX_PENDING_EVENTS = 1 << 16;
+
+    struct Pending {
+        FileChangedInd event;
+        /// false, если события взаимно уничтожились (например, CREATED + DELETED)
+        bool alive;
+        Clock::time_point firstSeen;
+    };
+
+    struct Key {
+        std::uint32_t directoryId;
+        /// Указывает на имя внутри элемента m_pending: элементы deque не перемещаются
+        std::string_view fileName;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const {
+            return std::hash<std::string_view>{}(key.fileName) ^ (std::size_t{key.directoryId} * 0x9e3779b97f4a7c15);
+        }
+    };
+
+    /// Порядок значимости изменений без появления и исчезновения файла
+    static int rank(FileChangedInd::Action action);
+
+    void merge(const FileChangedInd &event, Clock::time_point now);
+
+    void mergeRename(const FileChangedInd &event, Clock::time_point now);
+
+    /// Рассылает события с истёкшим окном. Вызывается таймером на потоке MainReactor
+    void flush();
+
+    /// Переносит в m_expired истёкшие окна, а также самые старые, пока ожидающих больше keep. Вызывать под m_mutex
+    void takeExpired(Clock::time_point now, std::size_t keep = SIZE_MAX);
+
+    /// Рассылает m_expired. Вызывать под m_deliveryMutex без m_mutex
+    void deliverExpired();
+
+    /// Взводит таймер на конец самого старого окна или останавливает его. Вызывать под m_mutex
+    void armFlush();
+
+    /// Захвачен, пока события забираются из m_pending и рассылаются: иначе поток таймера и put могли бы
+    /// разослать их не в том порядке. Берётся раньше m_mutex
+    std::mutex m_deliveryMutex;
+    std::mutex m_mutex;
+    int m_flushTimer = -1;
+    std::chrono::milliseconds m_window{0};
+
+    /// Значение - порядковый номер в m_pending с учётом m_pendingOffset
+    std::unordered_map<Key, std::size_t, KeyHash> m_pendingIndexes;
+    /// Ожидающие события в порядке появления: окна истекают в том же порядке
+    std::deque<Pending> m_pending;
+    std::size_t m_pendingOffset = 0;
+    /// Под m_deliveryMutex
+    std::vector<Message> m_expired;
+};
@@ -1,7 +1,142 @@
 #pragma once
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <vector>
 
+#include "Filter/NameFilter.h"
+#include "Logger/SystemLogger.h"
+#include "Queue/MpscRingQueue.h"
+#include "Subscription/SubscriptionServer.h"
+
+struct FilterConfig {
+    std::vector<NameFilter::Pattern> include;
+    std::vector<NameFilter::Pattern> exclude;
+
+    bool operator==(const FilterConfig &) const = default;
+};
+
+struct DirectoryConfig {
+    std::filesystem::path path;
+    /// Следить также за всеми поддиректориями, включая созданные после запуска
+    bool recursive = false;
+    /// Пропускать MODIFIED, только если содержимое файла изменилось
+    bool hashContent = false;
+    FilterConfig filter;
+    /// Скомпилированные правила filter, nullptr - правил нет
+    std::shared_ptr<const NameFilter> nameFilter;
+};
+
+struct LoggingConfig {
+    SystemLogger::Mode mode = SystemLogger::Mode::SYNC;
+    Logger::LogLevel level = Logger::INFO;
+    /// Файл событий для режима ASYNC_FILE
+    std::filesystem::path file = "/var/log/disk_monitor.log";
+    /// Писать файл событий цепочками записей io_uring, если ядро его поддерживает
+    bool ioUring = false;
+};
+
+struct JournalConfig {
+    /// Пусто - журнал не ведётся
+    std::filesystem::path directory;
+    std::uint64_t segmentSize = 64 << 20;
+    std::size_t maxSegments = 16;
+
+    bool operator==(const JournalConfig &) const = default;
+};
+
+struct MetricsConfig {
+    /// Файл, в который периодически пишется снимок метрик в формате Prometheus
+    std::filesystem::path file;
+    /// Unix-сокет, по которому каждый подключившийся получает снимок метрик
+    std::filesystem::path socket;
+    std::chrono::milliseconds interval{5000};
+
+    bool operator==(const MetricsConfig &) const = default;
+};
+
+struct SubscriptionConfig {
+    /// Unix-сокет, через который клиенты подписываются на события. Пусто - подписки не принимаются
+    std::filesystem::path socket;
+    /// Предел неотправленных данных одного подписчика
+    std::size_t clientBuffer = 1 << 20;
+    SlowClientPolicy slowClientPolicy = SlowClientPolicy::DISCONNECT;
+
+    bool operator==(const SubscriptionConfig &) const = default;
+};
+
+struct EventRingConfig {
+    /// Файл кольца событий в разделяемой памяти, обычно в /dev/shm. Пусто - кольцо не ведётся
+    std::filesystem::path path;
+    /// Размер области данных
+    std::uint64_t size = 16 << 20;
+
+    bool operator==(const EventRingConfig &) const = default;
+};
+
+struct TraceConfig {
+    /// Кольцевой файл с поэтапными временными метками выборки событий. Пусто - трассировка выключена
+    std::filesystem::path file;
+    /// Трассируется каждое N-е событие
+    std::uint64_t sampleEvery = 1000;
+    /// Размер кольца
+    std::uint64_t size = 16 << 20;
+
+    bool operator==(const TraceConfig &) const = default;
+};
+
+struct LogRateLimitConfig {
+    /// false - каждое событие пишется в лог отдельной строкой
+    bool enabled = false;
+    /// Строк в секунду на директорию и запас на короткие всплески
+    double rate = 100;
+    double burst = 1000;
+    /// Строк в секунду на все директории: когда активных директорий много, бюджет каждой уменьшается
+    double totalRate = 2000;
+    /// Период сводок по директории, превысившей бюджет
+    std::chrono::seconds summaryInterval{10};
+    /// Сколько самых частых имён файлов показывать в сводке
+    std::size_t topNames = 5;
+
+    bool operator==(const LogRateLimitConfig &) const = default;
+};
+
+struct WatcherConfig {
+    /// Число независимых экземпляров inotify со своими потоками чтения
+    std::size_t shards = 1;
+    /// Привязывать поток чтения каждого шарда к своему ядру
+    bool pinThreads = false;
+    /// Необязательные виды событий. Создание, удаление и перемещение отслеживаются всегда
+    bool modify = true;
+    bool closeWrite = false;
+    bool attrib = false;
+    /// Читать события через io_uring, если ядро его поддерживает
+    bool ioUring = false;
+    /// Потоки рассылки событий наблюдателям через почтовые ящики, 0 - рассылка из потока чтения
+    std::size_t dispatchThreads = 0;
+    /// Ёмкость почтового ящика каждого наблюдателя, в сообщениях
+    std::size_t mailboxCapacity = 1 << 14;
+    /// Вести снимок содержимого директорий (SnapshotIndex). Без него после переполнения очереди inotify
+    /// потерянные события не восстанавливаются
+    bool snapshot = false;
+
+    bool operator==(const WatcherConfig &) const = default;
+};
+
 struct Config {
-    std::vector<std::filesystem::path> directories;
-};
\ No newline at end of file
+    std::vector<DirectoryConfig> directories;
+    /// Перечитывать конфиг, как только файл изменился, не дожидаясь SIGHUP
+    bool watchConfig = false;
+    /// Окно объединения повторных событий об одном файле, 0 - без объединения
+    std::chrono::milliseconds coalesceWindow{0};
+    /// Поведение при переполнении очереди сообщений DiskMonitor
+    OverflowPolicy queueOverflowPolicy = OverflowPolicy::BLOCK;
+    LoggingConfig logging;
+    JournalConfig journal;
+    MetricsConfig metrics;
+    SubscriptionConfig subscriptions;
+    EventRingConfig eventRing;
+    TraceConfig trace;
+    LogRateLimitConfig logRateLimit;
+    WatcherConfig watcher;
+};
@@ -0,0 +1,91 @@
+#include "ConfigFileWatcher.h"
+
+#include <cstring>
+#include <format>
+#include <unistd.h>
+
+#include "Logger/SystemLogger.h"
+#include "Observer/Message.h"
+#include "Reactor/MainReactor.h"
+
+ConfigFileWatcher::ConfigFileWatcher() {
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyFd < 0) {
+        perror("inotify_init1");
+        return;
+    }
+
+    auto &reactor = MainReactor::instance();
+    m_debounceTimer = reactor.addTimer([this] { reload(); });
+    if (!reactor.add(m_inotifyFd, [this] { drainEvents(); })) {
+        close(m_inotifyFd);
+        m_inotifyFd = -1;
+    }
+}
+
+ConfigFileWatcher::~ConfigFileWatcher() {
+    auto &reactor = MainReactor::instance();
+    if (m_inotifyFd >= 0) {
+        reactor.remove(m_inotifyFd);
+        close(m_inotifyFd);
+    }
+    reactor.removeTimer(m_debounceTimer);
+}
+
+void ConfigFileWatcher::configure(const std::filesystem::path &configPath) {
+    std::lock_guard lock{m_mutex};
+    if (configPath == m_path || m_inotifyFd < 0) {
+        return;
+    }
+    if (m_wd >= 0) {
+        inotify_rm_watch(m_inotifyFd, m_wd);
+        m_wd = -1;
+    }
+    // Изменения прежнего файла больше не важны
+    Reactor::armTimer(m_debounceTimer, {});
+    m_path = configPath;
+    m_fileName = configPath.filename().string();
+    if (m_path.empty()) {
+        SystemLogger::instance().info("Stopped watching config file");
+        return;
+    }
+
+    const auto directory = m_path.parent_path();
+    m_wd = inotify_add_watch(m_inotifyFd, directory.c_str(), WATCH_MASK);
+    if (m_wd < 0) {
+        SystemLogger::instance().error(std::format("Cannot watch config directory {}: {}", directory.string(),
+                                                   std::strerror(errno)));
+        return;
+    }
+    SystemLogger::instance().info(std::format("Watching config file {} for changes", m_path.string()));
+}
+
+void ConfigFileWatcher::reload() {
+    SystemLogger::instance().info("Config file changed, reloading");
+    notify(ReloadConfigRequest{});
+}
+
+void ConfigFileWatcher::drainEvents() {
+    while (true) {
+        const long length = read(m_inotifyFd, m_readBuffer, sizeof(m_readBuffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return;
+        }
+
+        std::lock_guard lock{m_mutex};
+        long offset = 0;
+        while (offset < length) {
+            const auto *event = reinterpret_cast<const inotify_event *>(m_readBuffer + offset);
+            offset += static_cast<long>(sizeof(inotify_event) + event->len);
+            if (event->wd != m_wd || !event->len) {
+                continue;
+            }
+            if (std::string_view{event->name, strnlen(event->name, event->len)} == m_fileName) {
+                Reactor::armTimer(m_debounceTimer, DEBOUNCE);
+            }
+        }
+    }
+}
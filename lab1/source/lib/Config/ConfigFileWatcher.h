@@ -0,0 +1,44 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <sys/inotify.h>
+
+#include "Observer/Subject.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Следит за файлом конфига и рассылает ReloadConfigRequest, когда он изменился. Наблюдается родительская
+/// директория: редакторы и системы развёртывания обычно пишут новый файл и переименовывают его поверх старого.
+/// События обрабатываются в MainReactor, он должен быть создан раньше
+class ConfigFileWatcher : public Subject<>, public OnceInstantiated<ConfigFileWatcher> {
+    friend class OnceInstantiated;
+
+public:
+    ~ConfigFileWatcher() override;
+
+    /// Начинает следить за configPath, пустой путь - перестать следить
+    void configure(const std::filesystem::path &configPath);
+
+protected:
+    ConfigFileWatcher();
+
+private:
+    void drainEvents();
+
+    void reload();
+
+    static constexpr std::uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR;
+    /// Перезагрузка откладывается, пока файл продолжают менять: одна правка - одна перезагрузка
+    static constexpr std::chrono::milliseconds DEBOUNCE{200};
+
+    int m_inotifyFd = -1;
+    /// Откладывает перезагрузку на DEBOUNCE после последнего изменения
+    int m_debounceTimer = -1;
+    /// Защищает путь и wd: configure вызывается из потока DiskMonitor
+    std::mutex m_mutex;
+    std::filesystem::path m_path;
+    std::string m_fileName;
+    int m_wd = -1;
+    alignas(inotify_event) char m_readBuffer[4096];
+};
@@ -2,9 +2,168 @@
 
 #include <format>
 #include <filesystem>
+#include <unordered_map>
 #include <yaml-cpp/yaml.h>
 
 #include "Logger/SystemLogger.h"
+#include "ThreadPool/WorkStealingPool.h"
+
+namespace {
+    bool loadLoggingConfig(const YAML::Node &node, LoggingConfig &logging, const std::filesystem::path &filePath) {
+        if (const auto mode = node["mode"]) {
+            const auto modeName = mode.as<std::string>();
+            if (modeName == "sync") {
+                logging.mode = SystemLogger::Mode::SYNC;
+            } else if (modeName == "syslog") {
+                logging.mode = SystemLogger::Mode::ASYNC_SYSLOG;
+            } else if (modeName == "file") {
+                logging.mode = SystemLogger::Mode::ASYNC_FILE;
+            } else {
+                SystemLogger::instance().error(std::format("Unknown logging mode {} in file {}", modeName,
+                                                           filePath.string()));
+                return false;
+            }
+        }
+        if (const auto level = node["level"]) {
+            const auto levelName = level.as<std::string>();
+            if (levelName == "debug") {
+                logging.level = Logger::DEBUG;
+            } else if (levelName == "info") {
+                logging.level = Logger::INFO;
+            } else if (levelName == "warning") {
+                logging.level = Logger::WARNING;
+            } else if (levelName == "error") {
+                logging.level = Logger::ERROR;
+            } else {
+                SystemLogger::instance().error(std::format("Unknown logging level {} in file {}", levelName,
+                                                           filePath.string()));
+                return false;
+            }
+        }
+        if (const auto file = node["file"]) {
+            logging.file = file.as<std::string>();
+        }
+        if (const auto ioUring = node["io_uring"]) {
+            logging.ioUring = ioUring.as<bool>();
+        }
+        return true;
+    }
+
+    std::vector<NameFilter::Pattern> loadPatterns(const YAML::Node &node) {
+        std::vector<NameFilter::Pattern> patterns;
+        for (const auto &entry: node) {
+            if (entry.IsMap() && entry["regex"]) {
+                patterns.push_back({entry["regex"].as<std::string>(), true});
+            } else if (entry.IsMap()) {
+                patterns.push_back({entry["glob"].as<std::string>(), false});
+            } else {
+                patterns.push_back({entry.as<std::string>(), false});
+            }
+        }
+        return patterns;
+    }
+
+    enum class DirectoryProblem : std::uint8_t {
+        NONE,
+        MISSING,
+        NOT_DIRECTORY,
+        INVALID_FILTER,
+    };
+
+    struct Validation {
+        DirectoryProblem problem = DirectoryProblem::NONE;
+        std::string error;
+    };
+
+    /// Директорий в одной задаче пула
+    constexpr std::size_t VALIDATION_BATCH = 64;
+    /// Проверка упирается в задержку stat (на сетевых ФС - в ответ сервера), а не в процессор,
+    /// поэтому потоков может быть больше, чем ядер
+    constexpr std::size_t MAX_VALIDATION_THREADS = 32;
+
+    /// Ключ набора правил: одинаковые наборы компилируются один раз, и директории делят один автомат
+    std::string filterKey(const FilterConfig &filter) {
+        std::string key;
+        for (const auto *patterns: {&filter.include, &filter.exclude}) {
+            for (const auto &pattern: *patterns) {
+                key += pattern.regex ? 'r' : 'g';
+                key += pattern.text;
+                key += '\0';
+            }
+            key += '\1';
+        }
+        return key;
+    }
+
+    /// Проверяет существование директорий и компилирует их фильтры пачками на ограниченном пуле потоков.
+    /// Скомпилированный фильтр записывается в nameFilter
+    std::vector<Validation> validateDirectories(std::vector<DirectoryConfig> &directories) {
+        std::vector<Validation> validations(directories.size());
+
+        std::unordered_map<std::string, std::size_t> filterIndices;
+        std::vector<const FilterConfig *> filters;
+        std::vector<std::size_t> directoryFilters(directories.size(), SIZE_MAX);
+        for (std::size_t i = 0; i < directories.size(); ++i) {
+            if (directories[i].filter == FilterConfig{}) {
+                continue;
+            }
+            const auto [it, inserted] = filterIndices.try_emplace(filterKey(directories[i].filter), filters.size());
+            if (inserted) {
+                filters.push_back(&directories[i].filter);
+            }
+            directoryFilters[i] = it->second;
+        }
+
+        using Pool = WorkStealingPool<std::pair<std::size_t, std::size_t> >;
+        const auto runBatched = [](const std::size_t count, const auto &handler) {
+            std::vector<std::pair<std::size_t, std::size_t> > batches;
+            for (std::size_t begin = 0; begin < count; begin += VALIDATION_BATCH) {
+                batches.emplace_back(begin, std::min(count, begin + VALIDATION_BATCH));
+            }
+            if (batches.empty()) {
+                return;
+            }
+            const std::size_t threadsCount = std::min(batches.size(), MAX_VALIDATION_THREADS);
+            Pool::run(std::move(batches), threadsCount, [&](const auto &batch, Pool::Context &) {
+                for (std::size_t i = batch.first; i < batch.second; ++i) {
+                    handler(i);
+                }
+            });
+        };
+
+        std::vector<std::shared_ptr<const NameFilter> > compiled(filters.size());
+        std::vector<std::string> errors(filters.size());
+        runBatched(filters.size(), [&](const std::size_t i) {
+            if (auto filter = NameFilter::compile(filters[i]->include, filters[i]->exclude, errors[i])) {
+                compiled[i] = std::make_shared<const NameFilter>(std::move(*filter));
+            }
+        });
+
+        runBatched(directories.size(), [&](const std::size_t i) {
+            auto &directory = directories[i];
+            auto &validation = validations[i];
+            // Один stat вместо пары exists и is_directory
+            std::error_code ec;
+            const auto status = std::filesystem::status(directory.path, ec);
+            if (!std::filesystem::exists(status)) {
+                validation.problem = DirectoryProblem::MISSING;
+                return;
+            }
+            if (!std::filesystem::is_directory(status)) {
+                validation.problem = DirectoryProblem::NOT_DIRECTORY;
+                return;
+            }
+            if (const auto filter = directoryFilters[i]; filter != SIZE_MAX) {
+                directory.nameFilter = compiled[filter];
+                if (!directory.nameFilter) {
+                    validation.problem = DirectoryProblem::INVALID_FILTER;
+                    validation.error = errors[filter];
+                }
+            }
+        });
+        return validations;
+    }
+}
 
 std::shared_ptr<Config> YamlConfigLoader::loadData(const std::filesystem::path &filePath) {
     try {
@@ -17,19 +176,177 @@ std::shared_ptr<Config> YamlConfigLoader::loadData(const std::filesystem::path &
             return nullptr;
         }
 
-        for (const auto &entry: yamlConfig["directories"]) {
-            std::filesystem::path directory = entry.as<std::string>();
+        config->watchConfig = yamlConfig["watch_config"].as<bool>(false);
 
-            if (!std::filesystem::exists(directory)) {
-                SystemLogger::instance().warn(std::format(
-                    "Directory {} in file {} does not exist. Is the path relative?",
-                    directory.string(), filePath.string()));
-                continue;
+        if (const auto window = yamlConfig["coalesce_window_ms"]) {
+            config->coalesceWindow = std::chrono::milliseconds{window.as<unsigned>()};
+        }
+
+        if (const auto policy = yamlConfig["queue_overflow_policy"]) {
+            const auto policyName = policy.as<std::string>();
+            if (policyName == "block") {
+                config->queueOverflowPolicy = OverflowPolicy::BLOCK;
+            } else if (policyName == "drop_oldest") {
+                config->queueOverflowPolicy = OverflowPolicy::DROP_OLDEST;
+            } else if (policyName == "drop_newest") {
+                config->queueOverflowPolicy = OverflowPolicy::DROP_NEWEST;
+            } else {
+                SystemLogger::instance().warn(std::format("Unknown queue_overflow_policy {} in file {}, using block",
+                                                          policyName, filePath.string()));
             }
-            if (!std::filesystem::is_directory(directory)) {
-                SystemLogger::instance().warn(std::format("{} in file {} is not a directory", directory.string(),
-                                                          filePath.string()));
-                continue;
+        }
+
+        if (const auto logging = yamlConfig["logging"]) {
+            if (!loadLoggingConfig(logging, config->logging, filePath)) {
+                return nullptr;
+            }
+            if (const auto rateLimit = logging["rate_limit"]) {
+                auto &limit = config->logRateLimit;
+                limit.enabled = true;
+                limit.rate = std::max(1.0, rateLimit["per_second"].as<double>(limit.rate));
+                limit.burst = std::max(1.0, rateLimit["burst"].as<double>(limit.burst));
+                limit.totalRate = std::max(limit.rate, rateLimit["total_per_second"].as<double>(limit.totalRate));
+                limit.summaryInterval = std::chrono::seconds{
+                    std::max(1u, rateLimit["summary_interval_s"].as<unsigned>(limit.summaryInterval.count()))
+                };
+                limit.topNames = rateLimit["top_names"].as<std::size_t>(limit.topNames);
+            }
+        }
+
+        if (const auto journal = yamlConfig["journal"]) {
+            config->journal.directory = journal["directory"].as<std::string>();
+            if (const auto segmentSize = journal["segment_size_mb"]) {
+                config->journal.segmentSize = segmentSize.as<std::uint64_t>() << 20;
+            }
+            if (const auto maxSegments = journal["max_segments"]) {
+                config->journal.maxSegments = maxSegments.as<std::size_t>();
+            }
+        }
+
+        if (const auto watcher = yamlConfig["watcher"]) {
+            if (const auto shards = watcher["shards"]) {
+                config->watcher.shards = std::max(1u, shards.as<unsigned>());
+            }
+            if (const auto pinThreads = watcher["pin_threads"]) {
+                config->watcher.pinThreads = pinThreads.as<bool>();
+            }
+            if (const auto ioUring = watcher["io_uring"]) {
+                config->watcher.ioUring = ioUring.as<bool>();
+            }
+            if (const auto dispatchThreads = watcher["dispatch_threads"]) {
+                config->watcher.dispatchThreads = dispatchThreads.as<unsigned>();
+            }
+            if (const auto mailboxSize = watcher["mailbox_size"]) {
+                config->watcher.mailboxCapacity = std::max(1u, mailboxSize.as<unsigned>());
+            }
+            if (const auto snapshot = watcher["snapshot"]) {
+                config->watcher.snapshot = snapshot.as<bool>();
+            }
+            if (const auto events = watcher["events"]) {
+                config->watcher.modify = config->watcher.closeWrite = config->watcher.attrib = false;
+                for (const auto &event: events) {
+                    const auto eventName = event.as<std::string>();
+                    if (eventName == "modify") {
+                        config->watcher.modify = true;
+                    } else if (eventName == "close_write") {
+                        config->watcher.closeWrite = true;
+                    } else if (eventName == "attrib") {
+                        config->watcher.attrib = true;
+                    } else {
+                        SystemLogger::instance().warn(std::format("Unknown watcher event {} in file {}", eventName,
+                                                                  filePath.string()));
+                    }
+                }
+            }
+        }
+
+        if (const auto metrics = yamlConfig["metrics"]) {
+            if (const auto file = metrics["file"]) {
+                config->metrics.file = file.as<std::string>();
+            }
+            if (const auto socket = metrics["socket"]) {
+                config->metrics.socket = socket.as<std::string>();
+            }
+            if (const auto interval = metrics["interval_ms"]) {
+                config->metrics.interval = std::chrono::milliseconds{interval.as<unsigned>()};
+            }
+        }
+
+        if (const auto subscriptions = yamlConfig["subscriptions"]) {
+            config->subscriptions.socket = subscriptions["socket"].as<std::string>();
+            if (const auto clientBuffer = subscriptions["client_buffer_kb"]) {
+                config->subscriptions.clientBuffer = clientBuffer.as<std::size_t>() << 10;
+            }
+            if (const auto policy = subscriptions["slow_clients"]) {
+                const auto policyName = policy.as<std::string>();
+                if (policyName == "disconnect") {
+                    config->subscriptions.slowClientPolicy = SlowClientPolicy::DISCONNECT;
+                } else if (policyName == "drop") {
+                    config->subscriptions.slowClientPolicy = SlowClientPolicy::DROP;
+                } else {
+                    SystemLogger::instance().warn(std::format("Unknown slow_clients policy {} in file {}, using "
+                                                              "disconnect", policyName, filePath.string()));
+                }
+            }
+        }
+
+        if (const auto eventRing = yamlConfig["event_ring"]) {
+            config->eventRing.path = eventRing["path"].as<std::string>();
+            if (const auto size = eventRing["size_mb"]) {
+                config->eventRing.size = size.as<std::uint64_t>() << 20;
+            }
+        }
+
+        if (const auto trace = yamlConfig["trace"]) {
+            config->trace.file = trace["file"].as<std::string>();
+            config->trace.sampleEvery = std::max<std::uint64_t>(trace["sample_every"].as<std::uint64_t>(1000), 1);
+            if (const auto size = trace["size_mb"]) {
+                config->trace.size = size.as<std::uint64_t>() << 20;
+            }
+        }
+
+        for (const auto &entry: yamlConfig["directories"]) {
+            DirectoryConfig directoryConfig;
+            if (entry.IsMap()) {
+                directoryConfig.path = entry["path"].as<std::string>();
+                directoryConfig.recursive = entry["recursive"].as<bool>(false);
+                directoryConfig.hashContent = entry["hash_content"].as<bool>(false);
+                if (const auto include = entry["include"]) {
+                    directoryConfig.filter.include = loadPatterns(include);
+                }
+                if (const auto exclude = entry["exclude"]) {
+                    directoryConfig.filter.exclude = loadPatterns(exclude);
+                }
+            } else {
+                directoryConfig.path = entry.as<std::string>();
+            }
+            config->directories.emplace_back(std::move(directoryConfig));
+        }
+
+        // Проверки идут параллельно, а сообщения о них - в порядке конфига
+        const auto validations = validateDirectories(config->directories);
+        std::vector<DirectoryConfig> directories;
+        directories.reserve(config->directories.size());
+        for (std::size_t i = 0; i < validations.size(); ++i) {
+            auto &directoryConfig = config->directories[i];
+            auto &directory = directoryConfig.path;
+            switch (validations[i].problem) {
+                case DirectoryProblem::NONE:
+                    break;
+                case DirectoryProblem::MISSING:
+                    SystemLogger::instance().warn(std::format(
+                        "Directory {} in file {} does not exist. Is the path relative?",
+                        directory.string(), filePath.string()));
+                    continue;
+                case DirectoryProblem::NOT_DIRECTORY:
+                    SystemLogger::instance().warn(std::format("{} in file {} is not a directory", directory.string(),
+                                                              filePath.string()));
+                    continue;
+                case DirectoryProblem::INVALID_FILTER:
+                    SystemLogger::instance().error(std::format("Filter of directory {} in file {} is invalid: {}",
+                                                               directory.string(), filePath.string(),
+                                                               validations[i].error));
+                    return nullptr;
             }
             if (directory.is_relative()) {
                 directory = std::filesystem::absolute(directory);
@@ -37,9 +354,9 @@ std::shared_ptr<Config> YamlConfigLoader::loadData(const std::filesystem::path &
                     "Directory {} in file {} is specified via relative path. This will work once but not on config reload",
                     directory.string(), filePath.string()));
             }
-
-            config->directories.emplace_back(std::move(directory));
+            directories.emplace_back(std::move(directoryConfig));
         }
+        config->directories = std::move(directories);
 
         return config;
     } catch (const YAML::BadFile &e) {
@@ -49,6 +366,9 @@ std::shared_ptr<Config> YamlConfigLoader::loadData(const std::filesystem::path &
     } catch (const YAML::InvalidNode &e) {
         SystemLogger::instance().error(std::format("Some node in file {} is invalid. Error: {}", filePath.string(),
                                                    e.what()));
+    } catch (const YAML::BadConversion &e) {
+        SystemLogger::instance().error(std::format("Some value in file {} has wrong type. Error: {}",
+                                                   filePath.string(), e.what()));
     }
 
     return nullptr;
@@ -0,0 +1,255 @@
+#include "ContentFilter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ContentHash.h"
+#include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Paths/DirectoryRegistry.h"
+
+namespace {
+    std::int64_t toNs(const timespec &time) {
+        return static_cast<std::int64_t>(time.tv_sec) * 1'000'000'000 + time.tv_nsec;
+    }
+
+    std::int64_t realtimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+ContentFilter::ContentFilter() {
+    const std::size_t threadsCount = std::clamp<std::size_t>(std::thread::hardware_concurrency(), 1,
+                                                             MAX_HASHING_THREADS);
+    for (std::size_t i = 0; i < threadsCount; ++i) {
+        m_threads.emplace_back(&ContentFilter::hashLoop, this);
+    }
+}
+
+ContentFilter::~ContentFilter() {
+    {
+        std::lock_guard lock{m_mutex};
+        m_running = false;
+    }
+    m_cv.notify_all();
+    m_spaceCv.notify_all();
+    for (auto &thread: m_threads) {
+        thread.join();
+    }
+}
+
+void ContentFilter::configure(const std::vector<DirectoryConfig> &directories) {
+    std::vector<DirectoryConfig> roots;
+    for (const auto &directory: directories) {
+        if (directory.hashContent) {
+            roots.push_back({directory.path.lexically_normal(), directory.recursive, true});
+        }
+    }
+
+    std::lock_guard lock{m_mutex};
+    m_roots = std::move(roots);
+    m_hashedDirectories.clear();
+    if (!m_roots.empty()) {
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM,
+                                     "Content hashing of modified files enabled for {} directories", m_roots.size());
+    }
+}
+
+void ContentFilter::put(const Message &message) {
+    put(std::span{&message, 1});
+}
+
+void ContentFilter::put(const std::span<const Message> messages) {
+    std::unique_lock lock{m_mutex};
+    if (m_roots.empty() && m_slots.empty() && !m_delivering) {
+        lock.unlock();
+        notify(messages);
+        return;
+    }
+
+    std::size_t jobsCount = 0;
+    for (const auto &message: messages) {
+        if (m_slots.size() >= MAX_PENDING_EVENTS) {
+            // Пул должен продвинуться, а он мог ещё не узнать о задачах этой пачки
+            m_cv.notify_all();
+            deliver(lock);
+            m_spaceCv.wait(lock, [this] { return !m_running || m_slots.size() < MAX_PENDING_EVENTS; });
+        }
+        const auto *event = std::get_if<FileChangedInd>(&message);
+        if (!event) {
+            // Управляющие сообщения не ждут хеширования, но и не обгоняют события перед ними
+            m_slots.push_back({message, true, false});
+            continue;
+        }
+        const bool contentEvent = event->action == FileChangedInd::Action::MODIFIED ||
+                                  event->action == FileChangedInd::Action::CLOSE_WRITE;
+        if (contentEvent && isHashed(event->directoryId) && m_jobs.size() >= MAX_HASH_JOBS) {
+            Metrics::instance().uncheckedModifications.add();
+            m_slots.push_back({*event, true, false});
+        } else if (contentEvent && isHashed(event->directoryId)) {
+            m_jobs.push_back({m_firstSequence + m_slots.size(),
+                              DirectoryRegistry::instance().path(event->directoryId) / event->fileName()});
+            m_slots.push_back({*event, false, false});
+            ++jobsCount;
+        } else {
+            m_slots.push_back({*event, true, false});
+        }
+    }
+    if (jobsCount == 1) {
+        m_cv.notify_one();
+    } else if (jobsCount > 1) {
+        m_cv.notify_all();
+    }
+    deliver(lock);
+}
+
+bool ContentFilter::isHashed(const std::uint32_t directoryId) {
+    if (m_roots.empty()) {
+        return false;
+    }
+    if (const auto it = m_hashedDirectories.find(directoryId); it != m_hashedDirectories.end()) {
+        return it->second;
+    }
+
+    const auto path = DirectoryRegistry::instance().path(directoryId).lexically_normal();
+    const bool hashed = std::ranges::any_of(m_roots, [&path](const DirectoryConfig &root) {
+        if (!root.recursive) {
+            return path == root.path;
+        }
+        return std::mismatch(root.path.begin(), root.path.end(), path.begin(), path.end()).first == root.path.end();
+    });
+    m_hashedDirectories.emplace(directoryId, hashed);
+    return hashed;
+}
+
+void ContentFilter::hashLoop() {
+    std::unique_lock lock{m_mutex};
+    while (true) {
+        m_cv.wait(lock, [this] { return !m_running || !m_jobs.empty(); });
+        if (!m_running) {
+            return;
+        }
+        const auto job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        lock.unlock();
+
+        const auto inspection = inspect(job.path);
+        if (!inspection.unchanged.has_value()) {
+            const bool unchanged = refresh(inspection);
+            lock.lock();
+            resolve(job.sequence, unchanged, lock);
+            continue;
+        }
+        // Решено без чтения: событие не ждёт хеширования, хеш только обновляет кэш для следующих
+        lock.lock();
+        resolve(job.sequence, *inspection.unchanged, lock);
+        if (inspection.fd >= 0) {
+            lock.unlock();
+            refresh(inspection);
+            lock.lock();
+        }
+    }
+}
+
+void ContentFilter::resolve(const std::uint64_t sequence, const bool unchanged, std::unique_lock<std::mutex> &lock) {
+    if (unchanged) {
+        Metrics::instance().unchangedModifications.add();
+    }
+    auto &slot = m_slots[sequence - m_firstSequence];
+    slot.ready = true;
+    slot.suppressed = unchanged;
+    deliver(lock);
+}
+
+ContentFilter::Inspection ContentFilter::inspect(const std::filesystem::path &path) {
+    Inspection inspection{.unchanged = false};
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+    if (fd < 0) {
+        return inspection;
+    }
+
+    struct stat status{};
+    if (fstat(fd, &status) < 0 || !S_ISREG(status.st_mode)) {
+        close(fd);
+        return inspection;
+    }
+    inspection.key = {status.st_dev, status.st_ino};
+    inspection.size = static_cast<std::uint64_t>(status.st_size);
+    inspection.modifiedNs = toNs(status.st_mtim);
+
+    std::lock_guard lock{m_cacheMutex};
+    const auto it = m_cache.find(inspection.key);
+    // Без надёжного хеша того же размера содержимое заведомо другое или сравнить его не с чем
+    if (it == m_cache.end() || !it->second.settled || it->second.size != inspection.size) {
+        inspection.fd = fd;
+        return inspection;
+    }
+    if (it->second.modifiedNs == inspection.modifiedNs) {
+        close(fd);
+        inspection.unchanged = true;
+        return inspection;
+    }
+    inspection.fd = fd;
+    inspection.unchanged.reset();
+    return inspection;
+}
+
+bool ContentFilter::refresh(const Inspection &inspection) {
+    if (inspection.fd < 0) {
+        return false;
+    }
+    const auto hash = ContentHash::ofFile(inspection.fd);
+    const auto hashedNs = realtimeNs();
+    struct stat after{};
+    const bool stable = fstat(inspection.fd, &after) == 0 && static_cast<std::uint64_t>(after.st_size) ==
+                        inspection.size && toNs(after.st_mtim) == inspection.modifiedNs;
+    close(inspection.fd);
+    // Файл менялся во время чтения - хеш не соответствует ни одной версии, за ним придёт новое событие
+    if (!hash || !stable) {
+        return false;
+    }
+
+    std::lock_guard lock{m_cacheMutex};
+    const auto it = m_cache.find(inspection.key);
+    const bool unchanged = it != m_cache.end() && it->second.hash == *hash;
+    remember(inspection.key, {inspection.size, inspection.modifiedNs, *hash,
+                              hashedNs - inspection.modifiedNs >= MTIME_GRANULARITY_NS});
+    return unchanged;
+}
+
+void ContentFilter::remember(const FileKey &key, const CachedHash &cached) {
+    if (const auto [it, inserted] = m_cache.try_emplace(key, cached); !inserted) {
+        it->second = cached;
+        return;
+    }
+    m_cacheOrder.push_back(key);
+    while (m_cache.size() > MAX_CACHED_FILES) {
+        m_cache.erase(m_cacheOrder.front());
+        m_cacheOrder.pop_front();
+    }
+}
+
+void ContentFilter::deliver(std::unique_lock<std::mutex> &lock) {
+    std::vector<Message> ready;
+    while (!m_delivering && !m_slots.empty() && m_slots.front().ready) {
+        ready.clear();
+        while (!m_slots.empty() && m_slots.front().ready) {
+            if (!m_slots.front().suppressed) {
+                ready.push_back(std::move(m_slots.front().message));
+            }
+            m_slots.pop_front();
+            ++m_firstSequence;
+        }
+        m_spaceCv.notify_all();
+
+        m_delivering = true;
+        lock.unlock();
+        notify(std::span<const Message>{ready});
+        lock.lock();
+        m_delivering = false;
+    }
+}
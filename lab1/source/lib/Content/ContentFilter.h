@@ -0,0 +1,135 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Config/Config.h"
+#include "Observer/Message.h"
+#include "Observer/Observer.h"
+#include "Observer/Subject.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Стадия после EventCoalescer: в директориях с hash_content пропускает MODIFIED и CLOSE_WRITE, только если
+/// содержимое файла действительно изменилось. Файлы хешируются фоновым пулом потоков, хеши кэшируются
+/// по inode вместе с размером и mtime - если они не изменились, файл не читается повторно.
+/// Событие ждёт чтения файла, только если размер совпал с надёжным хешем в кэше, иначе оно отпускается
+/// сразу после fstat, а хеш обновляется уже после этого.
+/// Порядок событий сохраняется: событие уходит дальше, когда решены все MODIFIED перед ним
+class ContentFilter : public Observer, public Subject<>, public OnceInstantiated<ContentFilter> {
+    friend class OnceInstantiated;
+
+public:
+    ~ContentFilter() override;
+
+    void put(const Message &message) override;
+
+    void put(std::span<const Message> messages) override;
+
+    /// Запоминает директории с hash_content. Поддиректории рекурсивных наследуют режим
+    void configure(const std::vector<DirectoryConfig> &directories);
+
+protected:
+    ContentFilter();
+
+private:
+    static constexpr std::size_t MAX_HASHING_THREADS = 4;
+    static constexpr std::size_t MAX_CACHED_FILES = 1 << 16;
+    /// Сверх этого MODIFIED пропускаются без проверки, пока пул не разберёт очередь
+    static constexpr std::size_t MAX_HASH_JOBS = 1024;
+    /// Ожидающие события, включая стоящие за нерешёнными MODIFIED. Сверх этого put ждёт рассылки
+    static constexpr std::size_t MAX_PENDING_EVENTS = 8192;
+    /// Грубая гранулярность mtime: хешу, снятому раньше, чем через столько после изменения файла,
+    /// нельзя верить по одному совпадению размера и mtime - файл мог измениться в тот же тик
+    static constexpr std::int64_t MTIME_GRANULARITY_NS = 20'000'000;
+
+    struct Slot {
+        Message message;
+        bool ready;
+        bool suppressed;
+    };
+
+    struct Job {
+        std::uint64_t sequence;
+        std::filesystem::path path;
+    };
+
+    struct FileKey {
+        std::uint64_t device;
+        std::uint64_t inode;
+
+        bool operator==(const FileKey &) const = default;
+    };
+
+    struct FileKeyHash {
+        std::size_t operator()(const FileKey &key) const {
+            return std::hash<std::uint64_t>{}(key.inode) ^ (key.device * 0x9e3779b97f4a7c15);
+        }
+    };
+
+    /// Файл события после fstat
+    struct Inspection {
+        /// -1, если файл не нужно читать
+        int fd = -1;
+        FileKey key{};
+        std::uint64_t size = 0;
+        std::int64_t modifiedNs = 0;
+        /// Решение, принятое без чтения файла. nullopt - решает хеш
+        std::optional<bool> unchanged;
+    };
+
+    struct CachedHash {
+        std::uint64_t size;
+        std::int64_t modifiedNs;
+        std::uint64_t hash;
+        /// Хеш снят достаточно позже mtime, совпадение размера и mtime означает то же содержимое
+        bool settled;
+    };
+
+    /// Вызывать под m_mutex
+    bool isHashed(std::uint32_t directoryId);
+
+    void hashLoop();
+
+    /// Открывает файл и сверяет размер и mtime с кэшем
+    Inspection inspect(const std::filesystem::path &path);
+
+    /// Хеширует открытый inspect файл и запоминает хеш. true, если содержимое совпадает с закэшированным
+    bool refresh(const Inspection &inspection);
+
+    /// Отмечает событие решённым и рассылает готовые. Вызывать под m_mutex
+    void resolve(std::uint64_t sequence, bool unchanged, std::unique_lock<std::mutex> &lock);
+
+    /// Рассылает готовые события из начала m_slots. Рассылает только один поток за раз, остальные
+    /// оставляют ему свои готовые события, поэтому порядок не нарушается
+    void deliver(std::unique_lock<std::mutex> &lock);
+
+    /// Вызывать под m_cacheMutex
+    void remember(const FileKey &key, const CachedHash &cached);
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    /// Будит put, ждущий освобождения m_slots
+    std::condition_variable m_spaceCv;
+    bool m_running = true;
+    std::vector<DirectoryConfig> m_roots;
+    /// Решение по директории вычисляется по пути один раз
+    std::unordered_map<std::uint32_t, bool> m_hashedDirectories;
+    std::deque<Slot> m_slots;
+    /// Порядковый номер m_slots.front()
+    std::uint64_t m_firstSequence = 0;
+    std::deque<Job> m_jobs;
+    bool m_delivering = false;
+
+    std::mutex m_cacheMutex;
+    std::unordered_map<FileKey, CachedHash, FileKeyHash> m_cache;
+    /// Порядок добавления в кэш для вытеснения самых старых записей
+    std::deque<FileKey> m_cacheOrder;
+
+    std::vector<std::thread> m_threads;
+};
@@ -0,0 +1,204 @@
+#include "ContentHash.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+    constexpr std::uint64_t PRIME32 = 0x9E3779B1;
+    constexpr std::uint64_t PRIME64_1 = 0x9E3779B185EBCA87;
+    constexpr std::uint64_t PRIME64_2 = 0x165667919E3779F9;
+    /// Размер одного pread
+    constexpr std::size_t READ_SIZE = 1 << 20;
+
+    constexpr std::uint64_t splitMix(std::uint64_t &state) {
+        std::uint64_t value = state += 0x9E3779B97F4A7C15;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+        return value ^ (value >> 31);
+    }
+
+    struct Keys {
+        ContentHash::Accumulators stripe{};
+        ContentHash::Accumulators scramble{};
+    };
+
+    constexpr Keys makeKeys() {
+        Keys keys;
+        std::uint64_t state = PRIME64_1;
+        for (auto &key: keys.stripe) {
+            key = splitMix(state);
+        }
+        for (auto &key: keys.scramble) {
+            key = splitMix(state);
+        }
+        return keys;
+    }
+
+    alignas(64) constexpr Keys KEYS = makeKeys();
+
+    std::uint64_t load64(const std::byte *data) {
+        std::uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    /// Эталонная реализация: векторные версии дают тот же результат
+    [[maybe_unused]] void accumulateScalar(ContentHash::Accumulators &accumulators, const std::byte *data, const std::size_t stripes) {
+        for (std::size_t stripe = 0; stripe < stripes; ++stripe, data += ContentHash::STRIPE_SIZE) {
+            for (std::size_t lane = 0; lane < ContentHash::LANES; ++lane) {
+                const std::uint64_t value = load64(data + lane * 8);
+                const std::uint64_t keyed = value ^ KEYS.stripe[lane];
+                accumulators[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32) + load64(data + (lane ^ 1) * 8);
+            }
+        }
+    }
+
+#if defined(__x86_64__)
+    void accumulateSse2(ContentHash::Accumulators &accumulators, const std::byte *data, const std::size_t stripes) {
+        auto *acc = reinterpret_cast<__m128i *>(accumulators.data());
+        const auto *keys = reinterpret_cast<const __m128i *>(KEYS.stripe.data());
+        for (std::size_t stripe = 0; stripe < stripes; ++stripe, data += ContentHash::STRIPE_SIZE) {
+            const auto *input = reinterpret_cast<const __m128i *>(data);
+            for (std::size_t i = 0; i < ContentHash::LANES / 2; ++i) {
+                const __m128i value = _mm_loadu_si128(input + i);
+                const __m128i keyed = _mm_xor_si128(value, _mm_load_si128(keys + i));
+                const __m128i product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+                const __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+                _mm_storeu_si128(acc + i, _mm_add_epi64(_mm_loadu_si128(acc + i), _mm_add_epi64(product, swapped)));
+            }
+        }
+    }
+
+    __attribute__((target("avx2")))
+    void accumulateAvx2(ContentHash::Accumulators &accumulators, const std::byte *data, const std::size_t stripes) {
+        auto *acc = reinterpret_cast<__m256i *>(accumulators.data());
+        const auto *keys = reinterpret_cast<const __m256i *>(KEYS.stripe.data());
+        __m256i acc0 = _mm256_loadu_si256(acc), acc1 = _mm256_loadu_si256(acc + 1);
+        const __m256i key0 = _mm256_load_si256(keys), key1 = _mm256_load_si256(keys + 1);
+        for (std::size_t stripe = 0; stripe < stripes; ++stripe, data += ContentHash::STRIPE_SIZE) {
+            const auto *input = reinterpret_cast<const __m256i *>(data);
+            const __m256i value0 = _mm256_loadu_si256(input), value1 = _mm256_loadu_si256(input + 1);
+            const __m256i keyed0 = _mm256_xor_si256(value0, key0), keyed1 = _mm256_xor_si256(value1, key1);
+            const __m256i product0 = _mm256_mul_epu32(keyed0, _mm256_srli_epi64(keyed0, 32));
+            const __m256i product1 = _mm256_mul_epu32(keyed1, _mm256_srli_epi64(keyed1, 32));
+            const __m256i swapped0 = _mm256_shuffle_epi32(value0, _MM_SHUFFLE(1, 0, 3, 2));
+            const __m256i swapped1 = _mm256_shuffle_epi32(value1, _MM_SHUFFLE(1, 0, 3, 2));
+            acc0 = _mm256_add_epi64(acc0, _mm256_add_epi64(product0, swapped0));
+            acc1 = _mm256_add_epi64(acc1, _mm256_add_epi64(product1, swapped1));
+        }
+        _mm256_storeu_si256(acc, acc0);
+        _mm256_storeu_si256(acc + 1, acc1);
+    }
+#endif
+
+    using Accumulate = void (*)(ContentHash::Accumulators &, const std::byte *, std::size_t);
+
+    Accumulate selectAccumulate() {
+#if defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return accumulateAvx2;
+        }
+        return accumulateSse2;
+#else
+        return accumulateScalar;
+#endif
+    }
+
+    const Accumulate accumulate = selectAccumulate();
+
+    void scramble(ContentHash::Accumulators &accumulators) {
+        for (std::size_t lane = 0; lane < ContentHash::LANES; ++lane) {
+            auto &accumulator = accumulators[lane];
+            accumulator ^= accumulator >> 47;
+            accumulator ^= KEYS.scramble[lane];
+            accumulator *= PRIME32;
+        }
+    }
+
+    std::uint64_t fold(const std::uint64_t left, const std::uint64_t right) {
+        const auto product = static_cast<unsigned __int128>(left) * right;
+        return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+    }
+}
+
+void ContentHash::update(std::span<const std::byte> data) {
+    m_length += data.size();
+
+    if (m_tailSize) {
+        const std::size_t taken = std::min(data.size(), STRIPE_SIZE - m_tailSize);
+        std::memcpy(m_tail.data() + m_tailSize, data.data(), taken);
+        m_tailSize += taken;
+        data = data.subspan(taken);
+        if (m_tailSize < STRIPE_SIZE) {
+            return;
+        }
+        consume(m_tail.data(), 1);
+        m_tailSize = 0;
+    }
+
+    const std::size_t stripes = data.size() / STRIPE_SIZE;
+    consume(data.data(), stripes);
+    m_tailSize = data.size() - stripes * STRIPE_SIZE;
+    std::memcpy(m_tail.data(), data.data() + stripes * STRIPE_SIZE, m_tailSize);
+}
+
+void ContentHash::consume(const std::byte *data, std::size_t stripes) {
+    while (stripes) {
+        const std::size_t count = std::min(stripes, STRIPES_PER_BLOCK - m_blockStripes);
+        accumulate(m_accumulators, data, count);
+        data += count * STRIPE_SIZE;
+        stripes -= count;
+        m_blockStripes += count;
+        if (m_blockStripes == STRIPES_PER_BLOCK) {
+            scramble(m_accumulators);
+            m_blockStripes = 0;
+        }
+    }
+}
+
+std::uint64_t ContentHash::digest() const {
+    alignas(64) Accumulators accumulators = m_accumulators;
+    if (m_tailSize) {
+        std::array<std::byte, STRIPE_SIZE> last{};
+        std::memcpy(last.data(), m_tail.data(), m_tailSize);
+        accumulate(accumulators, last.data(), 1);
+    }
+
+    std::uint64_t result = m_length * PRIME64_1;
+    for (std::size_t lane = 0; lane < LANES; lane += 2) {
+        result += fold(accumulators[lane] ^ KEYS.scramble[lane], accumulators[lane + 1] ^ KEYS.stripe[lane + 1]);
+    }
+    result ^= result >> 37;
+    result *= PRIME64_2;
+    return result ^ (result >> 32);
+}
+
+std::optional<std::uint64_t> ContentHash::ofFile(const int fd) {
+    // Буфер на поток пула хеширования, чтобы не выделять память на каждый файл
+    thread_local const std::unique_ptr<std::byte[]> buffer{new std::byte[READ_SIZE]};
+
+    ContentHash hash;
+    off_t offset = 0;
+    while (true) {
+        const ssize_t bytesRead = pread(fd, buffer.get(), READ_SIZE, offset);
+        if (bytesRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::nullopt;
+        }
+        if (bytesRead == 0) {
+            return hash.digest();
+        }
+        hash.update({buffer.get(), static_cast<std::size_t>(bytesRead)});
+        offset += bytesRead;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+/// Быстрый некриптографический хеш содержимого файлов. Данные разбиваются на полосы по 64 байта,
+/// каждая полоса перемешивается в 8 независимых 64-битных аккумуляторов умножением 32x32->64,
+/// которое векторизуется: на x86-64 используется SSE2, а при поддержке процессором - AVX2.
+/// Результат не зависит от выбранной реализации
+class ContentHash {
+public:
+    void update(std::span<const std::byte> data);
+
+    [[nodiscard]] std::uint64_t digest() const;
+
+    /// Читает файл с начала крупными pread. nullopt при ошибке чтения
+    static std::optional<std::uint64_t> ofFile(int fd);
+
+    static constexpr std::size_t STRIPE_SIZE = 64;
+    static constexpr std::size_t LANES = STRIPE_SIZE / sizeof(std::uint64_t);
+
+    using Accumulators = std::array<std::uint64_t, LANES>;
+
+private:
+    /// Аккумуляторы перемешиваются после каждого блока полос, чтобы старшие биты влияли на младшие
+    static constexpr std::size_t STRIPES_PER_BLOCK = 16;
+
+    void consume(const std::byte *data, std::size_t stripes);
+
+    alignas(64) Accumulators m_accumulators{};
+    std::array<std::byte, STRIPE_SIZE> m_tail{};
+    std::size_t m_tailSize = 0;
+    std::size_t m_blockStripes = 0;
+    std::uint64_t m_length = 0;
+};
@@ -2,65 +2,315 @@
 
 #include <cstring>
 #include <format>
+#include <future>
 #include <ranges>
 #include <utility>
 
+#include "Coalescer/EventCoalescer.h"
+#include "Config/ConfigFileWatcher.h"
+#include "Content/ContentFilter.h"
 #include "DirectoriesWatcher/DirectoriesWatcher.h"
-#include "Observer/Messages.h"
+#include "Paths/DirectoryRegistry.h"
 #include "Logger/SystemLogger.h"
+#include "Trace/Probes.h"
 
 using namespace std::chrono_literals;
 
+namespace {
+    /// DROP_OLDEST вытесняет только события: StopRequest и ReloadConfigRequest не теряются
+    bool isEvictable(const Message &message) {
+        return std::holds_alternative<FileChangedInd>(message);
+    }
+}
+
 DiskMonitor::DiskMonitor(const std::string &name, std::filesystem::path configPath,
                          std::shared_ptr<ConfigLoader<Config> > configLoader,
                          const bool isDebugMode) : Daemon{name, isDebugMode},
                                                    m_configPath{std::move(configPath)},
-                                                   m_configLoader{std::move(configLoader)} {
+                                                   m_configLoader{std::move(configLoader)},
+                                                   m_metrics{Metrics::instance()},
+                                                   m_trace{EventTrace::instance()},
+                                                   m_messageQueue{MESSAGE_QUEUE_CAPACITY, OverflowPolicy::BLOCK,
+                                                                  isEvictable} {
+    m_messages.reserve(MAX_POP_BATCH);
 }
 
 std::chrono::milliseconds DiskMonitor::onMainLoopStep() {
-    const auto message = m_messageQueue.pop();
-    SystemLogger::instance().info("Processing message...");
-    if (const auto fileChangedInd = std::dynamic_pointer_cast<FileChangedInd>(message)) {
-        handleFileChangedInd(fileChangedInd);
-    } else if (const auto reloadConfigRequest = std::dynamic_pointer_cast<ReloadConfigRequest>(message)) {
-        reloadConfig();
-    } else if (const auto stopRequest = std::dynamic_pointer_cast<StopRequest>(message)) {
-        stop();
+    m_messages.clear();
+    if (!m_deferred.empty()) {
+        m_messages.swap(m_deferred);
     } else {
-        SystemLogger::instance().error("Unexpected message type in DiskMonitor::update");
+        m_messageQueue.popBatch(m_messages, MAX_POP_BATCH);
+    }
+    m_dequeuedNs = monotonicNs();
+    m_metrics.queueDepth.set(static_cast<std::int64_t>(m_messageQueue.size()));
+    for (const auto &message: m_messages) {
+        handleMessage(message);
+    }
+    if (m_subscriptionServer) {
+        m_subscriptionServer->flush();
     }
+    if (m_eventRing) {
+        m_eventRing->flush();
+    }
+    reportDroppedMessages();
     return 0ms;
 }
 
+void DiskMonitor::handleMessage(const Message &message) {
+    SystemLogger::instance().debug("Processing message...");
+    std::visit(Overloaded{
+                   [this](const FileChangedInd &fileChangedInd) { handleFileChangedInd(fileChangedInd); },
+                   [this](const ReloadConfigRequest &) { reloadConfig(); },
+                   [this](const StopRequest &) {
+                       // Таймер ограничителя живёт в MainReactor, который разрушается раньше DiskMonitor.
+                       // Заодно пишутся сводки незакончившихся штормов
+                       m_logRateLimiter.reset();
+                       // Очередь больше никто не читает: производители, ждущие места, иначе не дождутся его
+                       // никогда, и разрушение шардов зависнет на их потоках
+                       m_messageQueue.close();
+                       stop();
+                   },
+               }, message);
+}
+
+void DiskMonitor::reportDroppedMessages() {
+    const std::uint64_t droppedOldest = m_messageQueue.droppedOldest();
+    const std::uint64_t droppedNewest = m_messageQueue.droppedNewest();
+    if (droppedOldest == m_reportedDroppedOldest && droppedNewest == m_reportedDroppedNewest) {
+        return;
+    }
+    SystemLogger::instance().warn(std::format("Message queue overflow: {} oldest and {} newest messages dropped",
+                                              droppedOldest - m_reportedDroppedOldest,
+                                              droppedNewest - m_reportedDroppedNewest));
+    m_reportedDroppedOldest = droppedOldest;
+    m_reportedDroppedNewest = droppedNewest;
+    m_metrics.queueDroppedOldest.set(static_cast<std::int64_t>(droppedOldest));
+    m_metrics.queueDroppedNewest.set(static_cast<std::int64_t>(droppedNewest));
+}
+
 DiskMonitor::~DiskMonitor() = default;
 
 void DiskMonitor::reloadConfig() {
-    m_config = m_configLoader->loadData(m_configPath);
-    if (!m_config) {
-        perror("Could not load config");
+    auto config = m_configLoader->loadData(m_configPath);
+    if (!config) {
+        // Остаётся предыдущий конфиг: при автоматической перезагрузке файл мог быть сохранён не до конца
+        SystemLogger::instance().error(m_config ? "Could not load config, keeping the previous one"
+                                                : "Could not load config");
         return;
     }
+    m_config = std::move(config);
+    SystemLogger::instance().configure(m_config->logging.mode, m_config->logging.level, m_config->logging.file,
+                                       m_config->logging.ioUring);
     SystemLogger::instance().info("Config loaded successfully");
+    reloadJournal();
+    reloadMetricsExporter();
+    reloadSubscriptionServer();
+    reloadEventRing();
+    reloadLogRateLimiter();
+    m_trace.configure(m_config->trace);
+    EventCoalescer::instance().setWindow(m_config->coalesceWindow);
+    ContentFilter::instance().configure(m_config->directories);
+    m_messageQueue.setOverflowPolicy(m_config->queueOverflowPolicy);
+    if (DirectoriesWatcher::instance().config() != m_config->watcher) {
+        // configure дожидается потоков шардов, а шард может стоять на полной очереди, которую читает только
+        // этот поток. Поэтому шарды пересоздаются на отдельном потоке, а этот тем временем вынимает сообщения
+        // в m_deferred: очередь освобождается и ничего не теряется, порядок сохраняется
+        auto reconfigured = std::async(std::launch::async, [this] {
+            DirectoriesWatcher::instance().configure(m_config->watcher);
+        });
+        while (reconfigured.wait_for(0ms) != std::future_status::ready) {
+            if (!m_messageQueue.tryPopBatch(m_deferred, MAX_POP_BATCH)) {
+                reconfigured.wait_for(1ms);
+            }
+        }
+        reconfigured.get();
+    }
     DirectoriesWatcher::instance().reloadPaths(m_config->directories);
+    ConfigFileWatcher::instance().configure(m_config->watchConfig ? m_configPath : std::filesystem::path{});
+}
+
+void DiskMonitor::reloadJournal() {
+    if (m_journal && m_journalConfig == m_config->journal) {
+        return;
+    }
+    m_journal.reset();
+    m_journalConfig = m_config->journal;
+    if (m_journalConfig.directory.empty()) {
+        return;
+    }
+
+    m_journal = std::make_unique<EventJournal>(m_journalConfig.directory, m_journalConfig.segmentSize,
+                                               m_journalConfig.maxSegments);
+    if (!m_journal->isOpen()) {
+        m_journal.reset();
+        return;
+    }
+    SystemLogger::instance().info(std::format("Writing event journal to {}", m_journalConfig.directory.string()));
+}
+
+void DiskMonitor::reloadMetricsExporter() {
+    if (m_metricsConfig == m_config->metrics) {
+        return;
+    }
+    m_metricsExporter.reset();
+    m_metricsConfig = m_config->metrics;
+    if (m_metricsConfig.file.empty() && m_metricsConfig.socket.empty()) {
+        return;
+    }
+    m_metricsExporter = std::make_unique<MetricsExporter>(m_metricsConfig.file, m_metricsConfig.socket,
+                                                          m_metricsConfig.interval);
+}
+
+void DiskMonitor::reloadSubscriptionServer() {
+    if (m_subscriptionConfig == m_config->subscriptions) {
+        return;
+    }
+    m_subscriptionServer.reset();
+    m_subscriptionConfig = m_config->subscriptions;
+    if (m_subscriptionConfig.socket.empty()) {
+        return;
+    }
+    m_subscriptionServer = std::make_unique<SubscriptionServer>(m_subscriptionConfig.socket,
+                                                                m_subscriptionConfig.clientBuffer,
+                                                                m_subscriptionConfig.slowClientPolicy);
+    if (!m_subscriptionServer->isOpen()) {
+        m_subscriptionServer.reset();
+    }
+}
+
+void DiskMonitor::reloadEventRing() {
+    if (m_eventRingConfig == m_config->eventRing) {
+        return;
+    }
+    m_eventRing.reset();
+    m_eventRingConfig = m_config->eventRing;
+    if (m_eventRingConfig.path.empty()) {
+        return;
+    }
+    m_eventRing = std::make_unique<EventRingWriter>(m_eventRingConfig.path, m_eventRingConfig.size);
+    if (!m_eventRing->isOpen()) {
+        m_eventRing.reset();
+    }
+}
+
+void DiskMonitor::reloadLogRateLimiter() {
+    if (m_logRateLimitConfig == m_config->logRateLimit) {
+        return;
+    }
+    m_logRateLimiter.reset();
+    m_logRateLimitConfig = m_config->logRateLimit;
+    if (m_logRateLimitConfig.enabled) {
+        m_logRateLimiter = std::make_unique<LogRateLimiter>(m_logRateLimitConfig);
+    }
 }
 
-void DiskMonitor::put(std::shared_ptr<Message> message) {
-    SystemLogger::instance().info("Processing message...");
+void DiskMonitor::put(const Message &message) {
+    SystemLogger::instance().debug("Processing message...");
+    // Управляющие сообщения не должны теряться при переполнении очереди
+    if (!std::holds_alternative<FileChangedInd>(message)) {
+        m_messageQueue.push(message, OverflowPolicy::BLOCK);
+        return;
+    }
+    traceEnqueued(std::span{&message, 1});
     m_messageQueue.push(message);
 }
 
-void DiskMonitor::handleFileChangedInd(const std::shared_ptr<FileChangedInd> &message) {
+void DiskMonitor::put(const std::span<const Message> messages) {
+    traceEnqueued(messages);
+    // Пачкой по политике очереди уходят только события, управляющие сообщения - как в put(message)
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < messages.size(); ++i) {
+        if (std::holds_alternative<FileChangedInd>(messages[i])) {
+            continue;
+        }
+        if (begin < i) {
+            m_messageQueue.pushBatch(messages.subspan(begin, i - begin));
+        }
+        m_messageQueue.push(messages[i], OverflowPolicy::BLOCK);
+        begin = i + 1;
+    }
+    if (begin < messages.size()) {
+        m_messageQueue.pushBatch(messages.subspan(begin));
+    }
+}
+
+void DiskMonitor::traceEnqueued(const std::span<const Message> messages) {
+    if (!m_trace.enabled()) {
+        return;
+    }
+    const auto nowNs = monotonicNs();
+    for (const auto &message: messages) {
+        if (const auto *event = std::get_if<FileChangedInd>(&message); event && m_trace.sampled(event->traceId)) {
+            m_trace.record(event->traceId, EventTrace::Stage::ENQUEUE, nowNs);
+        }
+    }
+}
+
+void DiskMonitor::handleFileChangedInd(const FileChangedInd &message) {
+    if (message.timestampNs) {
+        m_metrics.record(Metrics::Stage::QUEUE_WAIT, m_dequeuedNs - message.timestampNs);
+    }
+    const auto handleStart = monotonicNs();
+    DISK_MONITOR_PROBE3(dispatch, message.traceId, static_cast<std::uint8_t>(message.action),
+                        handleStart - message.timestampNs);
+    const bool traced = m_trace.sampled(message.traceId);
+    if (traced) {
+        m_trace.record(message.traceId, EventTrace::Stage::DEQUEUE, m_dequeuedNs);
+        m_trace.record(message.traceId, EventTrace::Stage::HANDLE, handleStart);
+    }
+
+    if (m_journal || m_subscriptionServer || m_eventRing) {
+        const auto timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        if (m_journal) {
+            m_journal->append(message, timestampNs);
+        }
+        if (m_subscriptionServer) {
+            m_subscriptionServer->publish(message, timestampNs);
+        }
+        if (m_eventRing) {
+            m_eventRing->publish(message, timestampNs);
+        }
+    }
+    // Журнал, подписчики и кольцо получают все события, ограничивается только лог
+    if (!m_logRateLimiter || m_logRateLimiter->admit(message)) {
+        logFileChangedInd(message);
+        if (traced) {
+            m_trace.record(message.traceId, EventTrace::Stage::LOG, monotonicNs());
+        }
+    }
+
+    const auto handleEnd = monotonicNs();
+    if (traced) {
+        m_trace.record(message.traceId, EventTrace::Stage::DONE, handleEnd);
+    }
+    m_metrics.record(Metrics::Stage::HANDLE_EVENT, handleEnd - handleStart);
+    if (message.timestampNs) {
+        m_metrics.record(Metrics::Stage::END_TO_END, handleEnd - message.timestampNs);
+    }
+    m_metrics.eventsHandled.add();
+    m_metrics.recordDirectoryEvent(message.directoryId, message.action);
+}
+
+void DiskMonitor::logFileChangedInd(const FileChangedInd &message) const {
+    auto &logger = SystemLogger::instance();
+    if (!logger.isEnabled(SystemLogger::INFO)) {
+        return;
+    }
+
+    const auto directory = DirectoryRegistry::instance().path(message.directoryId);
+    const auto fileName = message.fileName();
     std::string strAction;
     std::string type;
 
-    if (std::filesystem::is_directory(message->directory / message->fileName)) {
+    if (std::filesystem::is_directory(directory / fileName)) {
         type = "directory";
     } else {
         type = "file";
     }
 
-    switch (message->action) {
+    switch (message.action) {
         case FileChangedInd::Action::CREATED:
             strAction = "Created";
             break;
@@ -70,9 +320,37 @@ void DiskMonitor::handleFileChangedInd(const std::shared_ptr<FileChangedInd> &me
         case FileChangedInd::Action::MODIFIED:
             strAction = "Modified";
             break;
+        case FileChangedInd::Action::RENAMED:
+            strAction = "Renamed";
+            break;
+        case FileChangedInd::Action::MOVED_IN:
+            strAction = "Moved in";
+            break;
+        case FileChangedInd::Action::MOVED_OUT:
+            strAction = "Moved out";
+            break;
+        case FileChangedInd::Action::CLOSE_WRITE:
+            strAction = "Finished writing";
+            break;
+        case FileChangedInd::Action::ATTRIB:
+            strAction = "Changed attributes of";
+            break;
     }
 
-    SystemLogger::instance().info(std::format("{} {} {} in directory {}",
-                                              strAction, type, message->fileName, message->directory.string()),
-                                  SystemLogger::LOCAL0);
+    const auto logStart = monotonicNs();
+    if (message.action == FileChangedInd::Action::RENAMED) {
+        logger.log(SystemLogger::INFO, SystemLogger::LOCAL0, "{} {} {} in directory {} to {} in directory {}",
+                   strAction, type, message.previousName(),
+                   DirectoryRegistry::instance().path(message.previousDirectoryId).string(), fileName,
+                   directory.string());
+    } else if (message.count > 1) {
+        logger.log(SystemLogger::INFO, SystemLogger::LOCAL0, "{} {} {} in directory {} ({} events)",
+                   strAction, type, fileName, directory.string(), message.count);
+    } else {
+        logger.log(SystemLogger::INFO, SystemLogger::LOCAL0, "{} {} {} in directory {}",
+                   strAction, type, fileName, directory.string());
+    }
+    const auto logNs = monotonicNs() - logStart;
+    DISK_MONITOR_PROBE2(log, message.traceId, logNs);
+    m_metrics.record(Metrics::Stage::LOGGER, logNs);
 }
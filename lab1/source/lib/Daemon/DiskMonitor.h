@@ -1,11 +1,18 @@
 #pragma once
 #include "Daemon.h"
+#include "EventRing/EventRingWriter.h"
 #include "Config/Config.h"
 #include "Config/ConfigLoader.h"
-#include "Observer/Messages.h"
+#include "Journal/EventJournal.h"
+#include "Metrics/Metrics.h"
+#include "Metrics/MetricsExporter.h"
+#include "Observer/Message.h"
 #include "Observer/Observer.h"
 #include "OnceInstantiated/OnceInstantiated.h"
-#include "Queue/ThreadSafeQueue.h"
+#include "Queue/MpscRingQueue.h"
+#include "RateLimit/LogRateLimiter.h"
+#include "Subscription/SubscriptionServer.h"
+#include "Trace/EventTrace.h"
 
 class DiskMonitor : public Daemon, public OnceInstantiated<DiskMonitor>, public Observer {
     friend class OnceInstantiated;
@@ -22,13 +29,56 @@ public:
 
     void reloadConfig() override;
 
-    void put(std::shared_ptr<Message> message) override;
+    void put(const Message &message) override;
+
+    void put(std::span<const Message> messages) override;
 
 private:
-    static void handleFileChangedInd(const std::shared_ptr<FileChangedInd> &message);
+    static constexpr std::size_t MESSAGE_QUEUE_CAPACITY = 1 << 14;
+    static constexpr std::size_t MAX_POP_BATCH = 1024;
+
+    void handleMessage(const Message &message);
+
+    void reportDroppedMessages();
+
+    void reloadJournal();
+
+    void reloadMetricsExporter();
+
+    void reloadSubscriptionServer();
+
+    void reloadEventRing();
+
+    void reloadLogRateLimiter();
+
+    /// Отмечает в трассировке постановку в очередь событий из выборки
+    void traceEnqueued(std::span<const Message> messages);
+
+    void handleFileChangedInd(const FileChangedInd &message);
+
+    void logFileChangedInd(const FileChangedInd &message) const;
 
     std::shared_ptr<Config> m_config;
     const std::filesystem::path m_configPath;
     std::shared_ptr<ConfigLoader<Config> > m_configLoader;
-    ThreadSafeQueue<std::shared_ptr<Message> > m_messageQueue;
+    Metrics &m_metrics;
+    EventTrace &m_trace;
+    std::unique_ptr<MetricsExporter> m_metricsExporter;
+    MetricsConfig m_metricsConfig;
+    std::unique_ptr<SubscriptionServer> m_subscriptionServer;
+    SubscriptionConfig m_subscriptionConfig;
+    std::unique_ptr<EventRingWriter> m_eventRing;
+    EventRingConfig m_eventRingConfig;
+    std::unique_ptr<LogRateLimiter> m_logRateLimiter;
+    LogRateLimitConfig m_logRateLimitConfig;
+    /// Время извлечения текущей пачки из очереди
+    std::int64_t m_dequeuedNs = 0;
+    std::unique_ptr<EventJournal> m_journal;
+    JournalConfig m_journalConfig;
+    MpscRingQueue<Message> m_messageQueue;
+    std::vector<Message> m_messages;
+    /// Вынутые из очереди во время пересоздания шардов, обрабатываются следующей пачкой
+    std::vector<Message> m_deferred;
+    std::uint64_t m_reportedDroppedOldest = 0;
+    std::uint64_t m_reportedDroppedNewest = 0;
 };
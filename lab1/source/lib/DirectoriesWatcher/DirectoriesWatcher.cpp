@@ -1,125 +1,225 @@
 #include "DirectoriesWatcher.h"
 
-#include <cstring>
+#include <algorithm>
 #include <format>
-#include <memory>
-#include <ranges>
-#include <sys/inotify.h>
-#include <sys/epoll.h>
+#include <string>
+#include <unordered_map>
 
 #include "Logger/SystemLogger.h"
-#include "Observer/Messages.h"
+#include "Queue/Futex.h"
+#include "Snapshot/SnapshotIndex.h"
 
-namespace {
-    FileChangedInd::Action getActionByMask(std::uint32_t mask) {
-        if (mask & IN_MODIFY) {
-            return FileChangedInd::Action::MODIFIED;
-        }
-        if (mask & IN_DELETE) {
-            return FileChangedInd::Action::DELETED;
-        }
-        return FileChangedInd::Action::CREATED;
-    }
+DirectoriesWatcher::DirectoriesWatcher() {
+    createShards();
 }
 
 DirectoriesWatcher::~DirectoriesWatcher() {
-    m_running = false;
-    m_watchThread.join();
-    clearFds();
+    destroyShards();
+    // Доставить остаток из почтовых ящиков, пока наблюдатели ещё живы
+    setDispatch(0, 0);
 }
 
-DirectoriesWatcher::DirectoriesWatcher() {
-    m_inotifyFd = inotify_init1(IN_NONBLOCK);
-    if (m_inotifyFd < 0) {
-        perror("inotify_init1");
+void DirectoriesWatcher::configure(const WatcherConfig &config) {
+    if (config == m_config) {
         return;
     }
+    destroyShards();
+    m_config = config;
+    // Шарды остановлены, notify никто не вызывает
+    setDispatch(m_config.dispatchThreads, m_config.mailboxCapacity);
+    createShards();
+    // Новые шарды ни на что не подписаны, снимки старых больше не обновляются
+    SnapshotIndex::instance().clear();
+    m_assignments.clear();
+    SystemLogger::instance().info(std::format("Watching with {} shard(s){}{}{}", m_shards.size(),
+                                              m_config.pinThreads ? ", reader threads pinned to CPUs" : "",
+                                              m_config.dispatchThreads
+                                                  ? std::format(", {} dispatch thread(s)", m_config.dispatchThreads)
+                                                  : "",
+                                              m_config.snapshot ? ", directory snapshot on" : ""));
+}
 
-    m_epollFd = epoll_create1(0);
-    if (m_epollFd < 0) {
-        perror("epoll_create1");
-        clearFds();
-        return;
+void DirectoriesWatcher::reloadPaths(const std::vector<DirectoryConfig> &directories) {
+    const auto assignments = assign(directories);
+
+    std::vector<std::vector<DirectoryConfig> > added(m_shards.size());
+    std::vector<std::vector<std::filesystem::path> > removed(m_shards.size());
+    std::size_t changedCount = 0;
+    for (const auto &[path, assignment]: assignments) {
+        const auto old = m_assignments.find(path);
+        if (old == m_assignments.end() || old->second.shard != assignment.shard) {
+            added[assignment.shard].push_back({path, assignment.recursive, false, assignment.filter,
+                                               assignment.nameFilter});
+            continue;
+        }
+        if (old->second.filter != assignment.filter) {
+            m_shards[assignment.shard]->setFilter(path, assignment.nameFilter);
+        }
+        if (old->second.recursive != assignment.recursive) {
+            m_shards[assignment.shard]->setRecursive(path, assignment.recursive);
+        }
+        if (old->second.filter != assignment.filter || old->second.recursive != assignment.recursive) {
+            ++changedCount;
+        }
+    }
+    for (const auto &[path, assignment]: m_assignments) {
+        const auto current = assignments.find(path);
+        if (current == assignments.end() || current->second.shard != assignment.shard) {
+            removed[assignment.shard].emplace_back(path);
+        }
     }
 
-    epoll_event event{};
-    event.events = EPOLLIN;
-    event.data.fd = m_inotifyFd;
+    // Сначала ставятся новые watch, затем снимаются старые, чтобы директория, перешедшая
+    // к другому корню или шарду, ни на мгновение не оставалась без наблюдения
+    std::size_t addedCount = 0, removedCount = 0;
+    for (std::size_t shard = 0; shard < m_shards.size(); ++shard) {
+        addedCount += added[shard].size();
+        if (!added[shard].empty()) {
+            m_shards[shard]->addPaths(added[shard]);
+        }
+    }
+    for (std::size_t shard = 0; shard < m_shards.size(); ++shard) {
+        removedCount += removed[shard].size();
+        if (!removed[shard].empty()) {
+            m_shards[shard]->removePaths(removed[shard]);
+        }
+    }
+    m_assignments = assignments;
 
-    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_inotifyFd, &event) < 0) {
-        perror("epoll_ctl");
-        clearFds();
-        return;
+    // Корень, удалённый и созданный заново, остался в конфиге прежним, но его watch снят ядром
+    std::size_t restoredCount = 0;
+    for (const auto &shard: m_shards) {
+        restoredCount += shard->rewatchLostRoots();
     }
 
-    m_watchThread = std::thread{&DirectoriesWatcher::watchLoop, this};
+    SystemLogger::instance().info(std::format("Watched directories reloaded: {} added, {} removed, {} changed, "
+                                              "{} restored", addedCount, removedCount, changedCount, restoredCount));
 }
 
-void DirectoriesWatcher::reloadPaths(std::vector<std::filesystem::path> paths) {
-    m_paths = std::move(paths);
-    for (const auto &wd: std::views::keys(m_watchDescriptors)) {
-        inotify_rm_watch(m_inotifyFd, wd);
+void DirectoriesWatcher::createShards() {
+    const std::size_t shardsCount = std::max<std::size_t>(m_config.shards, 1);
+    const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::uint32_t watchMask = IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO;
+    if (m_config.modify) {
+        watchMask |= IN_MODIFY;
+    }
+    if (m_config.closeWrite) {
+        watchMask |= IN_CLOSE_WRITE;
+    }
+    if (m_config.attrib) {
+        watchMask |= IN_ATTRIB;
     }
-    subscribeToPaths();
-}
 
-void DirectoriesWatcher::subscribeToPaths() {
-    for (const auto &dir: m_paths) {
-        int wd = inotify_add_watch(m_inotifyFd, dir.c_str(), IN_CREATE | IN_MODIFY | IN_DELETE);
-        if (wd < 0) {
-            SystemLogger::instance().error(std::format("Cannot watch directory {}: {}", dir.string(),
-                                                       std::strerror(errno)));
-            continue;
+    if (shardsCount > 1) {
+        for (std::size_t shard = 0; shard < shardsCount; ++shard) {
+            m_shardQueues.push_back(std::make_unique<MpscRingQueue<Message> >(SHARD_QUEUE_CAPACITY));
         }
-        m_watchDescriptors[wd] = dir;
+        m_merging = true;
+        m_mergeThread = std::thread{&DirectoriesWatcher::mergeLoop, this};
+    }
+
+    for (std::size_t shard = 0; shard < shardsCount; ++shard) {
+        const auto cpu = m_config.pinThreads ? std::optional<unsigned>{static_cast<unsigned>(shard % cpus)}
+                                             : std::nullopt;
+        auto publisher = [this, shard](const std::span<const Message> messages) { publish(shard, messages); };
+        m_shards.push_back(std::make_unique<WatcherShard>(shard, std::move(publisher), cpu, watchMask,
+                                                          m_config.ioUring, m_config.snapshot));
+    }
+}
 
-        SystemLogger::instance().info(std::format("Observing directory {}", dir.string()));
+void DirectoriesWatcher::destroyShards() {
+    // Сначала останавливаются производители, затем поток слияния дочитывает очереди
+    m_shards.clear();
+    if (m_mergeThread.joinable()) {
+        m_merging = false;
+        m_publishEpoch.fetch_add(1);
+        futex::wake(m_publishEpoch, 1);
+        m_mergeThread.join();
     }
+    m_shardQueues.clear();
 }
 
-void DirectoriesWatcher::watchLoop() {
-    constexpr int MAX_EVENTS = 10;
-    epoll_event events[MAX_EVENTS];
-
-    while (m_running) {
-        const int n = epoll_wait(m_epollFd, events, MAX_EVENTS, 500);
-        if (n < 0 && errno != EINTR) {
-            perror("epoll_wait");
-            break;
-        }
-
-        for (int i = 0; i < n; ++i) {
-            if (events[i].data.fd == m_inotifyFd) {
-                char buffer[1024];
-                const long length = read(m_inotifyFd, buffer, sizeof(buffer));
-                if (length < 0) {
-                    if (errno != EAGAIN) {
-                        perror("read");
-                    }
-                    continue;
-                }
-
-                long offset = 0;
-                while (offset < length) {
-                    auto *eventPtr = reinterpret_cast<inotify_event *>(buffer + offset);
-                    if (eventPtr->len) {
-                        const std::string file{eventPtr->name};
-                        const auto directoryPath = m_watchDescriptors[eventPtr->wd];
-                        notify(std::make_shared<FileChangedInd>(directoryPath, file, getActionByMask(eventPtr->mask)));
-                    }
-                    offset += sizeof(inotify_event) + eventPtr->len;
-                }
+std::map<std::filesystem::path, DirectoriesWatcher::Assignment> DirectoriesWatcher::assign(
+    const std::vector<DirectoryConfig> &directories) const {
+    std::map<std::filesystem::path, Assignment> assignments;
+    for (const auto &directory: directories) {
+        auto normal = directory.path.lexically_normal();
+        if (normal.has_parent_path() && !normal.has_filename()) {
+            normal = normal.parent_path();
+        }
+        // Повтор директории в конфиге объединяется: рекурсивность побеждает, фильтр берётся из первого упоминания
+        auto [it, inserted] = assignments.try_emplace(normal);
+        auto &assignment = it->second;
+        assignment.recursive = assignment.recursive || directory.recursive;
+        if (inserted) {
+            assignment.filter = directory.filter;
+            assignment.nameFilter = directory.nameFilter;
+        }
+    }
+
+    // В упорядоченном map предки идут раньше потомков, поэтому шард предка уже известен
+    std::unordered_map<std::string, std::size_t> recursiveRoots;
+    for (auto &[path, assignment]: assignments) {
+        assignment.shard = std::hash<std::string>{}(path.string()) % m_shards.size();
+        // Ближайший рекурсивный предок определяет шард
+        for (auto parent = path.parent_path(); !parent.empty(); parent = parent.parent_path()) {
+            if (const auto it = recursiveRoots.find(parent.string()); it != recursiveRoots.end()) {
+                assignment.shard = it->second;
+                break;
+            }
+            if (parent == parent.root_path()) {
+                break;
             }
         }
+        if (assignment.recursive) {
+            recursiveRoots.emplace(path.string(), assignment.shard);
+        }
+    }
+    return assignments;
+}
+
+void DirectoriesWatcher::publish(const std::size_t shard, const std::span<const Message> messages) {
+    if (m_shardQueues.empty()) {
+        notify(messages);
+        return;
     }
 
-    clearFds();
+    m_shardQueues[shard]->pushBatch(messages);
+    m_publishEpoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_mergerSleeping.load(std::memory_order_seq_cst)) {
+        futex::wake(m_publishEpoch, 1);
+    }
 }
 
-void DirectoriesWatcher::clearFds() {
-    for (const auto &wd: std::views::keys(m_watchDescriptors)) {
-        inotify_rm_watch(m_inotifyFd, wd);
+void DirectoriesWatcher::mergeLoop() {
+    std::vector<Message> batch;
+    batch.reserve(MERGE_QUANTUM);
+    std::size_t first = 0;
+
+    while (true) {
+        const std::uint32_t epoch = m_publishEpoch.load(std::memory_order_seq_cst);
+        bool merged = false;
+        // Круговой обход с разных стартовых очередей, чтобы ни одна не имела постоянного приоритета
+        for (std::size_t i = 0; i < m_shardQueues.size(); ++i) {
+            auto &queue = *m_shardQueues[(first + i) % m_shardQueues.size()];
+            batch.clear();
+            if (queue.tryPopBatch(batch, MERGE_QUANTUM)) {
+                notify(std::span<const Message>{batch});
+                merged = true;
+            }
+        }
+        first = (first + 1) % m_shardQueues.size();
+        if (merged) {
+            continue;
+        }
+        if (!m_merging) {
+            return;
+        }
+
+        m_mergerSleeping.store(1, std::memory_order_seq_cst);
+        if (m_publishEpoch.load(std::memory_order_seq_cst) == epoch) {
+            futex::wait(m_publishEpoch, epoch);
+        }
+        m_mergerSleeping.store(0, std::memory_order_relaxed);
     }
-    close(m_inotifyFd);
-    close(m_epollFd);
 }
@@ -1,28 +1,71 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <map>
+#include <memory>
 #include <thread>
-#include <unordered_map>
+#include <vector>
+
+#include "WatcherShard.h"
+#include "Config/Config.h"
+#include "Observer/Message.h"
 #include "Observer/Subject.h"
 #include "OnceInstantiated/OnceInstantiated.h"
+#include "Queue/MpscRingQueue.h"
 
+/// Наблюдение за директориями из конфига. Директории распределяются по шардам - независимым экземплярам
+/// inotify со своими потоками чтения. С одним шардом события рассылаются прямо из его потока,
+/// с несколькими - каждый шард пишет в свою очередь, а поток слияния забирает из очередей по кругу.
+/// С dispatch_threads события кладутся в почтовые ящики наблюдателей, и медленный наблюдатель не держит поток чтения
 class DirectoriesWatcher : public Subject<>, public OnceInstantiated<DirectoriesWatcher> {
 public:
     ~DirectoriesWatcher() override;
 
     explicit DirectoriesWatcher();
 
-    void reloadPaths(std::vector<std::filesystem::path> paths);
+    /// Любое изменение пересоздаёт шарды без подписок, после него нужен reloadPaths
+    void configure(const WatcherConfig &config);
+
+    [[nodiscard]] const WatcherConfig &config() const { return m_config; }
 
-    void watchLoop();
+    /// Сравнивает новый список директорий с текущим и меняет только отличающиеся подписки:
+    /// стоимость пропорциональна изменению, а не числу наблюдаемых директорий
+    void reloadPaths(const std::vector<DirectoryConfig> &directories);
 
 private:
-    void subscribeToPaths();
+    void createShards();
+
+    void destroyShards();
+
+    struct Assignment {
+        std::size_t shard = 0;
+        bool recursive = false;
+        FilterConfig filter;
+        std::shared_ptr<const NameFilter> nameFilter;
+    };
+
+    /// Нормализует пути и распределяет директории по шардам. Директория внутри рекурсивной попадает в шард
+    /// объемлющей, иначе её события пришли бы дважды из разных экземпляров inotify
+    [[nodiscard]] std::map<std::filesystem::path, Assignment> assign(
+        const std::vector<DirectoryConfig> &directories) const;
+
+    void publish(std::size_t shard, std::span<const Message> messages);
+
+    void mergeLoop();
+
+    /// Сколько сообщений поток слияния забирает из одной очереди за проход, чтобы загруженный шард не вытеснял остальные
+    static constexpr std::size_t MERGE_QUANTUM = 1024;
+    static constexpr std::size_t SHARD_QUEUE_CAPACITY = 1 << 14;
 
-    void clearFds();
+    WatcherConfig m_config;
+    std::map<std::filesystem::path, Assignment> m_assignments;
+    std::vector<std::unique_ptr<MpscRingQueue<Message> > > m_shardQueues;
+    std::vector<std::unique_ptr<WatcherShard> > m_shards;
 
-    std::atomic<bool> m_running{true};
-    std::vector<std::filesystem::path> m_paths;
-    std::thread m_watchThread;
-    std::atomic<int> m_inotifyFd, m_epollFd;
-    std::unordered_map<int, std::filesystem::path> m_watchDescriptors;
+    std::thread m_mergeThread;
+    std::atomic<bool> m_merging{false};
+    /// Увеличивается после каждой записи в очередь шарда, на нём засыпает поток слияния
+    alignas(64) std::atomic<std::uint32_t> m_publishEpoch{0};
+    std::atomic<std::uint32_t> m_mergerSleeping{0};
 };
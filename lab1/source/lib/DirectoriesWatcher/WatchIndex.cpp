@@ -0,0 +1,171 @@
+#include "WatchIndex.h"
+
+WatchIndex::WatchIndex() : m_published{new Table{}} {
+}
+
+WatchIndex::~WatchIndex() {
+    delete m_published.load();
+}
+
+const WatchIndex::Entry *WatchIndex::Table::find(const int wd) const {
+    if (wd < 0) {
+        return nullptr;
+    }
+    const std::size_t chunk = static_cast<std::size_t>(wd) >> CHUNK_BITS;
+    if (chunk >= chunks.size() || !chunks[chunk]) {
+        return nullptr;
+    }
+    const auto &entry = chunks[chunk]->entries[static_cast<std::size_t>(wd) & (CHUNK_SIZE - 1)];
+    return entry.active ? &entry : nullptr;
+}
+
+std::optional<WatchIndex::Entry> WatchIndex::find(const int wd) const {
+    if (const auto *entry = m_published.load(std::memory_order_acquire)->find(wd)) {
+        return *entry;
+    }
+    std::lock_guard lock{m_mutex};
+    if (const auto *entry = findWorking(wd)) {
+        return *entry;
+    }
+    return std::nullopt;
+}
+
+std::optional<WatchIndex::Entry> WatchIndex::findLatest(const int wd) const {
+    std::lock_guard lock{m_mutex};
+    if (const auto *entry = findWorking(wd)) {
+        return *entry;
+    }
+    return std::nullopt;
+}
+
+bool WatchIndex::add(const int wd, const std::uint32_t directoryId, const bool recursive, const int rootWd) {
+    if (wd < 0) {
+        return false;
+    }
+    std::lock_guard lock{m_mutex};
+    if (findWorking(wd)) {
+        return false;
+    }
+    setEntry(wd, Entry{true, recursive, directoryId, rootWd});
+    return true;
+}
+
+void WatchIndex::update(const int wd, const bool recursive, const int rootWd) {
+    std::lock_guard lock{m_mutex};
+    if (const auto *entry = findWorking(wd)) {
+        setEntry(wd, Entry{true, recursive, entry->directoryId, rootWd});
+    }
+}
+
+std::optional<WatchIndex::Entry> WatchIndex::remove(const int wd) {
+    std::lock_guard lock{m_mutex};
+    const auto *entry = findWorking(wd);
+    if (!entry) {
+        return std::nullopt;
+    }
+    const Entry removed = *entry;
+    setEntry(wd, Entry{});
+    return removed;
+}
+
+void WatchIndex::clear() {
+    std::lock_guard lock{m_mutex};
+    m_working.clear();
+    m_size = 0;
+    m_dirty = true;
+    m_hasChanges.store(true, std::memory_order_release);
+}
+
+std::vector<int> WatchIndex::descriptors() const {
+    std::vector<int> result;
+    std::lock_guard lock{m_mutex};
+    result.reserve(m_size);
+    for (std::size_t chunk = 0; chunk < m_working.size(); ++chunk) {
+        if (!m_working[chunk]) {
+            continue;
+        }
+        for (std::size_t i = 0; i < CHUNK_SIZE; ++i) {
+            if (m_working[chunk]->entries[i].active) {
+                result.push_back(static_cast<int>(chunk * CHUNK_SIZE + i));
+            }
+        }
+    }
+    return result;
+}
+
+std::size_t WatchIndex::size() const {
+    std::lock_guard lock{m_mutex};
+    return m_size;
+}
+
+void WatchIndex::publish() {
+    std::lock_guard lock{m_mutex};
+    publishLocked();
+}
+
+void WatchIndex::quiescent() {
+    if (!m_hasChanges.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::vector<std::unique_ptr<const Table> > retired;
+    {
+        std::lock_guard lock{m_mutex};
+        publishLocked();
+        // Поток чтения не держит ссылок ни на одну таблицу, кроме текущей опубликованной
+        retired.swap(m_retired);
+        m_hasChanges.store(false, std::memory_order_relaxed);
+    }
+}
+
+WatchIndex::Chunk &WatchIndex::writableChunk(const std::size_t index) {
+    if (index >= m_working.size()) {
+        m_working.resize(index + 1);
+    }
+    auto &chunk = m_working[index];
+    if (!chunk) {
+        chunk = std::make_shared<Chunk>();
+    } else if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+    return *chunk;
+}
+
+const WatchIndex::Entry *WatchIndex::findWorking(const int wd) const {
+    if (wd < 0) {
+        return nullptr;
+    }
+    const std::size_t chunk = static_cast<std::size_t>(wd) >> CHUNK_BITS;
+    if (chunk >= m_working.size() || !m_working[chunk]) {
+        return nullptr;
+    }
+    const auto &entry = m_working[chunk]->entries[static_cast<std::size_t>(wd) & (CHUNK_SIZE - 1)];
+    return entry.active ? &entry : nullptr;
+}
+
+void WatchIndex::setEntry(const int wd, const Entry &entry) {
+    const std::size_t chunkIndex = static_cast<std::size_t>(wd) >> CHUNK_BITS;
+    auto &chunk = writableChunk(chunkIndex);
+    auto &slot = chunk.entries[static_cast<std::size_t>(wd) & (CHUNK_SIZE - 1)];
+    if (slot.active != entry.active) {
+        chunk.active += entry.active ? 1 : -1;
+        m_size += entry.active ? 1 : -1;
+    }
+    slot = entry;
+    // Кусок без живых записей не держим: wd со временем растут, старые номера не возвращаются
+    if (!chunk.active) {
+        m_working[chunkIndex].reset();
+    }
+    m_dirty = true;
+    m_hasChanges.store(true, std::memory_order_release);
+}
+
+void WatchIndex::publishLocked() {
+    if (!m_dirty) {
+        return;
+    }
+    auto table = std::make_unique<Table>();
+    table->chunks.assign(m_working.begin(), m_working.end());
+    const Table *previous = m_published.exchange(table.release(), std::memory_order_acq_rel);
+    m_retired.emplace_back(previous);
+    m_dirty = false;
+}
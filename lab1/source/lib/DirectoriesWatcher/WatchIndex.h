@@ -0,0 +1,132 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/// Индекс watch-дескрипторов inotify. Ядро выдаёт wd небольшими возрастающими числами,
+/// поэтому индекс - массив по номеру wd, разбитый на куски. Путь директории хранится в DirectoryRegistry.
+///
+/// Поток чтения событий ищет wd в опубликованной таблице без блокировок. Изменения вносятся в рабочую
+/// копию под мьютексом: куски копируются при первой записи, поэтому публикация стоит O(число кусков),
+/// а не O(числа wd). Только что добавленный, ещё не опубликованный wd находится через рабочую копию.
+/// Старые таблицы освобождаются, когда поток чтения сообщает, что не держит на них ссылок (quiescent)
+class WatchIndex {
+public:
+    struct Entry {
+        bool active = false;
+        bool recursive = false;
+        std::uint32_t directoryId = 0;
+        /// wd директории из конфига, ради которой поставлен этот watch
+        int rootWd = -1;
+    };
+
+    WatchIndex();
+
+    ~WatchIndex();
+
+    WatchIndex(const WatchIndex &) = delete;
+
+    WatchIndex &operator=(const WatchIndex &) = delete;
+
+    /// Без блокировок, если wd уже опубликован. Только из потока чтения, который вызывает quiescent:
+    /// опубликованную таблицу освобождает он, и ссылку на неё в другом потоке ничто не защищает
+    [[nodiscard]] std::optional<Entry> find(int wd) const;
+
+    /// Под блокировкой по рабочей копии: видит и ещё не опубликованные удаления. Для всех потоков, кроме потока чтения
+    [[nodiscard]] std::optional<Entry> findLatest(int wd) const;
+
+    /// false, если wd уже есть: inotify возвращает тот же wd для уже наблюдаемой директории
+    bool add(int wd, std::uint32_t directoryId, bool recursive, int rootWd);
+
+    void update(int wd, bool recursive, int rootWd);
+
+    /// Возвращает удалённую запись, nullopt - wd не было
+    std::optional<Entry> remove(int wd);
+
+    void clear();
+
+    /// Что сделать с записью при обходе forEach
+    struct Change {
+        bool remove = false;
+        std::optional<Entry> update;
+    };
+
+    /// Обходит все записи рабочей копии под блокировкой. handler(wd, entry) возвращает Change
+    template<typename Handler>
+    void forEach(Handler handler);
+
+    [[nodiscard]] std::vector<int> descriptors() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    /// Делает изменения рабочей копии видимыми для поиска без блокировок
+    void publish();
+
+    /// Вызывается потоком чтения, когда он не держит ссылок на опубликованную таблицу:
+    /// публикует накопленные изменения и освобождает старые таблицы
+    void quiescent();
+
+private:
+    static constexpr std::size_t CHUNK_BITS = 10;
+    static constexpr std::size_t CHUNK_SIZE = 1 << CHUNK_BITS;
+
+    struct Chunk {
+        std::array<Entry, CHUNK_SIZE> entries{};
+        std::size_t active = 0;
+    };
+
+    struct Table {
+        std::vector<std::shared_ptr<const Chunk> > chunks;
+
+        [[nodiscard]] const Entry *find(int wd) const;
+    };
+
+    /// Кусок рабочей копии для записи, копируется, если на него ссылается опубликованная таблица
+    Chunk &writableChunk(std::size_t index);
+
+    const Entry *findWorking(int wd) const;
+
+    void setEntry(int wd, const Entry &entry);
+
+    void publishLocked();
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<Chunk> > m_working;
+    std::size_t m_size = 0;
+    bool m_dirty = false;
+    std::atomic<bool> m_hasChanges{false};
+
+    std::atomic<const Table *> m_published;
+    std::vector<std::unique_ptr<const Table> > m_retired;
+};
+
+template<typename Handler>
+void WatchIndex::forEach(Handler handler) {
+    std::lock_guard lock{m_mutex};
+    for (std::size_t chunk = 0; chunk < m_working.size(); ++chunk) {
+        if (!m_working[chunk]) {
+            continue;
+        }
+        for (std::size_t i = 0; i < CHUNK_SIZE; ++i) {
+            // Кусок мог быть освобождён внутри handler
+            if (!m_working[chunk]) {
+                break;
+            }
+            const Entry entry = m_working[chunk]->entries[i];
+            if (!entry.active) {
+                continue;
+            }
+            const int wd = static_cast<int>(chunk * CHUNK_SIZE + i);
+            const Change change = handler(wd, entry);
+            if (change.remove) {
+                setEntry(wd, Entry{});
+            } else if (change.update) {
+                setEntry(wd, *change.update);
+            }
+        }
+    }
+}
@@ -0,0 +1,880 @@
+#include "WatcherShard.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <ranges>
+#include <unordered_set>
+#include <pthread.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Observer/Message.h"
+#include "Paths/DirectoryRegistry.h"
+#include "Snapshot/DirectoryScanner.h"
+#include "Trace/Probes.h"
+#include "ThreadPool/WorkStealingPool.h"
+
+namespace {
+    FileChangedInd::Action getActionByMask(std::uint32_t mask) {
+        if (mask & IN_MODIFY) {
+            return FileChangedInd::Action::MODIFIED;
+        }
+        if (mask & IN_CLOSE_WRITE) {
+            return FileChangedInd::Action::CLOSE_WRITE;
+        }
+        if (mask & IN_ATTRIB) {
+            return FileChangedInd::Action::ATTRIB;
+        }
+        if (mask & IN_DELETE) {
+            return FileChangedInd::Action::DELETED;
+        }
+        return FileChangedInd::Action::CREATED;
+    }
+}
+
+WatcherShard::~WatcherShard() {
+    m_reactor.stop();
+    if (m_watchThread.joinable()) {
+        m_watchThread.join();
+    } else {
+        clearFds();
+    }
+}
+
+WatcherShard::WatcherShard(const std::size_t index, Publisher publisher, const std::optional<unsigned> cpu,
+                           const std::uint32_t watchMask, const bool ioUring, const bool snapshot) : m_index{index},
+                                                            m_publisher{std::move(publisher)},
+                                                            m_cpu{cpu},
+                                                            m_watchMask{watchMask},
+                                                            m_useIoUring{ioUring},
+                                                            m_snapshot{snapshot},
+                                                            m_metrics{Metrics::instance()},
+                                                            m_trace{EventTrace::instance()},
+                                                            m_snapshotIndex{SnapshotIndex::instance()} {
+    // За один read может прийти больше событий, чем MAX_BATCH_EVENTS, поэтому запас
+    m_batch.reserve(MAX_BATCH_EVENTS + READ_BUFFER_SIZE / sizeof(inotify_event));
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK);
+    if (m_inotifyFd < 0) {
+        perror("inotify_init1");
+        return;
+    }
+
+    m_deadlineTimer = m_reactor.addTimer([this] { runDeferred(); });
+    if (m_deadlineTimer < 0 || !watchInotify()) {
+        clearFds();
+        return;
+    }
+
+    m_watchThread = std::thread{&WatcherShard::watchLoop, this};
+}
+
+void WatcherShard::addPaths(const std::vector<DirectoryConfig> &directories) {
+    std::vector<ScanTask> roots;
+
+    for (const auto &directory: directories) {
+        const auto &dir = directory.path;
+        const bool recursive = directory.recursive;
+        int wd = inotify_add_watch(m_inotifyFd, dir.c_str(), m_watchMask);
+        if (wd < 0) {
+            SystemLogger::instance().log(SystemLogger::ERROR, SystemLogger::SYSTEM, "Cannot watch directory {}: {}",
+                                         dir.string(), std::strerror(errno));
+            continue;
+        }
+        m_roots.insert_or_assign(dir.string(), Root{wd, recursive, directory.nameFilter});
+
+        // Директория уже наблюдается внутри рекурсивной: становится корнем своего поддерева.
+        // Ссылку на запись директории держит прежняя запись индекса
+        if (const auto directoryId = DirectoryRegistry::instance().intern(dir);
+            !m_watchIndex.add(wd, directoryId, recursive, wd)) {
+            DirectoryRegistry::instance().release(directoryId);
+            const auto existing = m_watchIndex.findLatest(wd);
+            m_watchIndex.update(wd, recursive || (existing && existing->recursive), wd);
+        }
+        if (recursive) {
+            roots.push_back({wd, dir, wd});
+        } else {
+            roots.push_back({wd, dir, -1});
+        }
+
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Observing directory {}{}", dir.string(),
+                                     recursive ? " recursively" : "");
+    }
+
+    publishFilters();
+    if (!roots.empty()) {
+        snapshotDirectories(std::move(roots));
+    }
+    m_watchIndex.publish();
+}
+
+void WatcherShard::removePaths(const std::vector<std::filesystem::path> &paths) {
+    std::unordered_map<int, int> newOwners;
+    for (const auto &path: paths) {
+        const auto root = m_roots.find(path.string());
+        if (root == m_roots.end()) {
+            continue;
+        }
+        const int wd = root->second.wd;
+        m_roots.erase(root);
+        // Поддерево остаётся под наблюдением, если его покрывает другой рекурсивный корень
+        const auto *owner = coveringRoot(path);
+        newOwners.emplace(wd, owner ? owner->wd : -1);
+
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Stopped observing directory {}",
+                                     path.string());
+    }
+    releaseSubtrees(newOwners, {});
+    publishFilters();
+}
+
+std::size_t WatcherShard::rewatchLostRoots() {
+    std::vector<DirectoryConfig> lost;
+    for (const auto &[path, root]: m_roots) {
+        if (!m_watchIndex.findLatest(root.wd)) {
+            lost.push_back({path, root.recursive, false, {}, root.filter});
+        }
+    }
+    if (lost.empty()) {
+        return 0;
+    }
+    addPaths(lost);
+    return static_cast<std::size_t>(std::ranges::count_if(lost, [this](const DirectoryConfig &directory) {
+        return m_watchIndex.findLatest(m_roots.at(directory.path.string()).wd).has_value();
+    }));
+}
+
+void WatcherShard::setRecursive(const std::filesystem::path &path, const bool recursive) {
+    const auto root = m_roots.find(path.string());
+    if (root == m_roots.end() || root->second.recursive == recursive) {
+        return;
+    }
+    root->second.recursive = recursive;
+    const int wd = root->second.wd;
+
+    if (recursive) {
+        m_watchIndex.update(wd, true, wd);
+        snapshotDirectories({{wd, path, wd}});
+        m_watchIndex.publish();
+    } else if (const auto *owner = coveringRoot(path)) {
+        releaseSubtrees({{wd, owner->wd}}, {});
+        m_watchIndex.update(wd, true, wd);
+    } else {
+        releaseSubtrees({{wd, -1}}, {wd});
+        m_watchIndex.update(wd, false, wd);
+    }
+    m_watchIndex.publish();
+    SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Observing directory {}{}", path.string(),
+                                 recursive ? " recursively" : "");
+}
+
+void WatcherShard::setFilter(const std::filesystem::path &path, std::shared_ptr<const NameFilter> filter) {
+    const auto root = m_roots.find(path.string());
+    if (root == m_roots.end()) {
+        return;
+    }
+    root->second.filter = std::move(filter);
+    const int wd = root->second.wd;
+    const auto *nameFilter = root->second.filter.get();
+    publishFilters();
+
+    if (!root->second.recursive) {
+        snapshotDirectories({{wd, path, -1}});
+        m_watchIndex.publish();
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Filter of directory {} updated",
+                                     path.string());
+        return;
+    }
+
+    // Поддиректории, путь к которым от корня проходит через исключённое имя
+    std::vector<std::pair<int, std::uint32_t> > excluded;
+    if (nameFilter) {
+        m_watchIndex.forEach([&](const int entryWd, const WatchIndex::Entry &entry) -> WatchIndex::Change {
+            if (entry.rootWd != wd || entryWd == wd) {
+                return {};
+            }
+            const auto relative = DirectoryRegistry::instance().path(entry.directoryId).lexically_relative(path);
+            for (const auto &component: relative) {
+                if (!nameFilter->accepts(component.native(), true)) {
+                    excluded.emplace_back(entryWd, entry.directoryId);
+                    return {true, std::nullopt};
+                }
+            }
+            return {};
+        });
+    }
+    for (const auto &[excludedWd, directoryId]: excluded) {
+        unwatch(excludedWd, directoryId);
+    }
+
+    // Повторный обход пересобирает снимки по новому фильтру и находит ставшие разрешёнными поддиректории
+    snapshotDirectories({{wd, path, wd, true}});
+    m_watchIndex.publish();
+    SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM,
+                                 "Filter of directory {} updated, {} subdirectory watches removed", path.string(),
+                                 excluded.size());
+}
+
+void WatcherShard::publishFilters() {
+    auto filters = std::make_shared<Filters>();
+    for (const auto &root: m_roots | std::views::values) {
+        if (root.filter) {
+            filters->emplace(root.wd, root.filter);
+        }
+    }
+    m_filters.store(std::move(filters), std::memory_order_release);
+}
+
+const NameFilter *WatcherShard::filterFor(const Filters &filters, const int rootWd) {
+    if (filters.empty()) {
+        return nullptr;
+    }
+    const auto it = filters.find(rootWd);
+    return it != filters.end() ? it->second.get() : nullptr;
+}
+
+void WatcherShard::releaseSubtrees(const std::unordered_map<int, int> &newOwners, const std::unordered_set<int> &keep) {
+    if (newOwners.empty()) {
+        return;
+    }
+
+    std::vector<std::pair<int, std::uint32_t> > removed;
+    m_watchIndex.forEach([&](const int wd, const WatchIndex::Entry &entry) -> WatchIndex::Change {
+        const auto owner = newOwners.find(entry.rootWd);
+        if (owner == newOwners.end() || keep.contains(wd)) {
+            return {};
+        }
+        if (owner->second >= 0) {
+            return {false, WatchIndex::Entry{true, true, entry.directoryId, owner->second}};
+        }
+        removed.emplace_back(wd, entry.directoryId);
+        return {true, std::nullopt};
+    });
+
+    for (const auto &[wd, directoryId]: removed) {
+        unwatch(wd, directoryId);
+    }
+    m_watchIndex.publish();
+}
+
+const WatcherShard::Root *WatcherShard::coveringRoot(const std::filesystem::path &path) const {
+    for (auto parent = path.parent_path(); !parent.empty(); parent = parent.parent_path()) {
+        if (const auto root = m_roots.find(parent.string()); root != m_roots.end() && root->second.recursive) {
+            return &root->second;
+        }
+        if (parent == parent.root_path()) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+void WatcherShard::snapshotDirectories(std::vector<ScanTask> roots) {
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<std::size_t> watchesAdded{0};
+
+    using Pool = WorkStealingPool<ScanTask>;
+    // Watch на директорию ставится до её чтения, поэтому изменения после снимка придут событиями
+    const auto filters = m_filters.load(std::memory_order_acquire);
+    const auto scan = [&](const ScanTask &task, Pool::Context &context) {
+        // Потоки пула и управляющий поток не участвуют в quiescent, поиск без блокировок им недоступен
+        const auto entry = m_watchIndex.findLatest(task.wd);
+        if (!entry) {
+            return;
+        }
+        auto listing = DirectoryScanner::scan(task.path, filterFor(*filters, entry->rootWd));
+        if (!listing) {
+            return;
+        }
+        if (task.rootWd >= 0) {
+            for (const auto &child: listing->entries()) {
+                if (child.type != DirectoryListing::Type::DIRECTORY) {
+                    continue;
+                }
+                auto path = task.path / listing->name(child);
+                const int wd = addSubdirectoryWatch(task.wd, *entry, path, task.rootWd, task.revisit);
+                if (wd >= 0) {
+                    context.push({wd, std::move(path), task.rootWd, task.revisit});
+                    watchesAdded.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        }
+        if (m_snapshot) {
+            m_snapshotIndex.replace(entry->directoryId, std::move(*listing));
+        }
+    };
+    Pool::run(std::move(roots), std::thread::hardware_concurrency(), scan);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!m_snapshot) {
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM,
+                                     "Shard {}: added {} subdirectory watches in {} ms", m_index, watchesAdded.load(),
+                                     elapsed);
+        return;
+    }
+    const auto stats = m_snapshotIndex.stats();
+    SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM,
+                                 "Shard {}: added {} subdirectory watches, snapshot of {} directories with {} entries "
+                                 "({} KiB) built in {} ms",
+                                 m_index, watchesAdded.load(), stats.directories, stats.entries,
+                                 stats.memoryUsage / 1024, elapsed);
+}
+
+int WatcherShard::addSubdirectoryWatch(const int parentWd, const WatchIndex::Entry &parent,
+                                       const std::filesystem::path &path, const int rootWd, const bool revisit) {
+    const int wd = inotify_add_watch(m_inotifyFd, path.c_str(), m_watchMask | IN_ONLYDIR | IN_DONT_FOLLOW);
+    if (wd < 0) {
+        SystemLogger::instance().log(SystemLogger::ERROR, SystemLogger::SYSTEM, "Cannot watch directory {}: {}",
+                                     path.string(), std::strerror(errno));
+        return -1;
+    }
+    const auto directoryId = DirectoryRegistry::instance().intern(parent.directoryId, path.filename().native());
+    if (m_watchIndex.add(wd, directoryId, true, rootWd)) {
+        // Пока поток чтения ставил watch, управляющий поток мог снять поддерево родителя, передать его
+        // другому корню или исключить это имя фильтром. Его проход по индексу либо уже увидел новую запись,
+        // либо закончился раньше - тогда изменение видно здесь
+        const auto current = m_watchIndex.findLatest(parentWd);
+        const auto *filter = current ? filterFor(*m_filters.load(std::memory_order_acquire), current->rootWd) : nullptr;
+        if (!current || (filter && !filter->accepts(path.filename().native(), true))) {
+            m_watchIndex.remove(wd);
+            unwatch(wd, directoryId);
+            return -1;
+        }
+        if (current->rootWd != parent.rootWd && rootWd == parent.rootWd) {
+            m_watchIndex.update(wd, true, current->rootWd);
+        }
+        return wd;
+    }
+
+    // Директория уже наблюдается, и ссылку на её запись держит прежняя запись индекса.
+    // Вызывается и из пула снимков, поэтому поиск под блокировкой
+    DirectoryRegistry::instance().release(directoryId);
+    const auto existing = m_watchIndex.findLatest(wd);
+    if (!existing) {
+        return -1;
+    }
+    if (existing->rootWd == wd) {
+        // Корень из конфига: рекурсивный обходит себя сам, содержимое нерекурсивного принадлежит объемлющему
+        return existing->recursive ? -1 : wd;
+    }
+    if (existing->rootWd == rootWd) {
+        return revisit ? wd : -1;
+    }
+    // Поддерево объемлющего корня переходит к более близкому
+    m_watchIndex.update(wd, true, rootWd);
+    return wd;
+}
+
+void WatcherShard::watchLoop() {
+    if (m_cpu) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(*m_cpu, &cpus);
+        if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus); error != 0) {
+            SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                         "Cannot pin watcher shard {} to CPU {}: {}", m_index, *m_cpu,
+                                         std::strerror(error));
+        }
+    }
+
+    if (m_useIoUring) {
+        setupRing();
+    }
+
+    m_reactor.run();
+
+    if (m_ring) {
+        m_reactor.remove(m_ring->fd());
+        m_ring.reset();
+    }
+    clearFds();
+}
+
+bool WatcherShard::watchInotify() {
+    return m_reactor.add(m_inotifyFd, [this] {
+        drainEvents();
+        runDeferred();
+    });
+}
+
+void WatcherShard::runDeferred() {
+    if (!m_pendingMoves.empty()) {
+        expireMoves();
+    }
+    if (!m_rescanQueue.empty() && std::chrono::steady_clock::now() >= m_rescanNotBefore) {
+        rescanStep();
+    }
+    m_watchIndex.quiescent();
+    armDeadline();
+}
+
+void WatcherShard::armDeadline() {
+    using Clock = std::chrono::steady_clock;
+    auto deadline = Clock::time_point::max();
+    if (!m_rescanQueue.empty()) {
+        deadline = m_rescanNotBefore;
+    }
+    if (!m_pendingMoves.empty()) {
+        deadline = std::min(deadline, m_pendingMoves.front().deadline);
+    }
+    if (deadline == Clock::time_point::max()) {
+        Reactor::armTimer(m_deadlineTimer, {});
+        return;
+    }
+    // Нулевая задержка остановила бы таймер, а срок уже мог наступить
+    Reactor::armTimer(m_deadlineTimer, std::max<std::chrono::nanoseconds>(deadline - Clock::now(),
+                                                                          std::chrono::nanoseconds{1}));
+}
+
+void WatcherShard::setupRing() {
+    auto ring = IoUring::create(8);
+    if (!ring) {
+        SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                     "Shard {}: io_uring is unavailable ({}), reading events via epoll", m_index,
+                                     std::strerror(errno));
+        return;
+    }
+    if (!ring->supports(IoUring::OP_READ_MULTISHOT)) {
+        SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                     "Shard {}: kernel lacks io_uring multishot read, reading events via epoll",
+                                     m_index);
+        return;
+    }
+    if (!ring->registerBufferRing(RING_BUFFER_GROUP, RING_BUFFERS, RING_BUFFER_SIZE)) {
+        SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                     "Shard {}: cannot register io_uring buffers ({}), reading events via epoll",
+                                     m_index, std::strerror(errno));
+        return;
+    }
+    m_ring = std::move(ring);
+    if (!armRingRead()) {
+        m_ring.reset();
+        return;
+    }
+    // Завершения будят Reactor через дескриптор кольца, inotify теперь читает ядро
+    m_reactor.remove(m_inotifyFd);
+    m_reactor.add(m_ring->fd(), [this] {
+        drainRing();
+        runDeferred();
+    });
+    SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM, "Shard {}: reading events via io_uring",
+                                 m_index);
+}
+
+bool WatcherShard::armRingRead() {
+    auto *sqe = m_ring->nextSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IoUring::OP_READ_MULTISHOT;
+    sqe->fd = m_inotifyFd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RING_BUFFER_GROUP;
+    if (const int error = m_ring->submit(); error < 0) {
+        SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                     "Shard {}: io_uring submit failed: {}", m_index, std::strerror(-error));
+        return false;
+    }
+    return true;
+}
+
+void WatcherShard::dropRing() {
+    m_reactor.remove(m_ring->fd());
+    m_ring.reset();
+    // Пока чтение стояло, события копились в inotify, и Reactor сразу их отдаст
+    watchInotify();
+}
+
+void WatcherShard::drainRing() {
+    bool overflowed = false, rearm = false;
+    int failure = 0;
+    const auto filters = m_filters.load(std::memory_order_acquire);
+    m_ring->forEachCompletion([&](const io_uring_cqe &cqe) {
+        // Без IORING_CQE_F_MORE чтение больше не стоит: кончились буферы или произошла ошибка
+        rearm = rearm || !(cqe.flags & IORING_CQE_F_MORE);
+        if (cqe.res <= 0) {
+            if (cqe.res < 0 && cqe.res != -ENOBUFS) {
+                failure = -cqe.res;
+            }
+            return;
+        }
+        const auto readStart = monotonicNs();
+        const auto bufferId = static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        m_metrics.inotifyReads.add();
+        DISK_MONITOR_PROBE2(read, m_index, cqe.res);
+        const auto decoded = m_batch.size();
+        overflowed = handleEvents(m_ring->buffer(bufferId), cqe.res, readStart, *filters) || overflowed;
+        m_ring->recycleBuffer(bufferId);
+        const auto readNs = monotonicNs() - readStart;
+        DISK_MONITOR_PROBE3(decode, m_index, m_batch.size() - decoded, readNs);
+        m_metrics.record(Metrics::Stage::WATCHER_READ, readNs);
+        if (m_batch.size() >= MAX_BATCH_EVENTS) {
+            publishBatch();
+        }
+    });
+
+    publishBatch();
+    if (overflowed) {
+        scheduleRescan();
+    }
+    if (failure) {
+        SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                     "Shard {}: io_uring read failed ({}), reading events via epoll", m_index,
+                                     std::strerror(failure));
+        dropRing();
+        return;
+    }
+    if (rearm && !armRingRead()) {
+        dropRing();
+    }
+}
+
+void WatcherShard::publishBatch() {
+    // За перемещением в пачке уже есть события, значит пара не пришла сразу и уже не придёт:
+    // MOVED_OUT публикуется на своём месте, а не после этих событий
+    for (std::size_t i = 0; i < m_pendingMoves.size();) {
+        if (m_pendingMoves[i].batchPosition < m_batch.size()) {
+            expireMove(i);
+        } else {
+            ++i;
+        }
+    }
+    for (auto &move: m_pendingMoves) {
+        move.batchPosition = 0;
+    }
+    if (m_batch.empty()) {
+        return;
+    }
+    // До публикации: наблюдатель, получивший событие, после SnapshotIndex::sync найдёт его в снимке
+    if (m_snapshot) {
+        m_snapshotIndex.enqueue(m_batch);
+    }
+    const auto notifyStart = monotonicNs();
+    // Один fetch_add на пачку: номера событий пачки идут подряд
+    const auto firstId = m_trace.assignIds(m_batch.size());
+    const bool tracing = m_trace.enabled();
+    auto traceId = firstId;
+    for (auto &message: m_batch) {
+        if (auto *event = std::get_if<FileChangedInd>(&message)) {
+            event->traceId = traceId;
+            if (tracing && m_trace.sampled(traceId)) {
+                m_trace.record(traceId, EventTrace::Stage::READ, event->timestampNs);
+                m_trace.record(traceId, EventTrace::Stage::PUBLISH, notifyStart);
+            }
+        }
+        ++traceId;
+    }
+    DISK_MONITOR_PROBE3(publish, m_index, firstId, m_batch.size());
+    m_publisher(std::span<const Message>{m_batch});
+    m_metrics.record(Metrics::Stage::NOTIFY, monotonicNs() - notifyStart);
+    m_metrics.eventsRead.add(m_batch.size());
+    m_batch.clear();
+}
+
+void WatcherShard::drainEvents() {
+    bool overflowed = false;
+    const auto filters = m_filters.load(std::memory_order_acquire);
+    while (true) {
+        const auto readStart = monotonicNs();
+        const long length = read(m_inotifyFd, m_readBuffer, sizeof(m_readBuffer));
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                perror("read");
+            }
+            break;
+        }
+        if (length == 0) {
+            break;
+        }
+        m_metrics.inotifyReads.add();
+        DISK_MONITOR_PROBE2(read, m_index, length);
+
+        const auto decoded = m_batch.size();
+        overflowed = handleEvents(m_readBuffer, length, readStart, *filters) || overflowed;
+        const auto readNs = monotonicNs() - readStart;
+        DISK_MONITOR_PROBE3(decode, m_index, m_batch.size() - decoded, readNs);
+        m_metrics.record(Metrics::Stage::WATCHER_READ, readNs);
+
+        if (m_batch.size() >= MAX_BATCH_EVENTS) {
+            publishBatch();
+        }
+    }
+
+    publishBatch();
+    if (overflowed) {
+        scheduleRescan();
+    }
+}
+
+bool WatcherShard::handleEvents(const char *data, const long length, const std::int64_t readStart,
+                                const Filters &filters) {
+    bool overflowed = false;
+    long offset = 0;
+    while (offset < length) {
+        const auto *eventPtr = reinterpret_cast<const inotify_event *>(data + offset);
+        offset += static_cast<long>(sizeof(inotify_event) + eventPtr->len);
+
+        if (eventPtr->mask & IN_Q_OVERFLOW) {
+            overflowed = true;
+            continue;
+        }
+        if (eventPtr->mask & IN_IGNORED) {
+            // wd, снятый управляющим потоком, уже удалён из индекса вместе со ссылкой
+            if (const auto removed = m_watchIndex.remove(eventPtr->wd)) {
+                m_snapshotIndex.remove(removed->directoryId);
+                DirectoryRegistry::instance().release(removed->directoryId);
+            }
+            continue;
+        }
+        if (!eventPtr->len) {
+            continue;
+        }
+
+        const auto entry = m_watchIndex.find(eventPtr->wd);
+        if (!entry) {
+            continue;
+        }
+
+        // name дополнен нулями до выравнивания, реальная длина меньше len
+        const std::string_view name{eventPtr->name, strnlen(eventPtr->name, eventPtr->len)};
+        // Отвергнутое фильтром событие не доходит ни до очереди, ни до снимка
+        if (const auto *filter = filterFor(filters, entry->rootWd);
+            filter && !filter->accepts(name, eventPtr->mask & IN_ISDIR)) {
+            continue;
+        }
+
+        const bool isDirectory = eventPtr->mask & IN_ISDIR;
+        if (!m_pendingMoves.empty()) {
+            expireMovesOf(entry->directoryId, name);
+        }
+        if (eventPtr->mask & IN_MOVED_FROM) {
+            if (m_pendingMoves.size() >= MAX_PENDING_MOVES) {
+                expireMove(0);
+            }
+            m_pendingMoves.push_back({eventPtr->cookie,
+                                      FileChangedInd{entry->directoryId, name, FileChangedInd::Action::MOVED_OUT,
+                                                     1, readStart},
+                                      isDirectory, std::chrono::steady_clock::now() + MOVE_TIMEOUT, m_batch.size()});
+            continue;
+        }
+
+        auto &event = std::get<FileChangedInd>(m_batch.emplace_back(
+            std::in_place_type<FileChangedInd>, entry->directoryId, name, getActionByMask(eventPtr->mask), 1,
+            readStart));
+        if (eventPtr->mask & IN_MOVED_TO) {
+            // Пара обычно в конце очереди: IN_MOVED_FROM пришло последним
+            const auto move = std::find_if(m_pendingMoves.rbegin(), m_pendingMoves.rend(), [&](const auto &pending) {
+                return pending.cookie == eventPtr->cookie;
+            });
+            if (move != m_pendingMoves.rend()) {
+                event.action = FileChangedInd::Action::RENAMED;
+                event.setPrevious(move->event.directoryId, move->event.fileName());
+                if (isDirectory) {
+                    forgetSubtree(move->event.directoryId, move->event.fileName());
+                }
+                m_pendingMoves.erase(std::next(move).base());
+            } else {
+                event.action = FileChangedInd::Action::MOVED_IN;
+            }
+        }
+
+        if (entry->recursive && isDirectory && (eventPtr->mask & (IN_CREATE | IN_MOVED_TO))) {
+            watchCreatedSubtree(eventPtr->wd, *entry, DirectoryRegistry::instance().path(entry->directoryId) / name);
+        }
+    }
+    return overflowed;
+}
+
+void WatcherShard::scheduleRescan() {
+    m_metrics.inotifyOverflows.add();
+    // Повторные переполнения во время шторма только откладывают пересканирование
+    m_rescanNotBefore = std::chrono::steady_clock::now() + RESCAN_DELAY;
+    if (!m_rescanQueue.empty()) {
+        return;
+    }
+
+    // Ядро не сообщает, события каких директорий потеряны, поэтому сверяются все наблюдаемые
+    const auto descriptors = m_watchIndex.descriptors();
+    m_rescanQueue.assign(descriptors.begin(), descriptors.end());
+    m_rescanDifferences = 0;
+    SystemLogger::instance().log(SystemLogger::WARNING, SystemLogger::SYSTEM,
+                                 "Inotify event queue overflowed, rescanning {} directories{}", m_rescanQueue.size(),
+                                 m_snapshot ? "" : " for new subdirectories only, snapshot is off");
+}
+
+void WatcherShard::rescanStep() {
+    if (m_snapshot) {
+        // Снимок должен учесть уже опубликованные события, иначе они вернутся как различия
+        m_snapshotIndex.sync();
+    }
+    for (std::size_t i = 0; i < RESCAN_DIRECTORIES_PER_STEP && !m_rescanQueue.empty(); ++i) {
+        const int wd = m_rescanQueue.front();
+        m_rescanQueue.pop_front();
+
+        const auto entry = m_watchIndex.find(wd);
+        if (!entry || (m_snapshot && !m_snapshotIndex.contains(entry->directoryId)) ||
+            (!m_snapshot && !entry->recursive)) {
+            continue;
+        }
+        const auto directoryId = entry->directoryId;
+        const auto directory = DirectoryRegistry::instance().path(directoryId);
+        auto listing = DirectoryScanner::scan(directory, filterFor(*m_filters.load(std::memory_order_acquire),
+                                                                   entry->rootWd));
+        if (!listing) {
+            continue;
+        }
+        if (!m_snapshot) {
+            // Сравнить не с чем: уже наблюдаемые поддиректории addSubdirectoryWatch пропустит
+            for (const auto &child: listing->entries()) {
+                if (child.type == DirectoryListing::Type::DIRECTORY) {
+                    watchCreatedSubtree(wd, *entry, directory / listing->name(child));
+                }
+            }
+            continue;
+        }
+
+        const auto timestamp = monotonicNs();
+        const auto differences = m_snapshotIndex.rescan(directoryId, std::move(*listing));
+        if (!differences) {
+            continue;
+        }
+        for (const auto &difference: *differences) {
+            if (entry->recursive && difference.isDirectory && difference.action == FileChangedInd::Action::CREATED) {
+                watchCreatedSubtree(wd, *entry, directory / difference.name);
+            }
+            m_batch.emplace_back(std::in_place_type<FileChangedInd>, directoryId, difference.name,
+                                 difference.action, 1, timestamp);
+            ++m_rescanDifferences;
+        }
+    }
+    publishBatch();
+
+    if (m_rescanQueue.empty()) {
+        SystemLogger::instance().log(SystemLogger::INFO, SystemLogger::SYSTEM,
+                                     "Rescan after inotify overflow finished, {} changes recovered",
+                                     m_rescanDifferences);
+        return;
+    }
+    m_rescanNotBefore = std::chrono::steady_clock::now() + RESCAN_INTERVAL;
+}
+
+void WatcherShard::watchCreatedSubtree(const int parentWd, const WatchIndex::Entry &parent,
+                                       const std::filesystem::path &directory) {
+    const int wd = addSubdirectoryWatch(parentWd, parent, directory, parent.rootWd);
+    if (wd < 0) {
+        return;
+    }
+
+    // Поддиректории могли появиться до того, как на новую директорию был поставлен watch
+    const auto filters = m_filters.load(std::memory_order_acquire);
+    std::vector<std::pair<int, std::filesystem::path> > created{{wd, directory}};
+    while (!created.empty()) {
+        const auto [createdWd, createdPath] = std::move(created.back());
+        created.pop_back();
+        const auto entry = m_watchIndex.find(createdWd);
+        if (!entry) {
+            continue;
+        }
+        auto listing = DirectoryScanner::scan(createdPath, filterFor(*filters, entry->rootWd));
+        if (!listing) {
+            continue;
+        }
+        for (const auto &child: listing->entries()) {
+            if (child.type != DirectoryListing::Type::DIRECTORY) {
+                continue;
+            }
+            const auto subdirectory = createdPath / listing->name(child);
+            const int childWd = addSubdirectoryWatch(createdWd, *entry, subdirectory, entry->rootWd);
+            if (childWd >= 0) {
+                created.emplace_back(childWd, subdirectory);
+            }
+        }
+        if (m_snapshot) {
+            m_snapshotIndex.replace(entry->directoryId, std::move(*listing));
+        }
+    }
+}
+
+void WatcherShard::expireMove(const std::size_t index) {
+    const auto move = std::move(m_pendingMoves[index]);
+    m_pendingMoves.erase(m_pendingMoves.begin() + static_cast<std::ptrdiff_t>(index));
+    if (move.isDirectory) {
+        forgetSubtree(move.event.directoryId, move.event.fileName());
+    }
+    const auto position = std::min(move.batchPosition, m_batch.size());
+    m_batch.insert(m_batch.begin() + static_cast<std::ptrdiff_t>(position), Message{move.event});
+    // Остальные сдвигаются вслед за вставленным, из стоявших на том же месте - только более поздние
+    for (std::size_t i = 0; i < m_pendingMoves.size(); ++i) {
+        auto &other = m_pendingMoves[i];
+        if (other.batchPosition > position || (other.batchPosition == position && i >= index)) {
+            ++other.batchPosition;
+        }
+    }
+}
+
+void WatcherShard::expireMovesOf(const std::uint32_t directoryId, const std::string_view name) {
+    for (std::size_t i = 0; i < m_pendingMoves.size();) {
+        const auto &move = m_pendingMoves[i];
+        if (move.event.directoryId == directoryId && move.event.fileName() == name) {
+            expireMove(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+void WatcherShard::expireMoves() {
+    const auto now = std::chrono::steady_clock::now();
+    while (!m_pendingMoves.empty() && m_pendingMoves.front().deadline <= now) {
+        expireMove(0);
+    }
+    publishBatch();
+}
+
+void WatcherShard::forgetSubtree(const std::uint32_t parentId, const std::string_view name) {
+    const auto &registry = DirectoryRegistry::instance();
+    // Записи нет - директория не наблюдалась, снимать нечего
+    const auto found = registry.find(parentId, name);
+    if (!found) {
+        return;
+    }
+    const auto directoryId = *found;
+    std::vector<std::pair<int, std::uint32_t> > removed;
+    m_watchIndex.forEach([&](const int wd, const WatchIndex::Entry &entry) -> WatchIndex::Change {
+        // Корень из конфига наблюдается по своему пути, а не как часть перемещённого поддерева
+        if (wd == entry.rootWd || !registry.isWithin(entry.directoryId, directoryId)) {
+            return {};
+        }
+        removed.emplace_back(wd, entry.directoryId);
+        return {true, std::nullopt};
+    });
+    for (const auto &[wd, removedId]: removed) {
+        unwatch(wd, removedId);
+    }
+    m_watchIndex.publish();
+}
+
+void WatcherShard::unwatch(const int wd, const std::uint32_t directoryId) {
+    inotify_rm_watch(m_inotifyFd, wd);
+    m_snapshotIndex.remove(directoryId);
+    DirectoryRegistry::instance().release(directoryId);
+}
+
+void WatcherShard::clearFds() {
+    auto &registry = DirectoryRegistry::instance();
+    m_watchIndex.forEach([&](const int wd, const WatchIndex::Entry &entry) -> WatchIndex::Change {
+        inotify_rm_watch(m_inotifyFd, wd);
+        registry.release(entry.directoryId);
+        return {};
+    });
+    m_watchIndex.clear();
+    close(m_inotifyFd);
+    m_inotifyFd = -1;
+}
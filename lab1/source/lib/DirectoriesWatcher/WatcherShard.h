@@ -0,0 +1,217 @@
+#pragma once
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <sys/inotify.h>
+
+#include "WatchIndex.h"
+#include "Config/Config.h"
+#include "Metrics/Metrics.h"
+#include "Observer/Message.h"
+#include "Reactor/Reactor.h"
+#include "Snapshot/SnapshotIndex.h"
+#include "Trace/EventTrace.h"
+#include "Uring/IoUring.h"
+
+/// Один экземпляр inotify со своим потоком чтения. Директория из конфига закрепляется за шардом вместе
+/// со всем поддеревом: wd имеют смысл только внутри своего дескриптора inotify. Поток шарда спит в своём
+/// Reactor, отложенные перемещения и пересканирование будит таймер
+class WatcherShard {
+public:
+    /// Вызывается на потоке шарда для каждой пачки прочитанных событий
+    using Publisher = std::function<void(std::span<const Message>)>;
+
+    /// cpu - ядро, к которому привязывается поток чтения, если задано. watchMask - маска inotify для всех watch.
+    /// ioUring - читать события многократным чтением io_uring, если ядро его поддерживает.
+    /// snapshot - поддерживать SnapshotIndex наблюдаемых директорий
+    WatcherShard(std::size_t index, Publisher publisher, std::optional<unsigned> cpu, std::uint32_t watchMask,
+                 bool ioUring, bool snapshot);
+
+    ~WatcherShard();
+
+    WatcherShard(const WatcherShard &) = delete;
+
+    WatcherShard &operator=(const WatcherShard &) = delete;
+
+    /// Пути должны быть нормализованы. Изменения затрагивают только указанные директории и их поддеревья
+    void addPaths(const std::vector<DirectoryConfig> &directories);
+
+    void removePaths(const std::vector<std::filesystem::path> &paths);
+
+    /// Заново ставит watch на корни, чей watch снят ядром (IN_IGNORED): директорию удалили и, возможно, создали
+    /// снова. Возвращает число корней, которые снова наблюдаются
+    std::size_t rewatchLostRoots();
+
+    void setRecursive(const std::filesystem::path &path, bool recursive);
+
+    /// Снимает watch с поддиректорий, которые теперь исключены, и добавляет ставшие разрешёнными
+    void setFilter(const std::filesystem::path &path, std::shared_ptr<const NameFilter> filter);
+
+private:
+    /// Директория из конфига
+    struct Root {
+        int wd;
+        bool recursive;
+        std::shared_ptr<const NameFilter> filter;
+    };
+
+    struct ScanTask {
+        int wd;
+        std::filesystem::path path;
+        /// Корень, которому принадлежат найденные поддиректории, -1 - не обходить поддиректории
+        int rootWd;
+        /// Обходить и уже наблюдаемые поддиректории своего корня
+        bool revisit = false;
+    };
+
+    /// IN_MOVED_FROM, ожидающее парного IN_MOVED_TO с тем же cookie
+    struct PendingMove {
+        std::uint32_t cookie;
+        /// Готовое событие MOVED_OUT на случай, если пара не придёт
+        FileChangedInd event;
+        bool isDirectory;
+        std::chrono::steady_clock::time_point deadline;
+        /// Место IN_MOVED_FROM в m_batch. Для перемещений из уже опубликованных пачек - 0: они раньше всех в текущей
+        std::size_t batchPosition;
+    };
+
+    /// Фильтры корней по wd корня. Поток чтения берёт снимок таблицы без блокировок
+    using Filters = std::unordered_map<int, std::shared_ptr<const NameFilter> >;
+
+    /// Публикует таблицу фильтров по текущим m_roots
+    void publishFilters();
+
+    [[nodiscard]] static const NameFilter *filterFor(const Filters &filters, int rootWd);
+
+    void watchLoop();
+
+    /// Параллельно читает содержимое директорий, ставит watch на поддиректории рекурсивных
+    /// и, если снимок включён, кладёт содержимое в SnapshotIndex
+    void snapshotDirectories(std::vector<ScanTask> roots);
+
+    /// Ставит watch на поддиректорию path директории parent (parentWd) от имени корня rootWd.
+    /// Возвращает wd, если поддиректорию нужно обойти дальше, иначе -1
+    int addSubdirectoryWatch(int parentWd, const WatchIndex::Entry &parent, const std::filesystem::path &path,
+                             int rootWd, bool revisit = false);
+
+    /// Ставит watch на только что созданную директорию и всё, что успело появиться внутри
+    void watchCreatedSubtree(int parentWd, const WatchIndex::Entry &parent, const std::filesystem::path &directory);
+
+    /// Передаёт watch, принадлежащие корням-ключам, новому владельцу-значению. Владелец -1 - снять watch,
+    /// кроме перечисленных в keep
+    void releaseSubtrees(const std::unordered_map<int, int> &newOwners, const std::unordered_set<int> &keep);
+
+    /// Ближайший рекурсивный корень выше path
+    [[nodiscard]] const Root *coveringRoot(const std::filesystem::path &path) const;
+
+    /// Файл ушёл из-под наблюдения этого шарда: ставит MOVED_OUT на место IN_MOVED_FROM в m_batch,
+    /// убирает перемещение из m_pendingMoves и забывает поддерево директории
+    void expireMove(std::size_t index);
+
+    /// Перед событием о том же имени: иначе оно обогнало бы ещё не опубликованный MOVED_OUT
+    void expireMovesOf(std::uint32_t directoryId, std::string_view name);
+
+    /// Публикует перемещения, пара к которым не пришла за MOVE_TIMEOUT
+    void expireMoves();
+
+    /// Снимает watch с перемещённой директории name из parentId и её поддиректорий, кроме корней из конфига.
+    /// После перемещения их wd указывают на старые пути
+    void forgetSubtree(std::uint32_t parentId, std::string_view name);
+
+    /// Снимает watch, уже удалённый из m_watchIndex, и отпускает запись директории в DirectoryRegistry
+    void unwatch(int wd, std::uint32_t directoryId);
+
+    void clearFds();
+
+    /// Регистрирует inotify в Reactor для чтения через read
+    bool watchInotify();
+
+    /// Истекшие перемещения, порция пересканирования и освобождение старых таблиц WatchIndex.
+    /// Вызывается после каждого обработчика Reactor
+    void runDeferred();
+
+    /// Взводит таймер на ближайший срок отложенных пересканирования и перемещений
+    void armDeadline();
+
+    void drainEvents();
+
+    /// Разбирает прочитанные из inotify события. Возвращает true, если среди них было IN_Q_OVERFLOW
+    bool handleEvents(const char *data, long length, std::int64_t readStart, const Filters &filters);
+
+    /// Создаёт кольцо io_uring с буферами для inotify. При неудаче остаётся чтение через epoll
+    void setupRing();
+
+    /// Закрывает кольцо и возвращает inotify в Reactor
+    void dropRing();
+
+    /// Ставит многократное чтение inotify. Ядро само кладёт каждую порцию событий в свободный буфер кольца
+    bool armRingRead();
+
+    /// Разбирает завершения чтения из кольца
+    void drainRing();
+
+    void publishBatch();
+
+    /// События потеряны ядром: ставит все наблюдаемые директории в очередь на пересканирование
+    void scheduleRescan();
+
+    /// Сверяет с диском очередную порцию директорий из очереди пересканирования. Без снимка
+    /// только ставит watch на поддиректории, созданные во время переполнения
+    void rescanStep();
+
+    /// Размер буфера чтения inotify: в один read помещаются сотни событий
+    static constexpr std::size_t READ_BUFFER_SIZE = 64 * 1024;
+    /// Буферы кольца io_uring: каждое завершение многократного чтения занимает один
+    static constexpr std::uint16_t RING_BUFFERS = 16;
+    static constexpr std::uint32_t RING_BUFFER_SIZE = 16 * 1024;
+    static constexpr std::uint16_t RING_BUFFER_GROUP = 0;
+    /// Ограничение размера пачки, чтобы при непрерывном потоке событий потребитель не ждал слишком долго
+    static constexpr std::size_t MAX_BATCH_EVENTS = 4096;
+
+    /// Ядро кладёт IN_MOVED_FROM и IN_MOVED_TO одного rename подряд, ожидание нужно только на стыке двух read
+    static constexpr std::chrono::milliseconds MOVE_TIMEOUT{50};
+    /// Сверх этого старейшие непарные перемещения публикуются как MOVED_OUT досрочно
+    static constexpr std::size_t MAX_PENDING_MOVES = 256;
+
+    /// Пересканирование начинается, когда переполнения прекратились на это время
+    static constexpr std::chrono::milliseconds RESCAN_DELAY{200};
+    /// Пауза между порциями пересканирования, чтобы не занимать поток чтения событий надолго
+    static constexpr std::chrono::milliseconds RESCAN_INTERVAL{20};
+    static constexpr std::size_t RESCAN_DIRECTORIES_PER_STEP = 64;
+
+    const std::size_t m_index;
+    const Publisher m_publisher;
+    const std::optional<unsigned> m_cpu;
+    const std::uint32_t m_watchMask;
+    const bool m_useIoUring;
+    const bool m_snapshot;
+    Metrics &m_metrics;
+    EventTrace &m_trace;
+    /// Корни по нормализованному пути. Меняются только из addPaths, removePaths, setRecursive и setFilter
+    std::unordered_map<std::string, Root> m_roots;
+    std::atomic<std::shared_ptr<const Filters> > m_filters{std::make_shared<const Filters>()};
+    Reactor m_reactor;
+    /// Срок ближайшего отложенного действия, см. armDeadline
+    int m_deadlineTimer = -1;
+    std::thread m_watchThread;
+    std::atomic<int> m_inotifyFd;
+    /// Кольцо потока чтения, nullptr - события читаются через Reactor и read
+    std::unique_ptr<IoUring> m_ring;
+    WatchIndex m_watchIndex;
+    SnapshotIndex &m_snapshotIndex;
+    /// Очередь пересканирования, используется только потоком чтения событий
+    std::deque<int> m_rescanQueue;
+    std::chrono::steady_clock::time_point m_rescanNotBefore;
+    std::size_t m_rescanDifferences = 0;
+    /// Непарные IN_MOVED_FROM в порядке поступления, используются только потоком чтения событий
+    std::deque<PendingMove> m_pendingMoves;
+    std::vector<Message> m_batch;
+    alignas(inotify_event) char m_readBuffer[READ_BUFFER_SIZE];
+};
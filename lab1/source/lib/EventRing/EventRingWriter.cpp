@@ -0,0 +1,159 @@
+#include "EventRingWriter.h"
+
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <format>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <disk_monitor/EventRingFormat.h>
+
+#include "Logger/SystemLogger.h"
+#include "Paths/DirectoryRegistry.h"
+
+using namespace event_ring;
+
+EventRingWriter::EventRingWriter(std::filesystem::path path, const std::uint64_t capacity)
+    : m_path{std::move(path)},
+      m_capacity{std::bit_ceil(std::max(capacity, MIN_CAPACITY))} {
+    // Новое кольцо создаётся рядом и переименовывается поверх старого: читатели старого файла
+    // дочитывают его до конца, видят closed и открывают заново
+    const auto temporary = std::filesystem::path{m_path}.concat(".tmp");
+    const int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        SystemLogger::instance().error(std::format("Cannot create event ring {}: {}", temporary.string(),
+                                                   std::strerror(errno)));
+        return;
+    }
+    m_size = HEADER_SIZE + m_capacity;
+    void *address = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(m_size)) == 0) {
+        address = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (address == MAP_FAILED) {
+        SystemLogger::instance().error(std::format("Cannot map event ring {}: {}", temporary.string(),
+                                                   std::strerror(errno)));
+        unlink(temporary.c_str());
+        return;
+    }
+
+    // Файл только что обрезан до нуля и заполнен нулями, атомарные поля уже в начальном состоянии
+    m_header = static_cast<Header *>(address);
+    m_data = static_cast<char *>(address) + HEADER_SIZE;
+    m_header->version = VERSION;
+    m_header->headerSize = HEADER_SIZE;
+    m_header->capacity = m_capacity;
+    std::memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+    if (rename(temporary.c_str(), m_path.c_str()) < 0) {
+        SystemLogger::instance().error(std::format("Cannot publish event ring {}: {}", m_path.string(),
+                                                   std::strerror(errno)));
+        munmap(address, m_size);
+        m_header = nullptr;
+        unlink(temporary.c_str());
+        return;
+    }
+    SystemLogger::instance().info(std::format("Publishing events to ring {} ({} MiB)", m_path.string(),
+                                              m_capacity >> 20));
+}
+
+EventRingWriter::~EventRingWriter() {
+    if (!m_header) {
+        return;
+    }
+    // Сначала убираем файл: увидевший closed читатель не должен открыть его снова
+    unlink(m_path.c_str());
+    m_header->closed.store(1, std::memory_order_release);
+    // Уснувшие в ожидании читатели должны увидеть closed
+    m_published = true;
+    flush();
+    munmap(m_header, m_size);
+}
+
+void EventRingWriter::publish(const FileChangedInd &event, const std::int64_t timestampNs) {
+    const auto &registry = DirectoryRegistry::instance();
+    const auto path = (registry.path(event.directoryId) / event.fileName()).string();
+    std::string previousPath;
+    if (event.action == FileChangedInd::Action::RENAMED) {
+        previousPath = (registry.path(event.previousDirectoryId) / event.previousName()).string();
+    }
+    append(static_cast<std::uint8_t>(event.action), event.count, timestampNs, path, previousPath);
+}
+
+void EventRingWriter::flush() {
+    if (!m_published) {
+        return;
+    }
+    m_published = false;
+    m_header->wakeCounter.fetch_add(1, std::memory_order_release);
+    // Без FUTEX_PRIVATE_FLAG: читатели - другие процессы
+    syscall(SYS_futex, &m_header->wakeCounter, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+void EventRingWriter::append(const std::uint8_t action, const std::uint32_t count, const std::int64_t timestampNs,
+                             std::string_view path, std::string_view previousPath) {
+    path = path.substr(0, UINT16_MAX);
+    previousPath = previousPath.substr(0, UINT16_MAX);
+    const auto size = alignRecord(sizeof(RecordHeader) + path.size() + previousPath.size());
+
+    // Запись не переходит через конец области данных
+    const std::uint64_t offset = m_head & (m_capacity - 1);
+    const std::uint64_t padding = m_capacity - offset < size ? m_capacity - offset : 0;
+    reserve(m_head + padding + size);
+
+    if (padding >= sizeof(RecordHeader)) {
+        RecordHeader filler{};
+        filler.size = static_cast<std::uint32_t>(padding);
+        filler.action = PADDING_ACTION;
+        std::memcpy(m_data + offset, &filler, sizeof(filler));
+    }
+    m_head += padding;
+
+    RecordHeader record{};
+    record.sequence = m_nextSequence++;
+    record.timestampNs = timestampNs;
+    record.size = static_cast<std::uint32_t>(size);
+    record.count = count;
+    record.pathLength = static_cast<std::uint16_t>(path.size());
+    record.previousPathLength = static_cast<std::uint16_t>(previousPath.size());
+    record.action = action;
+    char *destination = m_data + (m_head & (m_capacity - 1));
+    std::memcpy(destination, &record, sizeof(record));
+    std::memcpy(destination + sizeof(record), path.data(), path.size());
+    std::memcpy(destination + sizeof(record) + path.size(), previousPath.data(), previousPath.size());
+    m_head += size;
+
+    const std::uint64_t version = m_header->publishVersion.load(std::memory_order_relaxed);
+    m_header->publishVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->nextSequence.store(m_nextSequence, std::memory_order_relaxed);
+    m_header->head.store(m_head, std::memory_order_release);
+    m_header->publishVersion.store(version + 2, std::memory_order_release);
+    m_published = true;
+}
+
+void EventRingWriter::reserve(const std::uint64_t end) {
+    bool moved = false;
+    while (m_tail + m_capacity < end) {
+        const std::uint64_t offset = m_tail & (m_capacity - 1);
+        if (m_capacity - offset < sizeof(RecordHeader)) {
+            m_tail += m_capacity - offset;
+        } else {
+            RecordHeader record;
+            std::memcpy(&record, m_data + offset, sizeof(record));
+            m_tail += record.size;
+        }
+        moved = true;
+    }
+    if (moved) {
+        m_header->tail.store(m_tail, std::memory_order_release);
+    }
+    // Читатель, скопировавший запись, сверяет reserved после копирования: до записи данных reserved
+    // должен стать видимым, иначе читатель примет наполовину перезаписанную запись за целую
+    m_header->reserved.store(end, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
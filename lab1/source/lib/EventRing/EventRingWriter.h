@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#include "Observer/Messages.h"
+
+namespace event_ring {
+    struct Header;
+}
+
+/// Пишет события в кольцо в разделяемой памяти (формат - disk_monitor/EventRingFormat.h), откуда их читают
+/// локальные потребители без системных вызовов на каждое событие. Используется только из потока DiskMonitor
+class EventRingWriter {
+public:
+    /// capacity - размер области данных, округляется вверх до степени двойки
+    EventRingWriter(std::filesystem::path path, std::uint64_t capacity);
+
+    ~EventRingWriter();
+
+    EventRingWriter(const EventRingWriter &) = delete;
+
+    EventRingWriter &operator=(const EventRingWriter &) = delete;
+
+    [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+
+    /// timestampNs - время с начала эпохи
+    void publish(const FileChangedInd &event, std::int64_t timestampNs);
+
+    /// Будит ждущих читателей. Вызывать после пачки publish: один системный вызов на пачку
+    void flush();
+
+private:
+    static constexpr std::uint64_t MIN_CAPACITY = 1 << 20;
+
+    void append(std::uint8_t action, std::uint32_t count, std::int64_t timestampNs, std::string_view path,
+                std::string_view previousPath);
+
+    /// Сдвигает tail за записи, которые будут перезаписаны до позиции end, и объявляет end в reserved
+    void reserve(std::uint64_t end);
+
+    std::filesystem::path m_path;
+    std::uint64_t m_capacity;
+    std::size_t m_size = 0;
+    event_ring::Header *m_header = nullptr;
+    char *m_data = nullptr;
+    /// Копии head и tail: в разделяемой памяти они только публикуются
+    std::uint64_t m_head = 0;
+    std::uint64_t m_tail = 0;
+    std::uint64_t m_nextSequence = 0;
+    /// После последнего flush были записи
+    bool m_published = false;
+};
@@ -0,0 +1,413 @@
+#include "NameFilter.h"
+
+#include <algorithm>
+#include <bitset>
+#include <deque>
+#include <format>
+#include <map>
+#include <stdexcept>
+
+namespace {
+    using ByteSet = std::bitset<256>;
+
+    struct PatternError : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+    /// Недетерминированный автомат Томпсона: у состояния либо переход по множеству байтов в next,
+    /// либо только эпсилон-переходы
+    class Nfa {
+    public:
+        struct State {
+            std::vector<int> epsilon;
+            ByteSet bytes;
+            int next = -1;
+            std::uint8_t accepting = 0;
+        };
+
+        /// Фрагмент с одним входом и одним выходом, у выхода ещё нет переходов
+        struct Fragment {
+            int start;
+            int end;
+        };
+
+        int addState() {
+            m_states.emplace_back();
+            return static_cast<int>(m_states.size() - 1);
+        }
+
+        void connect(const int from, const int to) { m_states[from].epsilon.push_back(to); }
+
+        Fragment bytes(const ByteSet &set) {
+            const int start = addState();
+            const int end = addState();
+            m_states[start].bytes = set;
+            m_states[start].next = end;
+            return {start, end};
+        }
+
+        Fragment empty() {
+            const int state = addState();
+            return {state, state};
+        }
+
+        Fragment concat(const Fragment first, const Fragment second) {
+            connect(first.end, second.start);
+            return {first.start, second.end};
+        }
+
+        Fragment alternate(const Fragment first, const Fragment second) {
+            const int start = addState();
+            const int end = addState();
+            connect(start, first.start);
+            connect(start, second.start);
+            connect(first.end, end);
+            connect(second.end, end);
+            return {start, end};
+        }
+
+        Fragment repeat(const Fragment fragment, const bool allowEmpty, const bool allowMany) {
+            const int start = addState();
+            const int end = addState();
+            connect(start, fragment.start);
+            connect(fragment.end, end);
+            if (allowEmpty) {
+                connect(start, end);
+            }
+            if (allowMany) {
+                connect(fragment.end, fragment.start);
+            }
+            return {start, end};
+        }
+
+        [[nodiscard]] std::vector<State> &states() { return m_states; }
+
+    private:
+        std::vector<State> m_states;
+    };
+
+    ByteSet singleByte(const unsigned char byte) {
+        ByteSet set;
+        set.set(byte);
+        return set;
+    }
+
+    /// Разбор шаблона одного синтаксиса в фрагмент автомата
+    class PatternParser {
+    public:
+        PatternParser(Nfa &nfa, const std::string_view pattern) : m_nfa{nfa}, m_pattern{pattern} {
+        }
+
+        Nfa::Fragment glob() {
+            auto fragment = m_nfa.empty();
+            while (!atEnd()) {
+                const char symbol = take();
+                Nfa::Fragment next{};
+                if (symbol == '*') {
+                    next = m_nfa.repeat(m_nfa.bytes(ByteSet{}.set()), true, true);
+                } else if (symbol == '?') {
+                    next = m_nfa.bytes(ByteSet{}.set());
+                } else if (symbol == '[') {
+                    next = m_nfa.bytes(byteClass());
+                } else if (symbol == '\\') {
+                    next = m_nfa.bytes(singleByte(takeEscaped()));
+                } else {
+                    next = m_nfa.bytes(singleByte(symbol));
+                }
+                fragment = m_nfa.concat(fragment, next);
+            }
+            return fragment;
+        }
+
+        Nfa::Fragment regex() {
+            // Совпадение всегда полное, поэтому якоря по краям ничего не меняют
+            if (!atEnd() && peek() == '^') {
+                take();
+            }
+            // $ экранирован, только если перед ним нечётное число обратных косых: в \\$ это якорь
+            if (m_pattern.size() > m_position && m_pattern.back() == '$') {
+                const auto body = m_pattern.substr(0, m_pattern.size() - 1);
+                const auto lastOther = body.find_last_not_of('\\');
+                const auto backslashes = body.size() - (lastOther == std::string_view::npos ? 0 : lastOther + 1);
+                if (backslashes % 2 == 0) {
+                    m_pattern.remove_suffix(1);
+                }
+            }
+            const auto fragment = alternation();
+            if (!atEnd()) {
+                fail("unmatched ')'");
+            }
+            return fragment;
+        }
+
+    private:
+        Nfa::Fragment alternation() {
+            auto fragment = sequence();
+            while (!atEnd() && peek() == '|') {
+                take();
+                fragment = m_nfa.alternate(fragment, sequence());
+            }
+            return fragment;
+        }
+
+        Nfa::Fragment sequence() {
+            auto fragment = m_nfa.empty();
+            while (!atEnd() && peek() != '|' && peek() != ')') {
+                fragment = m_nfa.concat(fragment, repetition());
+            }
+            return fragment;
+        }
+
+        Nfa::Fragment repetition() {
+            auto fragment = atom();
+            while (!atEnd()) {
+                if (peek() == '*') {
+                    fragment = m_nfa.repeat(fragment, true, true);
+                } else if (peek() == '+') {
+                    fragment = m_nfa.repeat(fragment, false, true);
+                } else if (peek() == '?') {
+                    fragment = m_nfa.repeat(fragment, true, false);
+                } else {
+                    break;
+                }
+                take();
+            }
+            return fragment;
+        }
+
+        Nfa::Fragment atom() {
+            const char symbol = take();
+            switch (symbol) {
+                case '(': {
+                    const auto fragment = alternation();
+                    if (atEnd() || take() != ')') {
+                        fail("missing ')'");
+                    }
+                    return fragment;
+                }
+                case '[':
+                    return m_nfa.bytes(byteClass());
+                case '.':
+                    return m_nfa.bytes(ByteSet{}.set());
+                case '\\':
+                    return m_nfa.bytes(escapeClass());
+                case '*':
+                case '+':
+                case '?':
+                    fail(std::format("nothing to repeat before '{}'", symbol));
+                default:
+                    return m_nfa.bytes(singleByte(symbol));
+            }
+        }
+
+        /// \d, \w, \s или экранированный символ
+        ByteSet escapeClass() {
+            const char symbol = takeEscaped();
+            ByteSet set;
+            const auto addRange = [&set](const unsigned char from, const unsigned char to) {
+                for (unsigned byte = from; byte <= to; ++byte) {
+                    set.set(byte);
+                }
+            };
+            switch (symbol) {
+                case 'd':
+                    addRange('0', '9');
+                    break;
+                case 'w':
+                    addRange('0', '9');
+                    addRange('a', 'z');
+                    addRange('A', 'Z');
+                    set.set('_');
+                    break;
+                case 's':
+                    for (const char space: {' ', '\t', '\n', '\r', '\f', '\v'}) {
+                        set.set(static_cast<unsigned char>(space));
+                    }
+                    break;
+                default:
+                    set.set(static_cast<unsigned char>(symbol));
+            }
+            return set;
+        }
+
+        /// Содержимое [...] после открывающей скобки: диапазоны, отрицание ! или ^, ] первым символом - литерал
+        ByteSet byteClass() {
+            ByteSet set;
+            bool negated = false;
+            if (!atEnd() && (peek() == '!' || peek() == '^')) {
+                take();
+                negated = true;
+            }
+            bool first = true;
+            while (true) {
+                if (atEnd()) {
+                    fail("missing ']'");
+                }
+                char from = take();
+                if (from == ']' && !first) {
+                    break;
+                }
+                first = false;
+                if (from == '\\') {
+                    from = takeEscaped();
+                }
+                char to = from;
+                if (m_position + 1 < m_pattern.size() && peek() == '-' && m_pattern[m_position + 1] != ']') {
+                    take();
+                    to = take();
+                    if (to == '\\') {
+                        to = takeEscaped();
+                    }
+                }
+                if (static_cast<unsigned char>(from) > static_cast<unsigned char>(to)) {
+                    fail(std::format("invalid range {}-{}", from, to));
+                }
+                for (unsigned byte = static_cast<unsigned char>(from); byte <= static_cast<unsigned char>(to); ++byte) {
+                    set.set(byte);
+                }
+            }
+            return negated ? ~set : set;
+        }
+
+        [[nodiscard]] bool atEnd() const { return m_position >= m_pattern.size(); }
+
+        [[nodiscard]] char peek() const { return m_pattern[m_position]; }
+
+        char take() { return m_pattern[m_position++]; }
+
+        char takeEscaped() {
+            if (atEnd()) {
+                fail("trailing '\\'");
+            }
+            return take();
+        }
+
+        [[noreturn]] void fail(const std::string &reason) const {
+            throw PatternError{std::format("{} at position {}", reason, m_position)};
+        }
+
+        Nfa &m_nfa;
+        std::string_view m_pattern;
+        std::size_t m_position = 0;
+    };
+
+    std::vector<int> closure(const std::vector<Nfa::State> &states, std::vector<int> set) {
+        std::vector<int> stack = set;
+        std::vector<bool> seen(states.size());
+        for (const int state: set) {
+            seen[state] = true;
+        }
+        while (!stack.empty()) {
+            const int state = stack.back();
+            stack.pop_back();
+            for (const int next: states[state].epsilon) {
+                if (!seen[next]) {
+                    seen[next] = true;
+                    set.push_back(next);
+                    stack.push_back(next);
+                }
+            }
+        }
+        std::ranges::sort(set);
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+        return set;
+    }
+}
+
+std::optional<NameFilter> NameFilter::compile(const std::vector<Pattern> &include, const std::vector<Pattern> &exclude,
+                                              std::string &error) {
+    Nfa nfa;
+    const int start = nfa.addState();
+    const auto addPatterns = [&](const std::vector<Pattern> &patterns, const std::uint8_t flag) {
+        for (const auto &pattern: patterns) {
+            try {
+                PatternParser parser{nfa, pattern.text};
+                const auto fragment = pattern.regex ? parser.regex() : parser.glob();
+                nfa.connect(start, fragment.start);
+                nfa.states()[fragment.end].accepting |= flag;
+            } catch (const PatternError &e) {
+                error = std::format("invalid {} \"{}\": {}", pattern.regex ? "regex" : "glob", pattern.text, e.what());
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!addPatterns(include, INCLUDED) || !addPatterns(exclude, EXCLUDED)) {
+        return std::nullopt;
+    }
+    const auto &states = nfa.states();
+
+    NameFilter filter;
+    filter.m_hasIncludes = !include.empty();
+
+    // Классы байтов: байты, входящие в одни и те же множества переходов, неразличимы для автомата
+    std::vector<const ByteSet *> sets;
+    for (const auto &state: states) {
+        if (state.next >= 0) {
+            sets.push_back(&state.bytes);
+        }
+    }
+    std::map<std::vector<bool>, std::uint8_t> classes;
+    std::vector<unsigned> representatives;
+    for (unsigned byte = 0; byte < 256; ++byte) {
+        std::vector<bool> signature(sets.size());
+        for (std::size_t i = 0; i < sets.size(); ++i) {
+            signature[i] = sets[i]->test(byte);
+        }
+        const auto [it, inserted] = classes.try_emplace(std::move(signature), classes.size());
+        if (inserted) {
+            representatives.push_back(byte);
+        }
+        filter.m_byteClasses[byte] = it->second;
+    }
+    filter.m_classesCount = representatives.size();
+
+    // Построение подмножеств. Состояние 0 - пустое множество, из него совпадений уже не будет
+    std::map<std::vector<int>, std::uint16_t> dfaStates{{{}, DEAD_STATE}};
+    std::deque<std::vector<int> > pending;
+    const auto addDfaState = [&](std::vector<int> set) -> std::optional<std::uint16_t> {
+        if (const auto it = dfaStates.find(set); it != dfaStates.end()) {
+            return it->second;
+        }
+        if (dfaStates.size() >= MAX_STATES) {
+            return std::nullopt;
+        }
+        const auto id = static_cast<std::uint16_t>(dfaStates.size());
+        std::uint8_t accepting = 0;
+        for (const int state: set) {
+            accepting |= states[state].accepting;
+        }
+        filter.m_accepting.push_back(accepting);
+        filter.m_transitions.resize(filter.m_transitions.size() + filter.m_classesCount, DEAD_STATE);
+        dfaStates.emplace(set, id);
+        pending.push_back(std::move(set));
+        return id;
+    };
+    filter.m_accepting.push_back(0);
+    filter.m_transitions.resize(filter.m_classesCount, DEAD_STATE);
+    addDfaState(closure(states, {start}));
+
+    while (!pending.empty()) {
+        const auto set = std::move(pending.front());
+        pending.pop_front();
+        const std::uint16_t from = dfaStates.at(set);
+        for (std::size_t byteClass = 0; byteClass < filter.m_classesCount; ++byteClass) {
+            std::vector<int> moved;
+            for (const int state: set) {
+                if (states[state].next >= 0 && states[state].bytes.test(representatives[byteClass])) {
+                    moved.push_back(states[state].next);
+                }
+            }
+            if (moved.empty()) {
+                continue;
+            }
+            const auto to = addDfaState(closure(states, std::move(moved)));
+            if (!to) {
+                error = std::format("patterns produce more than {} automaton states", MAX_STATES);
+                return std::nullopt;
+            }
+            filter.m_transitions[from * filter.m_classesCount + byteClass] = *to;
+        }
+    }
+    return filter;
+}
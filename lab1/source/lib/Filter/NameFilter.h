@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Правила include/exclude для имён файлов одной директории из конфига. Все шаблоны (glob и регулярные
+/// выражения) при загрузке конфига компилируются в один детерминированный автомат над байтами имени,
+/// поэтому проверка события - один проход по имени без выделения памяти, независимо от числа правил
+class NameFilter {
+public:
+    struct Pattern {
+        std::string text;
+        /// false - glob (*, ?, [...]), true - регулярное выражение (. [] * + ? | ( ) и \d \w \s)
+        bool regex = false;
+
+        bool operator==(const Pattern &) const = default;
+    };
+
+    /// nullopt и описание ошибки в error, если шаблон некорректен или автомат получился слишком большим
+    static std::optional<NameFilter> compile(const std::vector<Pattern> &include, const std::vector<Pattern> &exclude,
+                                             std::string &error);
+
+    /// Исключённые имена отбрасываются всегда, include ограничивает только файлы: директории обходятся,
+    /// даже если их имя не подходит под include
+    [[nodiscard]] bool accepts(const std::string_view name, const bool isDirectory) const {
+        const std::uint8_t flags = match(name);
+        if (flags & EXCLUDED) {
+            return false;
+        }
+        return isDirectory || !m_hasIncludes || (flags & INCLUDED);
+    }
+
+    [[nodiscard]] std::size_t states() const { return m_accepting.size(); }
+
+    static constexpr std::uint8_t INCLUDED = 1;
+    static constexpr std::uint8_t EXCLUDED = 2;
+    /// Ограничение размера автомата: переход хранится в 16 битах
+    static constexpr std::size_t MAX_STATES = 4096;
+
+private:
+    static constexpr std::uint16_t DEAD_STATE = 0;
+    static constexpr std::uint16_t START_STATE = 1;
+
+    NameFilter() = default;
+
+    [[nodiscard]] std::uint8_t match(const std::string_view name) const {
+        std::uint16_t state = START_STATE;
+        for (const char byte: name) {
+            state = m_transitions[state * m_classesCount + m_byteClasses[static_cast<std::uint8_t>(byte)]];
+            if (state == DEAD_STATE) {
+                return 0;
+            }
+        }
+        return m_accepting[state];
+    }
+
+    /// Байты, на которых автомат ведёт себя одинаково, объединены в классы: таблица переходов - состояния x классы
+    std::array<std::uint8_t, 256> m_byteClasses{};
+    std::size_t m_classesCount = 0;
+    std::vector<std::uint16_t> m_transitions;
+    /// Флаги INCLUDED/EXCLUDED принимающих состояний
+    std::vector<std::uint8_t> m_accepting;
+    bool m_hasIncludes = false;
+};
@@ -0,0 +1,216 @@
+#include "EventJournal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "Logger/SystemLogger.h"
+#include "Paths/DirectoryRegistry.h"
+
+namespace {
+    constexpr std::uint32_t UNKNOWN_ID = UINT32_MAX;
+
+    std::vector<std::pair<std::uint64_t, std::filesystem::path> > listSegments(const std::filesystem::path &directory) {
+        std::vector<std::pair<std::uint64_t, std::filesystem::path> > segments;
+        std::error_code ec;
+        for (const auto &entry: std::filesystem::directory_iterator{directory, ec}) {
+            const auto name = entry.path().filename().string();
+            if (!name.starts_with(journal::SEGMENT_PREFIX) || !name.ends_with(journal::SEGMENT_SUFFIX)) {
+                continue;
+            }
+            try {
+                segments.emplace_back(std::stoull(name.substr(std::strlen(journal::SEGMENT_PREFIX))), entry.path());
+            } catch (...) {
+            }
+        }
+        std::ranges::sort(segments);
+        return segments;
+    }
+}
+
+EventJournal::EventJournal(std::filesystem::path directory, const std::uint64_t segmentSize,
+                           const std::size_t maxSegments) : m_directory{std::move(directory)},
+                                                            m_segmentSize{
+                                                                std::max<std::uint64_t>(
+                                                                    segmentSize, MIN_SEGMENT_SIZE)
+                                                            },
+                                                            m_maxSegments{std::max<std::size_t>(maxSegments, 1)} {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec) {
+        SystemLogger::instance().error(std::format("Cannot create journal directory {}: {}", m_directory.string(),
+                                                   ec.message()));
+        return;
+    }
+
+    loadDirectories();
+    if (m_directoriesFd < 0) {
+        return;
+    }
+
+    const auto segments = listSegments(m_directory);
+    m_nextSegmentNumber = segments.empty() ? 0 : segments.back().first + 1;
+    openSegment();
+}
+
+EventJournal::~EventJournal() {
+    closeSegment();
+    if (m_directoriesFd >= 0) {
+        close(m_directoriesFd);
+    }
+}
+
+void EventJournal::loadDirectories() {
+    const auto path = m_directory / journal::DIRECTORIES_FILE;
+    m_directoriesFd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+    if (m_directoriesFd < 0) {
+        SystemLogger::instance().error(std::format("Cannot open {}: {}", path.string(), std::strerror(errno)));
+        return;
+    }
+
+    const off_t size = lseek(m_directoriesFd, 0, SEEK_END);
+    std::vector<char> content(static_cast<std::size_t>(std::max<off_t>(size, 0)));
+    if (!content.empty() && pread(m_directoriesFd, content.data(), content.size(), 0) != size) {
+        SystemLogger::instance().error(std::format("Cannot read {}: {}", path.string(), std::strerror(errno)));
+        return;
+    }
+
+    std::size_t offset = 0;
+    while (offset + sizeof(journal::DirectoryRecord) <= content.size()) {
+        journal::DirectoryRecord record{};
+        std::memcpy(&record, content.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (offset + record.pathLength > content.size()) {
+            break;
+        }
+        m_journalIds.emplace(std::string{content.data() + offset, record.pathLength}, record.directoryId);
+        offset += record.pathLength;
+    }
+}
+
+std::uint32_t EventJournal::journalDirectoryId(const std::uint32_t registryId) {
+    const auto &registry = DirectoryRegistry::instance();
+    const auto generation = registry.generation(registryId);
+    if (registryId < m_registryToJournal.size() && m_registryToJournal[registryId].journalId != UNKNOWN_ID &&
+        m_registryToJournal[registryId].generation == generation) {
+        return m_registryToJournal[registryId].journalId;
+    }
+    if (registryId >= m_registryToJournal.size()) {
+        m_registryToJournal.resize(registryId + 1, {0, UNKNOWN_ID});
+    }
+
+    const auto path = registry.path(registryId).string();
+    auto [it, inserted] = m_journalIds.try_emplace(path, static_cast<std::uint32_t>(m_journalIds.size()));
+    if (inserted) {
+        const journal::DirectoryRecord record{it->second, static_cast<std::uint32_t>(path.size())};
+        std::string buffer(reinterpret_cast<const char *>(&record), sizeof(record));
+        buffer.append(path);
+        // O_APPEND: запись одним вызовом не перемешается с другими
+        if (::write(m_directoriesFd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size())) {
+            SystemLogger::instance().error(std::format("Cannot write journal directory table: {}",
+                                                       std::strerror(errno)));
+        }
+    }
+    m_registryToJournal[registryId] = {generation, it->second};
+    return it->second;
+}
+
+bool EventJournal::openSegment() {
+    const auto path = m_directory / std::format("{}{:016}{}", journal::SEGMENT_PREFIX, m_nextSegmentNumber++,
+                                                journal::SEGMENT_SUFFIX);
+    m_segmentFd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (m_segmentFd < 0) {
+        SystemLogger::instance().error(std::format("Cannot create journal segment {}: {}", path.string(),
+                                                   std::strerror(errno)));
+        return false;
+    }
+    if (ftruncate(m_segmentFd, static_cast<off_t>(m_segmentSize)) < 0) {
+        SystemLogger::instance().error(std::format("Cannot allocate journal segment {}: {}", path.string(),
+                                                   std::strerror(errno)));
+        close(m_segmentFd);
+        m_segmentFd = -1;
+        return false;
+    }
+
+    void *mapped = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_segmentFd, 0);
+    if (mapped == MAP_FAILED) {
+        SystemLogger::instance().error(std::format("Cannot map journal segment {}: {}", path.string(),
+                                                   std::strerror(errno)));
+        close(m_segmentFd);
+        m_segmentFd = -1;
+        return false;
+    }
+
+    m_data = static_cast<char *>(mapped);
+    m_header = static_cast<journal::SegmentHeader *>(mapped);
+    std::memcpy(m_header->magic, journal::SEGMENT_MAGIC, sizeof(m_header->magic));
+    m_header->version = journal::VERSION;
+    m_header->capacity = m_segmentSize;
+    m_header->recordsEnd = sizeof(journal::SegmentHeader);
+
+    removeOldSegments();
+    return true;
+}
+
+void EventJournal::closeSegment() {
+    if (!m_header) {
+        return;
+    }
+    msync(m_data, m_header->recordsEnd, MS_ASYNC);
+    munmap(m_data, m_segmentSize);
+    close(m_segmentFd);
+    m_header = nullptr;
+    m_data = nullptr;
+    m_segmentFd = -1;
+}
+
+void EventJournal::removeOldSegments() const {
+    const auto segments = listSegments(m_directory);
+    if (segments.size() <= m_maxSegments) {
+        return;
+    }
+    for (std::size_t i = 0; i < segments.size() - m_maxSegments; ++i) {
+        std::error_code ec;
+        std::filesystem::remove(segments[i].second, ec);
+    }
+}
+
+void EventJournal::append(const FileChangedInd &event, const std::int64_t timestampNs) {
+    if (!m_header) {
+        return;
+    }
+
+    const std::uint64_t size = journal::alignRecord(sizeof(journal::RecordHeader) + event.nameLength +
+                                                    event.previousNameLength);
+    if (m_header->recordsEnd + size > m_header->capacity) {
+        closeSegment();
+        if (!openSegment()) {
+            return;
+        }
+    }
+
+    const journal::RecordHeader record{
+        timestampNs, journalDirectoryId(event.directoryId), event.count, static_cast<std::uint8_t>(event.action),
+        event.nameLength, event.previousNameLength, 0,
+        event.previousNameLength ? journalDirectoryId(event.previousDirectoryId) : 0
+    };
+    const std::uint64_t offset = m_header->recordsEnd;
+    std::memcpy(m_data + offset, &record, sizeof(record));
+    const auto names = event.names();
+    std::memcpy(m_data + offset + sizeof(record), names.data(), names.size());
+
+    if (m_header->recordCount % journal::INDEX_INTERVAL == 0 && m_header->indexCount < journal::MAX_INDEX_ENTRIES) {
+        m_header->index[m_header->indexCount++] = {timestampNs, offset};
+    }
+    if (m_header->recordCount == 0) {
+        m_header->firstTimestampNs = timestampNs;
+    }
+    m_header->lastTimestampNs = timestampNs;
+    ++m_header->recordCount;
+    // Конец записей сдвигается последним: читатель видит только целые записи
+    std::atomic_ref{m_header->recordsEnd}.store(offset + size, std::memory_order_release);
+}
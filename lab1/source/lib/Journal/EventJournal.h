@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "JournalFormat.h"
+#include "Observer/Messages.h"
+
+/// Журнал событий в отображённых в память сегментах. Пишется только из потока DiskMonitor
+class EventJournal {
+public:
+    EventJournal(std::filesystem::path directory, std::uint64_t segmentSize, std::size_t maxSegments);
+
+    ~EventJournal();
+
+    EventJournal(const EventJournal &) = delete;
+
+    EventJournal &operator=(const EventJournal &) = delete;
+
+    [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+
+    [[nodiscard]] const std::filesystem::path &directory() const { return m_directory; }
+
+    void append(const FileChangedInd &event, std::int64_t timestampNs);
+
+private:
+    static constexpr std::uint64_t MIN_SEGMENT_SIZE = sizeof(journal::SegmentHeader) + (1 << 20);
+
+    bool openSegment();
+
+    void closeSegment();
+
+    void removeOldSegments() const;
+
+    void loadDirectories();
+
+    /// Идентификатор директории внутри журнала: идентификаторы DirectoryRegistry не переживают перезапуск
+    std::uint32_t journalDirectoryId(std::uint32_t registryId);
+
+    std::filesystem::path m_directory;
+    std::uint64_t m_segmentSize;
+    std::size_t m_maxSegments;
+    std::uint64_t m_nextSegmentNumber = 0;
+
+    int m_segmentFd = -1;
+    journal::SegmentHeader *m_header = nullptr;
+    char *m_data = nullptr;
+
+    int m_directoriesFd = -1;
+    std::unordered_map<std::string, std::uint32_t> m_journalIds;
+
+    struct JournalDirectory {
+        /// DirectoryRegistry::generation: идентификатор реестра мог перейти к другой директории
+        std::uint16_t generation = 0;
+        std::uint32_t journalId;
+    };
+
+    /// По идентификатору реестра. Реестр переиспользует идентификаторы, поэтому размер ограничен числом
+    /// директорий, наблюдаемых одновременно, а не всех, что когда-либо наблюдались
+    std::vector<JournalDirectory> m_registryToJournal;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+
+/// Формат бинарного журнала событий. Журнал - директория с сегментами segment-<номер>.dmj
+/// и таблицей директорий directories.dmd. Все числа - в порядке байт хоста
+namespace journal {
+    inline constexpr char SEGMENT_MAGIC[8] = {'D', 'M', 'J', 'R', 'N', 'L', '1', '\0'};
+    inline constexpr char DIRECTORIES_FILE[] = "directories.dmd";
+    inline constexpr char SEGMENT_PREFIX[] = "segment-";
+    inline constexpr char SEGMENT_SUFFIX[] = ".dmj";
+    inline constexpr std::uint32_t VERSION = 1;
+
+    /// Каждая INDEX_INTERVAL-я запись попадает в разреженный индекс по времени
+    inline constexpr std::uint32_t INDEX_INTERVAL = 256;
+    inline constexpr std::uint32_t MAX_INDEX_ENTRIES = 16384;
+
+    struct IndexEntry {
+        std::int64_t timestampNs;
+        std::uint64_t offset;
+    };
+
+    /// Сегмент: заголовок, индекс на MAX_INDEX_ENTRIES записей, затем записи до recordsEnd
+    struct SegmentHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t indexCount;
+        std::uint64_t capacity;
+        /// Смещение конца последней полностью записанной записи
+        std::uint64_t recordsEnd;
+        std::uint64_t recordCount;
+        std::int64_t firstTimestampNs;
+        std::int64_t lastTimestampNs;
+        IndexEntry index[MAX_INDEX_ENTRIES];
+    };
+
+    /// За заголовком записи следует имя длиной nameLength, для RENAMED за ним прежнее имя длиной
+    /// previousNameLength. Запись выровнена на 8 байт
+    struct RecordHeader {
+        std::int64_t timestampNs;
+        std::uint32_t directoryId;
+        std::uint32_t count;
+        std::uint8_t action;
+        std::uint8_t nameLength;
+        std::uint8_t previousNameLength;
+        std::uint8_t reserved;
+        std::uint32_t previousDirectoryId;
+    };
+
+    /// Запись таблицы директорий, за ней следует путь длиной pathLength
+    struct DirectoryRecord {
+        std::uint32_t directoryId;
+        std::uint32_t pathLength;
+    };
+
+    constexpr std::uint64_t alignRecord(const std::uint64_t size) {
+        return (size + 7) & ~std::uint64_t{7};
+    }
+
+    static_assert(sizeof(RecordHeader) == 24);
+}
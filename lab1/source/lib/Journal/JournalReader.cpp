@@ -0,0 +1,144 @@
+#include "JournalReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "JournalFormat.h"
+
+JournalReader::JournalReader(std::filesystem::path directory) : m_directory{std::move(directory)} {
+    loadDirectories();
+}
+
+void JournalReader::loadDirectories() {
+    std::ifstream file{m_directory / journal::DIRECTORIES_FILE, std::ios::binary};
+    const std::vector<char> content{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    std::size_t offset = 0;
+    while (offset + sizeof(journal::DirectoryRecord) <= content.size()) {
+        journal::DirectoryRecord record{};
+        std::memcpy(&record, content.data() + offset, sizeof(record));
+        offset += sizeof(record);
+        if (offset + record.pathLength > content.size()) {
+            break;
+        }
+        if (record.directoryId >= m_directories.size()) {
+            m_directories.resize(record.directoryId + 1);
+        }
+        m_directories[record.directoryId].assign(content.data() + offset, record.pathLength);
+        offset += record.pathLength;
+    }
+}
+
+std::vector<bool> JournalReader::matchDirectories(const std::filesystem::path &prefix) const {
+    std::string prefixString = prefix.lexically_normal().string();
+    while (prefixString.size() > 1 && prefixString.ends_with('/')) {
+        prefixString.pop_back();
+    }
+
+    std::vector<bool> result(m_directories.size());
+    for (std::size_t id = 0; id < m_directories.size(); ++id) {
+        const auto &directory = m_directories[id];
+        result[id] = prefixString.empty() || prefixString == "/" || directory == prefixString ||
+                     (directory.starts_with(prefixString) && directory[prefixString.size()] == '/');
+    }
+    return result;
+}
+
+void JournalReader::query(const std::int64_t fromNs, const std::int64_t toNs, const std::filesystem::path &prefix,
+                          const std::function<void(const Record &)> &callback) const {
+    const auto directories = matchDirectories(prefix);
+    if (std::ranges::find(directories, true) == directories.end()) {
+        return;
+    }
+
+    std::vector<std::filesystem::path> segments;
+    std::error_code ec;
+    for (const auto &entry: std::filesystem::directory_iterator{m_directory, ec}) {
+        const auto name = entry.path().filename().string();
+        if (name.starts_with(journal::SEGMENT_PREFIX) && name.ends_with(journal::SEGMENT_SUFFIX)) {
+            segments.push_back(entry.path());
+        }
+    }
+    // Номер сегмента дополнен нулями, поэтому лексикографический порядок совпадает с хронологическим
+    std::ranges::sort(segments);
+
+    for (const auto &segment: segments) {
+        querySegment(segment, fromNs, toNs, directories, callback);
+    }
+}
+
+void JournalReader::querySegment(const std::filesystem::path &segment, const std::int64_t fromNs,
+                                 const std::int64_t toNs, const std::vector<bool> &directories,
+                                 const std::function<void(const Record &)> &callback) const {
+    const int fd = open(segment.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat status{};
+    if (fstat(fd, &status) < 0 || static_cast<std::size_t>(status.st_size) < sizeof(journal::SegmentHeader)) {
+        close(fd);
+        return;
+    }
+    const auto size = static_cast<std::size_t>(status.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return;
+    }
+
+    const auto *data = static_cast<const char *>(mapped);
+    const auto *header = static_cast<const journal::SegmentHeader *>(mapped);
+    // Сегмент может дописываться прямо сейчас: конец записей читается атомарно
+    const std::uint64_t recordsEnd = std::min<std::uint64_t>(
+        std::atomic_ref{const_cast<std::uint64_t &>(header->recordsEnd)}.load(std::memory_order_acquire), size);
+
+    const bool valid = std::memcmp(header->magic, journal::SEGMENT_MAGIC, sizeof(header->magic)) == 0 &&
+                       header->version == journal::VERSION;
+    const bool overlaps = header->recordCount > 0 && header->lastTimestampNs >= fromNs &&
+                          header->firstTimestampNs <= toNs;
+
+    if (valid && overlaps) {
+        const auto *indexBegin = header->index;
+        const auto *indexEnd = header->index + std::min(header->indexCount, journal::MAX_INDEX_ENTRIES);
+        const auto *indexIt = std::upper_bound(indexBegin, indexEnd, fromNs,
+                                               [](const std::int64_t time, const journal::IndexEntry &entry) {
+                                                   return time < entry.timestampNs;
+                                               });
+        std::uint64_t offset = indexIt == indexBegin ? sizeof(journal::SegmentHeader) : (indexIt - 1)->offset;
+
+        while (offset + sizeof(journal::RecordHeader) <= recordsEnd) {
+            journal::RecordHeader record{};
+            std::memcpy(&record, data + offset, sizeof(record));
+            const std::uint64_t next = offset + journal::alignRecord(
+                                           sizeof(record) + record.nameLength + record.previousNameLength);
+            if (next > recordsEnd || record.timestampNs > toNs) {
+                break;
+            }
+            const bool hasPrevious = record.previousNameLength && record.previousDirectoryId < directories.size();
+            const auto matches = [&directories](const std::uint32_t directoryId) {
+                return directoryId < directories.size() && directories[directoryId];
+            };
+            if (record.timestampNs >= fromNs && record.directoryId < directories.size() &&
+                (matches(record.directoryId) || (hasPrevious && matches(record.previousDirectoryId)))) {
+                const auto *name = data + offset + sizeof(record);
+                callback(Record{
+                    record.timestampNs, m_directories[record.directoryId],
+                    std::string_view{name, record.nameLength},
+                    static_cast<FileChangedInd::Action>(record.action), record.count,
+                    hasPrevious ? &m_directories[record.previousDirectoryId] : nullptr,
+                    std::string_view{name + record.nameLength, hasPrevious ? record.previousNameLength : 0u}
+                });
+            }
+            offset = next;
+        }
+    }
+
+    munmap(mapped, size);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Observer/Messages.h"
+
+/// Чтение журнала событий через mmap без разбора текста. Используется утилитой disk_monitor_query
+class JournalReader {
+public:
+    struct Record {
+        std::int64_t timestampNs;
+        const std::string &directory;
+        std::string_view fileName;
+        FileChangedInd::Action action;
+        std::uint32_t count;
+        /// Прежнее расположение для RENAMED, иначе nullptr и пустое имя
+        const std::string *previousDirectory;
+        std::string_view previousName;
+    };
+
+    explicit JournalReader(std::filesystem::path directory);
+
+    /// Перебирает записи с временем в [fromNs, toNs] в директориях, лежащих внутри prefix (пустой - все).
+    /// RENAMED попадает в выборку, если внутри prefix лежит новое или прежнее расположение
+    void query(std::int64_t fromNs, std::int64_t toNs, const std::filesystem::path &prefix,
+               const std::function<void(const Record &)> &callback) const;
+
+private:
+    void loadDirectories();
+
+    /// Маска интересующих директорий по идентификатору журнала
+    [[nodiscard]] std::vector<bool> matchDirectories(const std::filesystem::path &prefix) const;
+
+    void querySegment(const std::filesystem::path &segment, std::int64_t fromNs, std::int64_t toNs,
+                      const std::vector<bool> &directories, const std::function<void(const Record &)> &callback) const;
+
+    std::filesystem::path m_directory;
+    std::vector<std::string> m_directories;
+};
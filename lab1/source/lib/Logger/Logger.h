@@ -6,6 +6,7 @@ public:
     virtual ~Logger() = default;
 
     enum LogLevel {
+        DEBUG,
         INFO,
         WARNING,
         ERROR
@@ -13,6 +14,11 @@ public:
 
     virtual void log(LogLevel level, const std::string &message, int scope) = 0;
 
+    /// Позволяет не форматировать сообщение, которое всё равно будет отброшено
+    [[nodiscard]] virtual bool isEnabled(LogLevel) const { return true; }
+
+    virtual void debug(const std::string &message, int scope) { log(DEBUG, message, scope); }
+
     virtual void info(const std::string &message, int scope) { log(INFO, message, scope); }
 
     virtual void warn(const std::string &message, int scope) { log(WARNING, message, scope); }
@@ -1,43 +1,456 @@
 #include "SystemLogger.h"
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
 #include <sys/syslog.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 
-SystemLogger::SystemLogger(std::string name) : m_name{std::move(name)} {
+namespace {
+    std::atomic<std::uint64_t> loggerGeneration{0};
+
+    int toPriority(const Logger::LogLevel level) {
+        switch (level) {
+            case Logger::INFO:
+                return LOG_INFO;
+            case Logger::WARNING:
+                return LOG_WARNING;
+            case Logger::ERROR:
+                return LOG_ERR;
+            default:
+                return LOG_DEBUG;
+        }
+    }
+
+    std::string formatTime(const std::chrono::system_clock::time_point time, const char *format) {
+        const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+        std::tm local{};
+        localtime_r(&seconds, &local);
+        char buffer[64];
+        const std::size_t length = std::strftime(buffer, sizeof(buffer), format, &local);
+        return {buffer, length};
+    }
+
+    const char *levelName(const int priority) {
+        switch (LOG_PRI(priority)) {
+            case LOG_ERR:
+                return "ERROR";
+            case LOG_WARNING:
+                return "WARNING";
+            case LOG_INFO:
+                return "INFO";
+            default:
+                return "DEBUG";
+        }
+    }
+
+    /// Пропускает уже записанные written байт
+    void advance(iovec *&iov, std::size_t &count, std::size_t written) {
+        while (count > 0 && written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --count;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    /// writev с дозаписью при частичной записи
+    bool writeAll(const int fd, iovec *iov, std::size_t count) {
+        while (count > 0) {
+            const ssize_t written = writev(fd, iov, static_cast<int>(std::min<std::size_t>(count, IOV_MAX)));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            advance(iov, count, static_cast<std::size_t>(written));
+        }
+        return true;
+    }
+}
+
+SystemLogger::SystemLogger(std::string name) : m_name{std::move(name)}, m_generation{++loggerGeneration} {
     openlog(m_name.c_str(), LOG_PID | LOG_NDELAY, LOG_DAEMON);
 }
 
+SystemLogger::~SystemLogger() {
+    stopWriter();
+    closelog();
+}
+
+void SystemLogger::configure(const Mode mode, const LogLevel minLevel, std::filesystem::path filePath,
+                             const bool ioUring) {
+    m_minLevel.store(minLevel, std::memory_order_relaxed);
+    if (mode == m_mode.load() && filePath == m_filePath && ioUring == m_ioUring) {
+        return;
+    }
+
+    stopWriter();
+    m_filePath = std::move(filePath);
+    m_ioUring = ioUring;
+    m_mode.store(mode);
+    if (mode != Mode::SYNC) {
+        startWriter();
+    }
+}
+
 void SystemLogger::log(const LogLevel level, const std::string &message, const int scope) {
-    int priority;
-    switch (level) {
-        case INFO:
-            priority = LOG_INFO;
-            break;
-        case WARNING:
-            priority = LOG_WARNING;
-            break;
-        case ERROR:
-            priority = LOG_ERR;
-            break;
-        default:
-            priority = LOG_DEBUG;
-            break;
+    if (!isEnabled(level)) {
+        return;
     }
 
     int priorityScoped;
     switch (scope) {
         case SystemLogger::SYSTEM:
-            priorityScoped = priority | LOG_DAEMON;
+            priorityScoped = toPriority(level) | LOG_DAEMON;
             break;
         case SystemLogger::LOCAL0:
-            priorityScoped = priority | LOG_LOCAL0;
+            priorityScoped = toPriority(level) | LOG_LOCAL0;
             break;
         default:
-            priorityScoped = priority | LOG_DAEMON;
+            priorityScoped = toPriority(level) | LOG_DAEMON;
             break;
     }
-    syslog(priorityScoped, "%s", message.c_str());
+
+    if (m_mode.load(std::memory_order_relaxed) == Mode::SYNC) {
+        syslog(priorityScoped, "%s", message.c_str());
+        return;
+    }
+
+    auto &buffer = threadBuffer();
+    bool wakeup;
+    {
+        std::lock_guard lock{buffer.mutex};
+        if (buffer.records.size() >= MAX_THREAD_RECORDS) {
+            ++buffer.dropped;
+            return;
+        }
+        // Номер берётся под мьютексом буфера: писатель, заблокировав буфер, видит все записи с меньшими номерами
+        buffer.records.push_back({
+            m_sequence.fetch_add(1, std::memory_order_relaxed), std::chrono::system_clock::now(), priorityScoped,
+            message
+        });
+        wakeup = buffer.records.size() == WAKEUP_THRESHOLD;
+    }
+    if (wakeup) {
+        std::lock_guard lock{m_writerMutex};
+        m_wakeupRequested = true;
+        m_writerCv.notify_one();
+    }
 }
 
-SystemLogger::~SystemLogger() {
-    closelog();
+void SystemLogger::flush() {
+    std::unique_lock lock{m_writerMutex};
+    if (!m_writerRunning) {
+        return;
+    }
+    const std::uint64_t target = m_sequence.load();
+    m_wakeupRequested = true;
+    m_writerCv.notify_one();
+    m_flushedCv.wait(lock, [&] { return m_flushedSequence >= target || !m_writerRunning; });
+}
+
+SystemLogger::ThreadBuffer &SystemLogger::threadBuffer() {
+    thread_local struct {
+        std::shared_ptr<ThreadBuffer> buffer;
+        std::uint64_t generation = 0;
+    } local;
+
+    if (!local.buffer || local.generation != m_generation) {
+        local.buffer = std::make_shared<ThreadBuffer>();
+        local.generation = m_generation;
+        std::lock_guard lock{m_buffersMutex};
+        m_buffers.push_back(local.buffer);
+    }
+    return *local.buffer;
+}
+
+void SystemLogger::startWriter() {
+    m_pid = getpid();
+
+    if (m_mode == Mode::ASYNC_FILE) {
+        m_fileFd = open(m_filePath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0640);
+        if (m_fileFd < 0) {
+            syslog(LOG_ERR | LOG_DAEMON, "Cannot open log file %s: %s", m_filePath.c_str(), std::strerror(errno));
+        } else if (m_ioUring && !(m_ring = IoUring::create(RING_ENTRIES))) {
+            syslog(LOG_WARNING | LOG_DAEMON, "io_uring is unavailable (%s), writing log file via writev",
+                   std::strerror(errno));
+        }
+    } else {
+        m_syslogFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, "/dev/log", sizeof(address.sun_path) - 1);
+        if (m_syslogFd >= 0 && connect(m_syslogFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+            syslog(LOG_ERR | LOG_DAEMON, "Cannot connect to /dev/log: %s", std::strerror(errno));
+            close(m_syslogFd);
+            m_syslogFd = -1;
+        }
+    }
+
+    std::lock_guard lock{m_writerMutex};
+    m_writerRunning = true;
+    m_writerThread = std::thread{&SystemLogger::writerLoop, this};
+}
+
+void SystemLogger::stopWriter() {
+    {
+        std::lock_guard lock{m_writerMutex};
+        if (!m_writerRunning) {
+            return;
+        }
+        m_writerRunning = false;
+    }
+    m_writerCv.notify_one();
+    m_writerThread.join();
+
+    // Записи, попавшие в буферы во время остановки
+    auto records = collect();
+    write(records);
+
+    m_ring.reset();
+    if (m_fileFd >= 0) {
+        close(m_fileFd);
+        m_fileFd = -1;
+    }
+    if (m_syslogFd >= 0) {
+        close(m_syslogFd);
+        m_syslogFd = -1;
+    }
+}
+
+void SystemLogger::writerLoop() {
+    std::unique_lock lock{m_writerMutex};
+    while (true) {
+        m_writerCv.wait_for(lock, FLUSH_INTERVAL, [this] { return m_wakeupRequested || !m_writerRunning; });
+        const bool running = m_writerRunning;
+        m_wakeupRequested = false;
+        const std::uint64_t target = m_sequence.load();
+        lock.unlock();
+
+        auto records = collect();
+        write(records);
+
+        lock.lock();
+        m_flushedSequence = std::max(m_flushedSequence, target);
+        m_flushedCv.notify_all();
+        if (!running) {
+            return;
+        }
+    }
+}
+
+std::vector<SystemLogger::Record> SystemLogger::collect() {
+    std::vector<Record> records;
+    std::uint64_t dropped = 0;
+    {
+        std::lock_guard buffersLock{m_buffersMutex};
+        for (const auto &buffer: m_buffers) {
+            std::lock_guard lock{buffer->mutex};
+            if (records.empty()) {
+                records.swap(buffer->records);
+            } else {
+                std::ranges::move(buffer->records, std::back_inserter(records));
+                buffer->records.clear();
+            }
+            dropped += std::exchange(buffer->dropped, 0);
+        }
+        // Буферы завершившихся потоков больше никто не пополнит
+        std::erase_if(m_buffers, [](const auto &buffer) { return buffer.use_count() == 1; });
+    }
+
+    std::ranges::sort(records, {}, &Record::sequence);
+    if (dropped) {
+        records.push_back({
+            0, std::chrono::system_clock::now(), LOG_WARNING | LOG_DAEMON,
+            std::format("Logger buffers overflowed, {} records dropped", dropped)
+        });
+    }
+    return records;
+}
+
+void SystemLogger::write(std::vector<Record> &records) {
+    if (records.empty()) {
+        return;
+    }
+    if (m_mode == Mode::ASYNC_FILE && m_fileFd >= 0) {
+        writeFile(records);
+    } else if (m_syslogFd >= 0) {
+        writeSyslog(records);
+    } else {
+        for (const auto &record: records) {
+            syslog(record.priority, "%s", record.message.c_str());
+        }
+    }
+}
+
+void SystemLogger::writeSyslog(const std::vector<Record> &records) {
+    constexpr std::size_t MAX_MESSAGES = 256;
+
+    std::vector<std::string> headers;
+    std::vector<iovec> iov;
+    std::vector<mmsghdr> messages;
+    headers.reserve(std::min(records.size(), MAX_MESSAGES));
+    iov.reserve(2 * std::min(records.size(), MAX_MESSAGES));
+    messages.reserve(std::min(records.size(), MAX_MESSAGES));
+
+    for (std::size_t begin = 0; begin < records.size(); begin += MAX_MESSAGES) {
+        const std::size_t end = std::min(records.size(), begin + MAX_MESSAGES);
+        headers.clear();
+        iov.clear();
+        messages.clear();
+
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto &record = records[i];
+            headers.push_back(std::format("<{}>{} {}[{}]: ", record.priority,
+                                          formatTime(record.time, "%b %e %H:%M:%S"), m_name, m_pid));
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            auto &header = headers[i - begin];
+            iov.push_back({header.data(), header.size()});
+            iov.push_back({const_cast<char *>(records[i].message.data()), records[i].message.size()});
+        }
+        for (std::size_t i = 0; i < end - begin; ++i) {
+            mmsghdr message{};
+            message.msg_hdr.msg_iov = &iov[2 * i];
+            message.msg_hdr.msg_iovlen = 2;
+            messages.push_back(message);
+        }
+
+        std::size_t sent = 0;
+        while (sent < messages.size()) {
+            const int result = sendmmsg(m_syslogFd, messages.data() + sent,
+                                        static_cast<unsigned>(messages.size() - sent), 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                // Сокет сломан (например, перезапустили rsyslog) - досылаем остаток через libc
+                for (std::size_t i = begin + sent; i < end; ++i) {
+                    syslog(records[i].priority, "%s", records[i].message.c_str());
+                }
+                break;
+            }
+            sent += static_cast<std::size_t>(result);
+        }
+    }
+}
+
+void SystemLogger::writeFile(const std::vector<Record> &records) {
+    std::vector<std::string> headers;
+    std::vector<iovec> iov;
+    headers.reserve(records.size());
+    iov.reserve(3 * records.size());
+
+    static constexpr char NEWLINE = '\n';
+    for (const auto &record: records) {
+        // В файл идут только события (LOCAL0), служебные сообщения остаются в системном журнале
+        if ((record.priority & LOG_FACMASK) != LOG_LOCAL0) {
+            syslog(record.priority, "%s", record.message.c_str());
+            continue;
+        }
+        headers.push_back(std::format("{} {}[{}] {}: ", formatTime(record.time, "%Y-%m-%d %H:%M:%S"), m_name,
+                                      m_pid, levelName(record.priority)));
+    }
+
+    std::size_t header = 0;
+    for (const auto &record: records) {
+        if ((record.priority & LOG_FACMASK) != LOG_LOCAL0) {
+            continue;
+        }
+        iov.push_back({headers[header].data(), headers[header].size()});
+        iov.push_back({const_cast<char *>(record.message.data()), record.message.size()});
+        iov.push_back({const_cast<char *>(&NEWLINE), 1});
+        ++header;
+    }
+
+    if (iov.empty()) {
+        return;
+    }
+    if (!(m_ring ? writeRing(iov.data(), iov.size()) : writeAll(m_fileFd, iov.data(), iov.size()))) {
+        syslog(LOG_ERR | LOG_DAEMON, "Cannot write to log file %s: %s", m_filePath.c_str(), std::strerror(errno));
+    }
+}
+
+bool SystemLogger::writeRing(iovec *iov, std::size_t count) {
+    std::array<std::size_t, RING_ENTRIES> chunkStart{}, expected{};
+    std::array<int, RING_ENTRIES> results{};
+
+    while (count > 0) {
+        unsigned chunks = 0;
+        std::size_t prepared = 0;
+        io_uring_sqe *previous = nullptr;
+        while (prepared < count && chunks < RING_ENTRIES) {
+            auto *sqe = m_ring->nextSqe();
+            if (!sqe) {
+                break;
+            }
+            const auto length = std::min<std::size_t>(count - prepared, IOV_MAX);
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->fd = m_fileFd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(iov + prepared);
+            sqe->len = static_cast<std::uint32_t>(length);
+            // Дозапись с текущей позиции, файл открыт с O_APPEND
+            sqe->off = static_cast<std::uint64_t>(-1);
+            sqe->user_data = chunks;
+            // Связь гарантирует порядок: следующая порция не начнётся, пока не закончилась предыдущая
+            if (previous) {
+                previous->flags |= IOSQE_IO_LINK;
+            }
+            previous = sqe;
+
+            chunkStart[chunks] = prepared;
+            expected[chunks] = 0;
+            for (std::size_t i = prepared; i < prepared + length; ++i) {
+                expected[chunks] += iov[i].iov_len;
+            }
+            ++chunks;
+            prepared += length;
+        }
+        if (!chunks || m_ring->submit(chunks) < 0) {
+            return writeAll(m_fileFd, iov, count);
+        }
+
+        unsigned completed = 0;
+        while (true) {
+            completed += m_ring->forEachCompletion([&](const io_uring_cqe &cqe) {
+                results[cqe.user_data] = cqe.res;
+            });
+            if (completed >= chunks) {
+                break;
+            }
+            if (m_ring->submit(chunks - completed) < 0) {
+                return false;
+            }
+        }
+
+        for (unsigned chunk = 0; chunk < chunks; ++chunk) {
+            if (results[chunk] >= 0 && static_cast<std::size_t>(results[chunk]) == expected[chunk]) {
+                continue;
+            }
+            // Короткая запись рвёт цепочку, следующие порции отменены: остаток пишется по старинке
+            if (results[chunk] < 0 && results[chunk] != -EINTR && results[chunk] != -EAGAIN) {
+                errno = -results[chunk];
+                return false;
+            }
+            iov += chunkStart[chunk];
+            count -= chunkStart[chunk];
+            advance(iov, count, static_cast<std::size_t>(std::max(results[chunk], 0)));
+            return writeAll(m_fileFd, iov, count);
+        }
+        iov += prepared;
+        count -= prepared;
+    }
+    return true;
 }
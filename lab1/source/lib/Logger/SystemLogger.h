@@ -1,6 +1,18 @@
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
 #include "Logger.h"
 #include "OnceInstantiated/OnceInstantiated.h"
+#include "Uring/IoUring.h"
 
 class SystemLogger : public Logger, public OnceInstantiated<SystemLogger> {
     friend class OnceInstantiated;
@@ -11,12 +23,40 @@ public:
         LOCAL0,
     };
 
+    enum class Mode {
+        /// syslog() на вызывающем потоке
+        SYNC,
+        /// Фоновый поток пачками отправляет записи в /dev/log через sendmmsg
+        ASYNC_SYSLOG,
+        /// Фоновый поток пачками дописывает записи в файл через writev или цепочку записей io_uring
+        ASYNC_FILE,
+    };
+
     ~SystemLogger() override;
 
+    /// Переключает режим работы. Вызывать после демонизации: фоновый поток не переживает fork.
+    /// ioUring - писать файл в режиме ASYNC_FILE через io_uring, если ядро его поддерживает
+    void configure(Mode mode, LogLevel minLevel, std::filesystem::path filePath = {}, bool ioUring = false);
+
     void log(LogLevel level, const std::string &message, int scope) override;
 
     void log(LogLevel level, const std::string &message) { log(level, message, SYSTEM); }
 
+    /// Форматирует сообщение только если уровень не отфильтрован
+    template<typename... Args>
+    void log(LogLevel level, int scope, std::format_string<Args...> format, Args &&... args) {
+        if (isEnabled(level)) {
+            log(level, std::format(format, std::forward<Args>(args)...), scope);
+        }
+    }
+
+    [[nodiscard]] bool isEnabled(LogLevel level) const override {
+        return level >= m_minLevel.load(std::memory_order_relaxed);
+    }
+
+    using Logger::debug;
+    void debug(const std::string &message) { log(DEBUG, message); }
+
     using Logger::info;
     void info(const std::string &message) { log(INFO, message); }
 
@@ -26,8 +66,77 @@ public:
     using Logger::error;
     void error(const std::string &message) { log(ERROR, message); }
 
+    /// Дожидается записи всего, что было залогировано до вызова
+    void flush();
+
 protected:
     explicit SystemLogger(std::string name);
 
     const std::string m_name;
+
+private:
+    struct Record {
+        std::uint64_t sequence;
+        std::chrono::system_clock::time_point time;
+        int priority;
+        std::string message;
+    };
+
+    /// Буфер одного потока. Мьютекс почти всегда свободен: его берёт только владелец и, раз в пачку, писатель
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Record> records;
+        std::uint64_t dropped = 0;
+    };
+
+    ThreadBuffer &threadBuffer();
+
+    void writerLoop();
+
+    void startWriter();
+
+    void stopWriter();
+
+    /// Забирает записи всех потоков, упорядоченные по номеру
+    std::vector<Record> collect();
+
+    void write(std::vector<Record> &records);
+
+    void writeSyslog(const std::vector<Record> &records);
+
+    void writeFile(const std::vector<Record> &records);
+
+    /// Пишет iov связанными IOSQE_IO_LINK порциями по IOV_MAX: вся пачка уходит одним io_uring_enter.
+    /// После короткой записи или ошибки остаток дописывается через writev
+    bool writeRing(iovec *iov, std::size_t count);
+
+    static constexpr std::size_t WAKEUP_THRESHOLD = 1024;
+    static constexpr std::size_t MAX_THREAD_RECORDS = 1 << 16;
+    static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds{100};
+    static constexpr unsigned RING_ENTRIES = 32;
+
+    std::atomic<LogLevel> m_minLevel{INFO};
+    std::atomic<Mode> m_mode{Mode::SYNC};
+    std::atomic<std::uint64_t> m_sequence{0};
+    /// Отличает буферы, зарегистрированные прошлым экземпляром логгера
+    const std::uint64_t m_generation;
+
+    std::mutex m_buffersMutex;
+    std::vector<std::shared_ptr<ThreadBuffer> > m_buffers;
+
+    std::mutex m_writerMutex;
+    std::condition_variable m_writerCv;
+    std::condition_variable m_flushedCv;
+    bool m_writerRunning = false;
+    bool m_wakeupRequested = false;
+    std::uint64_t m_flushedSequence = 0;
+    std::thread m_writerThread;
+
+    std::filesystem::path m_filePath;
+    int m_fileFd = -1;
+    bool m_ioUring = false;
+    /// Кольцо потока записи для режима ASYNC_FILE, nullptr - запись через writev
+    std::unique_ptr<IoUring> m_ring;
+    int m_syslogFd = -1;
+    pid_t m_pid = 0;
 };
@@ -0,0 +1,46 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/// Счётчик, разнесённый по нескольким кэш-линиям: потоки пишут каждый в свою ячейку
+/// и не делят кэш-линию, сумма считается только при снятии снимка
+class Counter {
+public:
+    void add(const std::uint64_t value = 1) {
+        m_shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t value() const {
+        std::uint64_t sum = 0;
+        for (const auto &shard: m_shards) {
+            sum += shard.value.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    static constexpr std::size_t SHARDS = 16;
+
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    static std::size_t shardIndex() {
+        static std::atomic<std::size_t> nextIndex{0};
+        thread_local const std::size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return index;
+    }
+
+    Shard m_shards[SHARDS];
+};
+
+/// Мгновенное значение, которое выставляет один поток
+class Gauge {
+public:
+    void set(const std::int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+
+    [[nodiscard]] std::int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    alignas(64) std::atomic<std::int64_t> m_value{0};
+};
@@ -0,0 +1,37 @@
+#include "LatencyHistogram.h"
+
+#include <cmath>
+
+std::uint64_t LatencyHistogram::bucketUpperBound(const std::size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const std::size_t shift = index / SUB_BUCKETS - 1;
+    const std::uint64_t lower = (SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot result;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        result.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        result.count += result.buckets[i];
+    }
+    result.sum = m_sum.load(std::memory_order_relaxed);
+    return result;
+}
+
+std::uint64_t LatencyHistogram::Snapshot::quantile(const double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(count)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank && buckets[i]) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(BUCKETS - 1);
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+/// Гистограмма задержек в духе HDR: логарифмические диапазоны, каждый разбит на SUB_BUCKETS линейных корзин.
+/// Относительная погрешность - не хуже 1 / SUB_BUCKETS. Запись - один relaxed fetch_add
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr std::size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::array<std::uint64_t, BUCKETS> buckets{};
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+
+        /// Верхняя граница корзины, в которую попадает квантиль q
+        [[nodiscard]] std::uint64_t quantile(double q) const;
+    };
+
+    void record(const std::uint64_t value) {
+        m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Snapshot snapshot() const;
+
+    static std::size_t bucketIndex(const std::uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return value;
+        }
+        const unsigned shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static std::uint64_t bucketUpperBound(std::size_t index);
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> m_buckets{};
+    std::atomic<std::uint64_t> m_sum{0};
+};
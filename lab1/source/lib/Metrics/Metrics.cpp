@@ -0,0 +1,181 @@
+#include "Metrics.h"
+
+#include <format>
+
+#include "Paths/DirectoryRegistry.h"
+
+namespace {
+    const char *stageName(const Metrics::Stage stage) {
+        switch (stage) {
+            case Metrics::Stage::WATCHER_READ:
+                return "watcher_read";
+            case Metrics::Stage::NOTIFY:
+                return "notify";
+            case Metrics::Stage::QUEUE_WAIT:
+                return "queue_wait";
+            case Metrics::Stage::HANDLE_EVENT:
+                return "handle_event";
+            case Metrics::Stage::LOGGER:
+                return "logger";
+            case Metrics::Stage::END_TO_END:
+                return "end_to_end";
+            case Metrics::Stage::COUNT:
+                break;
+        }
+        return "unknown";
+    }
+
+    const char *actionName(const std::size_t action) {
+        switch (static_cast<FileChangedInd::Action>(action)) {
+            case FileChangedInd::Action::CREATED:
+                return "created";
+            case FileChangedInd::Action::DELETED:
+                return "deleted";
+            case FileChangedInd::Action::MODIFIED:
+                return "modified";
+            case FileChangedInd::Action::RENAMED:
+                return "renamed";
+            case FileChangedInd::Action::MOVED_IN:
+                return "moved_in";
+            case FileChangedInd::Action::MOVED_OUT:
+                return "moved_out";
+            case FileChangedInd::Action::CLOSE_WRITE:
+                return "close_write";
+            case FileChangedInd::Action::ATTRIB:
+                return "attrib";
+        }
+        return "unknown";
+    }
+
+    std::string escapeLabel(const std::string &value) {
+        std::string result;
+        result.reserve(value.size());
+        for (const char c: value) {
+            switch (c) {
+                case '\\':
+                    result += "\\\\";
+                    break;
+                case '"':
+                    result += "\\\"";
+                    break;
+                case '\n':
+                    result += "\\n";
+                    break;
+                default:
+                    result += c;
+            }
+        }
+        return result;
+    }
+
+    void appendCounter(std::string &out, const char *name, const char *help, const std::uint64_t value) {
+        out += std::format("# HELP disk_monitor_{0} {1}\n# TYPE disk_monitor_{0} counter\ndisk_monitor_{0} {2}\n",
+                           name, help, value);
+    }
+
+    void appendGauge(std::string &out, const char *name, const char *help, const std::int64_t value) {
+        out += std::format("# HELP disk_monitor_{0} {1}\n# TYPE disk_monitor_{0} gauge\ndisk_monitor_{0} {2}\n",
+                           name, help, value);
+    }
+}
+
+Metrics::Metrics() = default;
+
+Metrics::~Metrics() {
+    for (auto &chunk: m_directoryChunks) {
+        delete[] chunk.load();
+    }
+}
+
+void Metrics::recordDirectoryEvent(const std::uint32_t directoryId, const FileChangedInd::Action action) {
+    const std::size_t chunkIndex = directoryId / DIRECTORY_CHUNK_SIZE;
+    if (chunkIndex >= MAX_DIRECTORY_CHUNKS) {
+        return;
+    }
+
+    auto &slot = m_directoryChunks[chunkIndex];
+    DirectoryCounts *chunk = slot.load(std::memory_order_acquire);
+    if (!chunk) {
+        auto *allocated = new DirectoryCounts[DIRECTORY_CHUNK_SIZE];
+        if (slot.compare_exchange_strong(chunk, allocated, std::memory_order_acq_rel)) {
+            chunk = allocated;
+        } else {
+            delete[] allocated;
+        }
+    }
+    auto &counts = chunk[directoryId % DIRECTORY_CHUNK_SIZE];
+    // Идентификатор перешёл к другой директории: счётчики прежней ей не достаются
+    if (const auto generation = DirectoryRegistry::instance().generation(directoryId);
+        counts.generation.load(std::memory_order_relaxed) != generation) {
+        for (auto &value: counts.actions) {
+            value.store(0, std::memory_order_relaxed);
+        }
+        counts.generation.store(generation, std::memory_order_release);
+    }
+    counts.actions[static_cast<std::size_t>(action)].fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string Metrics::renderPrometheus() const {
+    std::string out;
+    appendCounter(out, "events_read_total", "Events read from inotify", eventsRead.value());
+    appendCounter(out, "inotify_reads_total", "read() calls on the inotify descriptor", inotifyReads.value());
+    appendCounter(out, "events_handled_total", "Events processed by the monitor", eventsHandled.value());
+    appendCounter(out, "inotify_overflows_total", "Kernel inotify queue overflows", inotifyOverflows.value());
+    appendCounter(out, "unchanged_modifications_total", "Modifications suppressed because file content did not change",
+                  unchangedModifications.value());
+    appendCounter(out, "unchecked_modifications_total", "Modifications passed without a content check under overload",
+                  uncheckedModifications.value());
+    appendGauge(out, "queue_depth", "Messages waiting in the monitor queue", queueDepth.value());
+    appendGauge(out, "queue_dropped_oldest", "Messages evicted from the full queue", queueDroppedOldest.value());
+    appendGauge(out, "queue_dropped_newest", "Messages rejected by the full queue", queueDroppedNewest.value());
+    appendGauge(out, "subscribers", "Clients connected to the subscription socket", subscribers.value());
+    appendCounter(out, "subscriber_events_lost_total", "Events dropped for subscribers that read too slowly",
+                  subscriberEventsLost.value());
+    appendCounter(out, "event_logs_suppressed_total", "Events summarized instead of logged because of an event storm",
+                  eventLogsSuppressed.value());
+    appendGauge(out, "storm_directories", "Directories currently logged as storm summaries", stormDirectories.value());
+
+    out += "# HELP disk_monitor_stage_latency_seconds Pipeline stage latency\n"
+            "# TYPE disk_monitor_stage_latency_seconds summary\n";
+    for (std::size_t stage = 0; stage < m_stages.size(); ++stage) {
+        const auto snapshot = m_stages[stage].snapshot();
+        const char *name = stageName(static_cast<Stage>(stage));
+        for (const double q: {0.5, 0.9, 0.99, 0.999}) {
+            out += std::format("disk_monitor_stage_latency_seconds{{stage=\"{}\",quantile=\"{}\"}} {:.9f}\n",
+                               name, q, static_cast<double>(snapshot.quantile(q)) / 1e9);
+        }
+        out += std::format("disk_monitor_stage_latency_seconds_sum{{stage=\"{}\"}} {:.9f}\n",
+                           name, static_cast<double>(snapshot.sum) / 1e9);
+        out += std::format("disk_monitor_stage_latency_seconds_count{{stage=\"{}\"}} {}\n", name, snapshot.count);
+    }
+
+    out += "# HELP disk_monitor_directory_events_total Events per watched directory\n"
+            "# TYPE disk_monitor_directory_events_total counter\n";
+    for (std::size_t chunkIndex = 0; chunkIndex < MAX_DIRECTORY_CHUNKS; ++chunkIndex) {
+        const DirectoryCounts *chunk = m_directoryChunks[chunkIndex].load(std::memory_order_acquire);
+        if (!chunk) {
+            continue;
+        }
+        for (std::size_t i = 0; i < DIRECTORY_CHUNK_SIZE; ++i) {
+            const auto directoryId = static_cast<std::uint32_t>(chunkIndex * DIRECTORY_CHUNK_SIZE + i);
+            std::string directory;
+            for (std::size_t action = 0; action < ACTIONS; ++action) {
+                const std::uint64_t value = chunk[i].actions[action].load(std::memory_order_relaxed);
+                if (!value) {
+                    continue;
+                }
+                if (directory.empty()) {
+                    const auto &registry = DirectoryRegistry::instance();
+                    // Прежняя директория этого идентификатора забыта, у новой событий ещё не было
+                    if (chunk[i].generation.load(std::memory_order_acquire) != registry.generation(directoryId)) {
+                        break;
+                    }
+                    directory = escapeLabel(registry.path(directoryId).string());
+                }
+                out += std::format("disk_monitor_directory_events_total{{directory=\"{}\",action=\"{}\"}} {}\n",
+                                   directory, actionName(action), value);
+            }
+        }
+    }
+    return out;
+}
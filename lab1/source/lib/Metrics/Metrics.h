@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Counter.h"
+#include "LatencyHistogram.h"
+#include "Observer/Messages.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Монотонное время в наносекундах, которым помечаются события и замеряются стадии
+inline std::int64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Метрики конвейера событий. Запись не берёт блокировок: счётчики разнесены по кэш-линиям,
+/// гистограммы и счётчики по директориям - наборы атомиков
+class Metrics : public OnceInstantiated<Metrics> {
+    friend class OnceInstantiated;
+
+public:
+    enum class Stage {
+        /// read() из inotify и разбор событий одной порции
+        WATCHER_READ,
+        /// Subject::notify пачки из потока наблюдателя
+        NOTIFY,
+        /// От чтения события из inotify до извлечения из очереди DiskMonitor
+        QUEUE_WAIT,
+        /// Обработка события в DiskMonitor::handleFileChangedInd
+        HANDLE_EVENT,
+        /// Вызов логгера для одного события
+        LOGGER,
+        /// От чтения из inotify до окончания обработки
+        END_TO_END,
+        COUNT,
+    };
+
+    ~Metrics();
+
+    void record(Stage stage, std::uint64_t durationNs) {
+        m_stages[static_cast<std::size_t>(stage)].record(durationNs);
+    }
+
+    [[nodiscard]] LatencyHistogram::Snapshot snapshot(Stage stage) const {
+        return m_stages[static_cast<std::size_t>(stage)].snapshot();
+    }
+
+    void recordDirectoryEvent(std::uint32_t directoryId, FileChangedInd::Action action);
+
+    Counter eventsRead;
+    Counter inotifyReads;
+    Counter eventsHandled;
+    Counter inotifyOverflows;
+    /// MODIFIED, подавленные ContentFilter, потому что содержимое файла не изменилось
+    Counter unchangedModifications;
+    /// MODIFIED, пропущенные ContentFilter без проверки содержимого: очередь хеширования переполнена
+    Counter uncheckedModifications;
+    Gauge queueDepth;
+    Gauge queueDroppedOldest;
+    Gauge queueDroppedNewest;
+    /// Клиенты, подключённые к серверу подписок
+    Gauge subscribers;
+    /// События, не доставленные медленным подписчикам
+    Counter subscriberEventsLost;
+    /// События, не записанные в лог по одному из-за превышения бюджета директории (вошли в сводку шторма)
+    Counter eventLogsSuppressed;
+    /// Директории, которые сейчас пишутся в лог сводками
+    Gauge stormDirectories;
+
+    /// Снимок в текстовом формате Prometheus
+    [[nodiscard]] std::string renderPrometheus() const;
+
+protected:
+    Metrics();
+
+private:
+    static constexpr std::size_t DIRECTORY_CHUNK_SIZE = 4096;
+    static constexpr std::size_t MAX_DIRECTORY_CHUNKS = 4096;
+    static constexpr std::size_t ACTIONS = FileChangedInd::ACTIONS_COUNT;
+
+    struct DirectoryCounts {
+        std::array<std::atomic<std::uint64_t>, ACTIONS> actions{};
+        /// DirectoryRegistry::generation директории, которой принадлежат счётчики
+        std::atomic<std::uint16_t> generation{0};
+    };
+
+    std::array<LatencyHistogram, static_cast<std::size_t>(Stage::COUNT)> m_stages;
+    /// Счётчики по идентификатору директории. Куски выделяются при первом обращении и не освобождаются до конца работы
+    std::array<std::atomic<DirectoryCounts *>, MAX_DIRECTORY_CHUNKS> m_directoryChunks{};
+};
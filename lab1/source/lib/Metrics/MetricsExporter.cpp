@@ -0,0 +1,128 @@
+#include "MetricsExporter.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Metrics.h"
+#include "Logger/SystemLogger.h"
+
+namespace {
+    /// Для сокетов используется send с MSG_NOSIGNAL: отключившийся клиент не должен приводить к SIGPIPE
+    bool writeAll(const int fd, const std::string &data, const bool isSocket = false) {
+        std::size_t written = 0;
+        while (written < data.size()) {
+            const ssize_t result = isSocket
+                                       ? send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL)
+                                       : ::write(fd, data.data() + written, data.size() - written);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            written += static_cast<std::size_t>(result);
+        }
+        return true;
+    }
+}
+
+MetricsExporter::MetricsExporter(std::filesystem::path file, std::filesystem::path socketPath,
+                                 const std::chrono::milliseconds interval) : m_file{std::move(file)},
+                                                                             m_socketPath{std::move(socketPath)},
+                                                                             m_interval{interval} {
+    if (!m_socketPath.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (m_socketPath.native().size() >= sizeof(address.sun_path)) {
+            SystemLogger::instance().error(std::format("Metrics socket path {} is too long", m_socketPath.string()));
+        } else {
+            std::strncpy(address.sun_path, m_socketPath.c_str(), sizeof(address.sun_path) - 1);
+            unlink(m_socketPath.c_str());
+            m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+                listen(m_listenFd, 16) < 0) {
+                SystemLogger::instance().error(std::format("Cannot listen on metrics socket {}: {}",
+                                                           m_socketPath.string(), std::strerror(errno)));
+                if (m_listenFd >= 0) {
+                    close(m_listenFd);
+                    m_listenFd = -1;
+                }
+            }
+        }
+    }
+
+    m_stopFd = eventfd(0, EFD_CLOEXEC);
+    m_thread = std::thread{&MetricsExporter::exportLoop, this};
+}
+
+MetricsExporter::~MetricsExporter() {
+    constexpr std::uint64_t one = 1;
+    if (::write(m_stopFd, &one, sizeof(one)) < 0) {
+        perror("write");
+    }
+    m_thread.join();
+    close(m_stopFd);
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+    }
+}
+
+void MetricsExporter::exportLoop() {
+    auto nextWrite = std::chrono::steady_clock::now();
+    while (true) {
+        if (!m_file.empty() && std::chrono::steady_clock::now() >= nextWrite) {
+            writeFile();
+            nextWrite = std::chrono::steady_clock::now() + m_interval;
+        }
+
+        int timeout = -1;
+        if (!m_file.empty()) {
+            timeout = static_cast<int>(std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                                                  nextWrite - std::chrono::steady_clock::now()).count()));
+        }
+
+        pollfd fds[2] = {{m_stopFd, POLLIN, 0}, {m_listenFd, POLLIN, 0}};
+        if (poll(fds, m_listenFd >= 0 ? 2 : 1, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            return;
+        }
+        if (fds[0].revents & POLLIN) {
+            return;
+        }
+        if (m_listenFd >= 0 && (fds[1].revents & POLLIN)) {
+            serveClient();
+        }
+    }
+}
+
+void MetricsExporter::writeFile() const {
+    // Пишем во временный файл и переименовываем, чтобы читатель не увидел снимок наполовину
+    const auto temporary = std::filesystem::path{m_file}.concat(".tmp");
+    const int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    const bool written = writeAll(fd, Metrics::instance().renderPrometheus());
+    close(fd);
+    if (!written || rename(temporary.c_str(), m_file.c_str()) < 0) {
+        unlink(temporary.c_str());
+    }
+}
+
+void MetricsExporter::serveClient() const {
+    const int client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+        return;
+    }
+    timeval timeout{1, 0};
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    writeAll(client, Metrics::instance().renderPrometheus(), true);
+    close(client);
+}
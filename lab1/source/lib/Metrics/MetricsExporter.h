@@ -0,0 +1,32 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+/// Отдаёт снимок Metrics в формате Prometheus: периодически переписывает файл
+/// и/или отвечает снимком каждому подключившемуся к Unix-сокету
+class MetricsExporter {
+public:
+    MetricsExporter(std::filesystem::path file, std::filesystem::path socketPath, std::chrono::milliseconds interval);
+
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter &) = delete;
+
+    MetricsExporter &operator=(const MetricsExporter &) = delete;
+
+private:
+    void exportLoop();
+
+    void writeFile() const;
+
+    void serveClient() const;
+
+    std::filesystem::path m_file;
+    std::filesystem::path m_socketPath;
+    std::chrono::milliseconds m_interval;
+    int m_listenFd = -1;
+    int m_stopFd = -1;
+    std::thread m_thread;
+};
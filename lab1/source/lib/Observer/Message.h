@@ -1,6 +1,15 @@
 #pragma once
+#include <variant>
 
-class Message {
-public:
-    virtual ~Message() = default;
+#include "Messages.h"
+
+/// Сообщения передаются по значению: без выделения памяти в куче и без RTTI при разборе
+using Message = std::variant<FileChangedInd, ReloadConfigRequest, StopRequest>;
+
+static_assert(sizeof(Message) <= 64, "Message should fit into a cache line");
+
+/// Набор обработчиков для std::visit
+template<typename... Handlers>
+struct Overloaded : Handlers... {
+    using Handlers::operator()...;
 };
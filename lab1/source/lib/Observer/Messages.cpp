@@ -0,0 +1,34 @@
+#include "Messages.h"
+
+#include <new>
+
+void FileChangedInd::setPrevious(const std::uint32_t directoryId, const std::string_view fileName) {
+    // Новое имя может лежать в m_names или в блоке, которые сейчас будут перезаписаны
+    char name[NAME_CAPACITY];
+    const std::size_t length = nameLength;
+    std::memcpy(name, this->fileName().data(), length);
+    release();
+    previousDirectoryId = directoryId;
+    previousNameLength = static_cast<std::uint8_t>(std::min(fileName.size(), NAME_CAPACITY));
+    storeNames({name, length}, fileName.substr(0, previousNameLength));
+}
+
+void FileChangedInd::releaseBlock(SpilledNames *block) {
+    if (block->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        block->~SpilledNames();
+        ::operator delete(block);
+    }
+}
+
+void FileChangedInd::storeNames(const std::string_view name, const std::string_view previous) {
+    char *destination = m_names;
+    if (spilled()) {
+        auto *block = new(::operator new(sizeof(SpilledNames) + name.size() + previous.size())) SpilledNames{1};
+        std::memcpy(m_names, &block, sizeof(block));
+        destination = block->names();
+    }
+    std::memcpy(destination, name.data(), name.size());
+    if (!previous.empty()) {
+        std::memcpy(destination + name.size(), previous.data(), previous.size());
+    }
+}
@@ -1,30 +1,160 @@
 #pragma once
-#include <string>
-#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
 
-#include "Observer/Message.h"
-
-class FileChangedInd : public Message {
-public:
-    enum class Action {
+/// Запись фиксированного размера: директория задаётся интернированным идентификатором
+/// (см. DirectoryRegistry). Имя и прежнее имя, если вместе помещаются во встроенный буфер, хранятся в нём,
+/// и Message занимает одну кэш-линию. Длинные имена выносятся в общий для всех копий блок со счётчиком ссылок
+struct FileChangedInd {
+    enum class Action : std::uint8_t {
         CREATED,
         DELETED,
         MODIFIED,
+        /// Переименование или перемещение внутри наблюдаемых директорий, прежнее расположение - previous*
+        RENAMED,
+        /// Файл перемещён из ненаблюдаемой директории
+        MOVED_IN,
+        /// Файл перемещён в ненаблюдаемую директорию
+        MOVED_OUT,
+        /// Файл, открытый на запись, закрыт - запись закончена. Включается в конфиге
+        CLOSE_WRITE,
+        /// Изменились права, владелец или временные метки. Включается в конфиге
+        ATTRIB,
     };
 
-    explicit FileChangedInd(std::filesystem::path directory, std::string fileName,
-                            Action action) : directory(std::move(directory)),
-                                             fileName(std::move(fileName)),
-                                             action(action) {
+    static constexpr std::size_t ACTIONS_COUNT = 8;
+    static constexpr std::size_t NAME_CAPACITY = NAME_MAX;
+    /// Суммарная длина имени и прежнего имени, которые хранятся в самой записи
+    static constexpr std::size_t INLINE_NAMES_CAPACITY = 25;
+
+    FileChangedInd() = default;
+
+    FileChangedInd(const std::uint32_t directoryId, const std::string_view fileName, const Action action,
+                   const std::uint32_t count = 1, const std::int64_t timestampNs = 0) : timestampNs{timestampNs},
+                                                                                        directoryId{directoryId},
+                                                                                        count{count},
+                                                                                        action{action},
+                                                                                        nameLength{static_cast<std::uint8_t>(
+                                                                                            std::min(fileName.size(),
+                                                                                                NAME_CAPACITY))} {
+        storeNames(fileName.substr(0, nameLength), {});
+    }
+
+    FileChangedInd(const FileChangedInd &other) noexcept {
+        assign(other);
+        retain();
+    }
+
+    /// Вынесенный блок переходит к новой записи без изменения счётчика, прежняя остаётся без имён
+    FileChangedInd(FileChangedInd &&other) noexcept {
+        assign(other);
+        other.nameLength = other.previousNameLength = 0;
+    }
+
+    FileChangedInd &operator=(const FileChangedInd &other) noexcept {
+        if (this != &other) {
+            release();
+            assign(other);
+            retain();
+        }
+        return *this;
     }
 
-    std::filesystem::path directory;
-    std::string const fileName;
-    Action action;
+    FileChangedInd &operator=(FileChangedInd &&other) noexcept {
+        if (this != &other) {
+            release();
+            assign(other);
+            other.nameLength = other.previousNameLength = 0;
+        }
+        return *this;
+    }
+
+    ~FileChangedInd() { release(); }
+
+    [[nodiscard]] std::string_view fileName() const { return {names().data(), nameLength}; }
+
+    /// Прежнее имя для RENAMED, хранится сразу за новым
+    [[nodiscard]] std::string_view previousName() const { return {names().data() + nameLength, previousNameLength}; }
+
+    /// Имя и сразу за ним прежнее имя
+    [[nodiscard]] std::string_view names() const {
+        return {spilled() ? spilledBlock()->names() : m_names, std::size_t{nameLength} + previousNameLength};
+    }
+
+    void setPrevious(std::uint32_t directoryId, std::string_view fileName);
+
+    /// Файла больше нет в директории directoryId
+    [[nodiscard]] bool removesFile() const { return action == Action::DELETED || action == Action::MOVED_OUT; }
+
+    /// Монотонное время чтения события из inotify, нс
+    std::int64_t timestampNs = 0;
+    /// Сквозной номер события, присваивается в шарде (см. EventTrace). 0 - событие не из шарда
+    std::uint64_t traceId = 0;
+    std::uint32_t directoryId = 0;
+    std::uint32_t previousDirectoryId = 0;
+    /// Сколько исходных событий inotify объединено в это
+    std::uint32_t count = 1;
+    Action action = Action::CREATED;
+    std::uint8_t nameLength = 0;
+    std::uint8_t previousNameLength = 0;
+
+private:
+    /// Заголовок вынесенного блока, имена лежат сразу за ним
+    struct SpilledNames {
+        std::atomic<std::uint32_t> references;
+
+        [[nodiscard]] char *names() { return reinterpret_cast<char *>(this + 1); }
+    };
+
+    [[nodiscard]] bool spilled() const { return std::size_t{nameLength} + previousNameLength > INLINE_NAMES_CAPACITY; }
+
+    /// Указатель на блок хранится в начале m_names: выравнивание m_names не позволяет держать его отдельным полем
+    /// без увеличения записи
+    [[nodiscard]] SpilledNames *spilledBlock() const {
+        SpilledNames *block;
+        std::memcpy(&block, m_names, sizeof(block));
+        return block;
+    }
+
+    /// Копирует поля и байты m_names, не трогая счётчик ссылок
+    void assign(const FileChangedInd &other) {
+        timestampNs = other.timestampNs;
+        traceId = other.traceId;
+        directoryId = other.directoryId;
+        previousDirectoryId = other.previousDirectoryId;
+        count = other.count;
+        action = other.action;
+        nameLength = other.nameLength;
+        previousNameLength = other.previousNameLength;
+        std::memcpy(m_names, other.m_names, sizeof(m_names));
+    }
+
+    void retain() const {
+        if (spilled()) {
+            spilledBlock()->references.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void release() {
+        if (spilled()) {
+            releaseBlock(spilledBlock());
+        }
+    }
+
+    static void releaseBlock(SpilledNames *block);
+
+    /// Длины уже установлены. name и previous не должны указывать в m_names
+    void storeNames(std::string_view name, std::string_view previous);
+
+    char m_names[INLINE_NAMES_CAPACITY];
 };
 
-class ReloadConfigRequest : public Message {
+struct ReloadConfigRequest {
 };
 
-class StopRequest : public Message {
+struct StopRequest {
 };
@@ -1,5 +1,5 @@
 #pragma once
-#include <memory>
+#include <span>
 
 #include "Message.h"
 
@@ -7,6 +7,12 @@ class Observer {
 public:
     virtual ~Observer() = default;
 
-    virtual void put(std::shared_ptr<Message> message) = 0;
-};
+    virtual void put(const Message &message) = 0;
 
+    /// Пачка сообщений. По умолчанию раскладывается на отдельные put
+    virtual void put(std::span<const Message> messages) {
+        for (const auto &message: messages) {
+            put(message);
+        }
+    }
+};
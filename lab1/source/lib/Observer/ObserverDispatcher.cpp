@@ -0,0 +1,135 @@
+#include "ObserverDispatcher.h"
+
+#include <algorithm>
+
+#include "Queue/Futex.h"
+
+ObserverDispatcher::ObserverDispatcher(const std::size_t threadsCount, const std::size_t mailboxCapacity)
+    : m_mailboxCapacity{std::max<std::size_t>(mailboxCapacity, QUANTUM)},
+      m_workers(std::max<std::size_t>(threadsCount, 1)) {
+    m_threads.reserve(m_workers.size());
+    for (std::size_t worker = 0; worker < m_workers.size(); ++worker) {
+        m_threads.emplace_back(&ObserverDispatcher::work, this, worker);
+    }
+}
+
+ObserverDispatcher::~ObserverDispatcher() {
+    m_running = false;
+    m_readyEpoch.fetch_add(1, std::memory_order_seq_cst);
+    futex::wake(m_readyEpoch, INT32_MAX);
+    for (auto &thread: m_threads) {
+        thread.join();
+    }
+}
+
+void ObserverDispatcher::attach(Observer *observer) {
+    const bool attached = std::any_of(m_mailboxes.begin(), m_mailboxes.end(),
+                                      [observer](const auto &mailbox) { return mailbox->observer == observer; });
+    if (!attached) {
+        m_mailboxes.push_back(std::make_unique<Mailbox>(observer, m_mailboxCapacity,
+                                                        m_nextHome++ % m_workers.size()));
+    }
+}
+
+void ObserverDispatcher::detach(Observer *observer) {
+    const auto it = std::find_if(m_mailboxes.begin(), m_mailboxes.end(),
+                                 [observer](const auto &mailbox) { return mailbox->observer == observer; });
+    if (it == m_mailboxes.end()) {
+        return;
+    }
+    // Новых сообщений в ящик не придёт: ждём, пока поток пула отдаст оставшиеся и отпустит ящик
+    while ((*it)->scheduled.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+    m_mailboxes.erase(it);
+}
+
+void ObserverDispatcher::post(const std::span<const Message> messages) {
+    for (const auto &mailbox: m_mailboxes) {
+        // Порциями не больше ящика: заполненный ящик всегда уже стоит в очереди готовых,
+        // поэтому заблокированного производителя есть кому разбудить
+        for (std::size_t offset = 0; offset < messages.size(); offset += m_mailboxCapacity) {
+            mailbox->queue.pushBatch(messages.subspan(offset, std::min(m_mailboxCapacity, messages.size() - offset)));
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!mailbox->scheduled.exchange(true, std::memory_order_acq_rel)) {
+                schedule(*mailbox);
+            }
+        }
+    }
+}
+
+void ObserverDispatcher::schedule(Mailbox &mailbox) {
+    {
+        std::lock_guard lock{m_workers[mailbox.home].mutex};
+        m_workers[mailbox.home].ready.push_back(&mailbox);
+    }
+    m_readyEpoch.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst)) {
+        futex::wake(m_readyEpoch, 1);
+    }
+}
+
+bool ObserverDispatcher::take(const std::size_t worker, Mailbox *&mailbox) {
+    {
+        auto &own = m_workers[worker];
+        std::lock_guard lock{own.mutex};
+        if (!own.ready.empty()) {
+            mailbox = own.ready.back();
+            own.ready.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < m_workers.size(); ++i) {
+        auto &victim = m_workers[(worker + i) % m_workers.size()];
+        std::lock_guard lock{victim.mutex};
+        if (!victim.ready.empty()) {
+            mailbox = victim.ready.front();
+            victim.ready.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ObserverDispatcher::deliver(const std::size_t worker, Mailbox &mailbox, std::vector<Message> &batch) {
+    batch.clear();
+    if (mailbox.queue.tryPopBatch(batch, QUANTUM)) {
+        mailbox.observer->put(std::span<const Message>{batch});
+    }
+
+    if (mailbox.queue.size() == 0) {
+        mailbox.scheduled.store(false, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Производитель мог положить сообщение, пока ящик ещё считался запланированным
+        if (mailbox.queue.size() == 0 || mailbox.scheduled.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+    }
+    // В начало своей очереди: сначала остальные готовые ящики этого потока
+    std::lock_guard lock{m_workers[worker].mutex};
+    m_workers[worker].ready.push_front(&mailbox);
+}
+
+void ObserverDispatcher::work(const std::size_t worker) {
+    std::vector<Message> batch;
+    batch.reserve(QUANTUM);
+
+    while (true) {
+        const std::uint32_t epoch = m_readyEpoch.load(std::memory_order_seq_cst);
+        Mailbox *mailbox = nullptr;
+        if (take(worker, mailbox)) {
+            deliver(worker, *mailbox, batch);
+            continue;
+        }
+        // Ящики разбираются до конца: недоставленный остаток стоит в очереди готовых
+        if (!m_running.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (m_readyEpoch.load(std::memory_order_seq_cst) == epoch) {
+            futex::wait(m_readyEpoch, epoch);
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "Message.h"
+#include "Observer.h"
+#include "Queue/MpscRingQueue.h"
+
+/// Рассылка сообщений наблюдателям через почтовые ящики. У каждого наблюдателя своя ограниченная очередь,
+/// производитель только кладёт в неё сообщения, а вызывают put потоки общего пула. Ящик с сообщениями
+/// стоит в очереди готовых ровно у одного потока, поэтому наблюдатель получает сообщения по порядку и
+/// никогда из двух потоков сразу. Поток берёт готовые ящики с конца своей очереди, а опустевший крадёт
+/// с начала чужой. Медленный наблюдатель задерживает производителя, только когда заполнен его собственный ящик
+class ObserverDispatcher {
+public:
+    ObserverDispatcher(std::size_t threadsCount, std::size_t mailboxCapacity);
+
+    /// Доставляет всё, что осталось в ящиках, и останавливает потоки
+    ~ObserverDispatcher();
+
+    ObserverDispatcher(const ObserverDispatcher &) = delete;
+
+    ObserverDispatcher &operator=(const ObserverDispatcher &) = delete;
+
+    /// attach и detach нельзя вызывать одновременно с post
+    void attach(Observer *observer);
+
+    /// Ждёт, пока ящик наблюдателя опустеет
+    void detach(Observer *observer);
+
+    void post(std::span<const Message> messages);
+
+private:
+    /// Сколько сообщений поток передаёт наблюдателю за раз, прежде чем вернуть ящик в очередь готовых
+    static constexpr std::size_t QUANTUM = 256;
+
+    struct Mailbox {
+        Mailbox(Observer *observer, const std::size_t capacity, const std::size_t home)
+            : observer{observer}, queue{capacity}, home{home} {
+        }
+
+        Observer *observer;
+        MpscRingQueue<Message> queue;
+        /// Ящик стоит в очереди готовых или разбирается
+        std::atomic<bool> scheduled{false};
+        /// Поток, которому ящик отдаётся в первую очередь
+        std::size_t home;
+    };
+
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Mailbox *> ready;
+    };
+
+    void schedule(Mailbox &mailbox);
+
+    bool take(std::size_t worker, Mailbox *&mailbox);
+
+    void deliver(std::size_t worker, Mailbox &mailbox, std::vector<Message> &batch);
+
+    void work(std::size_t worker);
+
+    std::size_t m_mailboxCapacity;
+    std::vector<std::unique_ptr<Mailbox> > m_mailboxes;
+    std::size_t m_nextHome = 0;
+    std::vector<Worker> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_running{true};
+
+    /// Увеличивается после каждой постановки ящика в очередь готовых, на нём засыпают потоки
+    alignas(64) std::atomic<std::uint32_t> m_readyEpoch{0};
+    std::atomic<std::uint32_t> m_sleeping{0};
+};
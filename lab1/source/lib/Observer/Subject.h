@@ -1,9 +1,12 @@
 #pragma once
 #include <algorithm>
 #include <memory>
+#include <span>
 #include <vector>
 
 #include "Observer.h"
+#include "ObserverDispatcher.h"
+#include "Trace/Probes.h"
 
 template<typename Container = std::vector<Observer *> >
 class Subject {
@@ -14,10 +17,18 @@ public:
 
     virtual void detach(Observer *observer);
 
-    virtual void notify(std::shared_ptr<Message> message);
+    virtual void notify(const Message &message);
+
+    virtual void notify(std::span<const Message> messages);
+
+    /// threadsCount > 0 - рассылать через почтовые ящики наблюдателей, которые разбирает пул из threadsCount
+    /// потоков (см. ObserverDispatcher), 0 - вызывать put наблюдателей прямо из notify. Перед сменой режима
+    /// доставляется всё, что осталось в ящиках. Нельзя вызывать одновременно с notify
+    void setDispatch(std::size_t threadsCount, std::size_t mailboxCapacity);
 
 protected:
     Container m_observers;
+    std::unique_ptr<ObserverDispatcher> m_dispatcher;
 };
 
 template<typename Container>
@@ -25,6 +36,9 @@ void Subject<Container>::attach(Observer *observer) {
     if constexpr (std::is_same_v<Container, std::vector<Observer *> >) {
         if (std::find(m_observers.begin(), m_observers.end(), observer) == m_observers.end()) {
             m_observers.push_back(observer);
+            if (m_dispatcher) {
+                m_dispatcher->attach(observer);
+            }
         }
     }
 }
@@ -33,12 +47,47 @@ template<typename Container>
 void Subject<Container>::detach(Observer *observer) {
     if constexpr (std::is_same_v<Container, std::vector<Observer *> >) {
         std::erase(m_observers, observer);
+        if (m_dispatcher) {
+            m_dispatcher->detach(observer);
+        }
     }
 }
 
 template<typename Container>
-void Subject<Container>::notify(std::shared_ptr<Message> message) {
+void Subject<Container>::notify(const Message &message) {
+    DISK_MONITOR_PROBE2(notify, this, 1);
+    if (m_dispatcher) {
+        m_dispatcher->post(std::span{&message, 1});
+        return;
+    }
     for (auto *observer: m_observers) {
         observer->put(message);
     }
 }
+
+template<typename Container>
+void Subject<Container>::notify(std::span<const Message> messages) {
+    if (messages.empty()) {
+        return;
+    }
+    DISK_MONITOR_PROBE2(notify, this, messages.size());
+    if (m_dispatcher) {
+        m_dispatcher->post(messages);
+        return;
+    }
+    for (auto *observer: m_observers) {
+        observer->put(messages);
+    }
+}
+
+template<typename Container>
+void Subject<Container>::setDispatch(const std::size_t threadsCount, const std::size_t mailboxCapacity) {
+    m_dispatcher.reset();
+    if (threadsCount == 0) {
+        return;
+    }
+    m_dispatcher = std::make_unique<ObserverDispatcher>(threadsCount, mailboxCapacity);
+    for (auto *observer: m_observers) {
+        m_dispatcher->attach(observer);
+    }
+}
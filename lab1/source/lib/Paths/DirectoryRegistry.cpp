@@ -0,0 +1,147 @@
+#include "DirectoryRegistry.h"
+
+#include <functional>
+#include <mutex>
+
+DirectoryRegistry::DirectoryRegistry(const std::chrono::milliseconds reuseDelay) : m_reuseDelay{reuseDelay} {
+}
+
+DirectoryRegistry::Id DirectoryRegistry::intern(const std::filesystem::path &root) {
+    return intern(NO_PARENT, root.native());
+}
+
+DirectoryRegistry::Id DirectoryRegistry::intern(const Id parent, const std::string_view name) {
+    const auto nameHash = hash(parent, name);
+    std::unique_lock lock{m_mutex};
+    auto slot = findSlot(parent, name, nameHash);
+    if (const auto id = m_slots[slot].id; id != NO_ID) {
+        ++m_references[id];
+        return id;
+    }
+    if ((m_entries.size() + 1) * 4 > m_slots.size() * 3) {
+        grow();
+        slot = findSlot(parent, name, nameHash);
+    }
+
+    const auto stored = m_names.add(name);
+    const Entry entry{stored.data(), parent, static_cast<std::uint16_t>(stored.size()), 0};
+    Id id;
+    if (!m_retired.empty() && std::chrono::steady_clock::now() - m_retired.front().time >= m_reuseDelay) {
+        id = m_retired.front().id;
+        m_retired.pop_front();
+        // Имя прежней директории освобождается только сейчас: до этого path отвечал по нему
+        m_names.release(m_entries[id].nameView());
+        const auto generation = static_cast<std::uint16_t>(m_entries[id].generation + 1);
+        m_entries[id] = entry;
+        m_entries[id].generation = generation;
+        m_references[id] = 1;
+    } else {
+        id = static_cast<Id>(m_entries.size());
+        m_entries.push_back(entry);
+        m_references.push_back(1);
+    }
+    if (parent != NO_PARENT) {
+        ++m_references[parent];
+    }
+    m_slots[slot] = {nameHash, id};
+    return id;
+}
+
+std::optional<DirectoryRegistry::Id> DirectoryRegistry::find(const Id parent, const std::string_view name) const {
+    std::shared_lock lock{m_mutex};
+    if (const auto id = m_slots[findSlot(parent, name, hash(parent, name))].id; id != NO_ID) {
+        return id;
+    }
+    return std::nullopt;
+}
+
+void DirectoryRegistry::release(Id id) {
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{m_mutex};
+    // Запись без ссылок отпускает и своего родителя
+    while (id != NO_PARENT && id < m_entries.size() && m_references[id] > 0 && --m_references[id] == 0) {
+        const auto &entry = m_entries[id];
+        eraseSlot(findSlot(entry.parent, entry.nameView(), hash(entry.parent, entry.nameView())));
+        m_retired.push_back({id, now});
+        id = entry.parent;
+    }
+}
+
+std::filesystem::path DirectoryRegistry::path(Id id) const {
+    std::vector<std::string_view> names;
+    std::shared_lock lock{m_mutex};
+    while (id != NO_PARENT && id < m_entries.size()) {
+        names.push_back(m_entries[id].nameView());
+        id = m_entries[id].parent;
+    }
+
+    std::filesystem::path result;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        result /= *it;
+    }
+    return result;
+}
+
+std::uint16_t DirectoryRegistry::generation(const Id id) const {
+    std::shared_lock lock{m_mutex};
+    return id < m_entries.size() ? m_entries[id].generation : 0;
+}
+
+bool DirectoryRegistry::isWithin(Id id, const Id ancestor) const {
+    std::shared_lock lock{m_mutex};
+    while (id != NO_PARENT && id < m_entries.size()) {
+        if (id == ancestor) {
+            return true;
+        }
+        id = m_entries[id].parent;
+    }
+    return false;
+}
+
+std::uint32_t DirectoryRegistry::hash(const Id parent, const std::string_view name) {
+    const auto value = std::hash<std::string_view>{}(name) ^ (parent * 0x9e3779b97f4a7c15ull);
+    return static_cast<std::uint32_t>(value ^ value >> 32);
+}
+
+std::size_t DirectoryRegistry::findSlot(const Id parent, const std::string_view name,
+                                        const std::uint32_t hash) const {
+    const std::size_t mask = m_slots.size() - 1;
+    for (std::size_t index = hash & mask;; index = (index + 1) & mask) {
+        const auto &slot = m_slots[index];
+        // Хеш в слоте отсекает почти все чужие записи без обращения к m_entries
+        if (slot.id == NO_ID || (slot.hash == hash && m_entries[slot.id].parent == parent &&
+                                 m_entries[slot.id].nameView() == name)) {
+            return index;
+        }
+    }
+}
+
+void DirectoryRegistry::eraseSlot(std::size_t index) {
+    const std::size_t mask = m_slots.size() - 1;
+    for (auto next = (index + 1) & mask; m_slots[next].id != NO_ID; next = (next + 1) & mask) {
+        // Запись остаётся, если её место по хешу лежит в цепочке после освобождённого слота
+        const auto home = m_slots[next].hash & mask;
+        if (((next - home) & mask) < ((next - index) & mask)) {
+            continue;
+        }
+        m_slots[index] = m_slots[next];
+        index = next;
+    }
+    m_slots[index] = {0, NO_ID};
+}
+
+void DirectoryRegistry::grow() {
+    std::vector<Slot> slots(m_slots.size() * 2, Slot{0, NO_ID});
+    const std::size_t mask = slots.size() - 1;
+    for (const auto &slot: m_slots) {
+        if (slot.id == NO_ID) {
+            continue;
+        }
+        auto index = slot.hash & mask;
+        while (slots[index].id != NO_ID) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = slot;
+    }
+    m_slots = std::move(slots);
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+#include "StringArena.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Таблица интернированных директорий. Сообщения несут только числовой идентификатор директории,
+/// строка пути нужна лишь на выходе (лог). Для каждой директории хранится родитель и имя,
+/// полный путь восстанавливается по цепочке родителей.
+///
+/// На миллионах директорий важна память на запись: имена лежат подряд в StringArena, запись - 16 байт,
+/// а поиск по (родитель, имя) идёт по плоской таблице с открытой адресацией, где слот - 8 байт
+/// с хешем и идентификатором, без отдельного узла и копии ключа на каждую директорию.
+///
+/// Записи считают ссылки: их держат наблюдаемые директории и дочерние записи. Запись без ссылок уходит
+/// из поиска, но ещё reuseDelay отвечает на path: столько живут сообщения с её идентификатором.
+/// Потом идентификатор и место имени достаются новой директории, а generation записи меняется
+class DirectoryRegistry : public OnceInstantiated<DirectoryRegistry> {
+    friend class OnceInstantiated;
+
+public:
+    using Id = std::uint32_t;
+
+    static constexpr Id NO_PARENT = UINT32_MAX;
+
+    /// Корневая директория из конфига, хранится полным путём. Захватывает ссылку, см. release
+    Id intern(const std::filesystem::path &root);
+
+    /// Захватывает ссылку, см. release
+    Id intern(Id parent, std::string_view name);
+
+    /// Поиск без создания записи и без ссылки
+    [[nodiscard]] std::optional<Id> find(Id parent, std::string_view name) const;
+
+    /// Отпускает ссылку, полученную от intern
+    void release(Id id);
+
+    [[nodiscard]] std::filesystem::path path(Id id) const;
+
+    /// Меняется, когда идентификатор переходит к другой директории. По нему хранящие состояние по идентификатору
+    /// отличают новую директорию от прежней
+    [[nodiscard]] std::uint16_t generation(Id id) const;
+
+    /// id совпадает с ancestor или лежит внутри неё. Идёт по цепочке родителей без построения путей
+    [[nodiscard]] bool isWithin(Id id, Id ancestor) const;
+
+protected:
+    explicit DirectoryRegistry(std::chrono::milliseconds reuseDelay = std::chrono::minutes{1});
+
+private:
+    struct Entry {
+        const char *name;
+        Id parent;
+        std::uint16_t nameLength;
+        std::uint16_t generation;
+
+        [[nodiscard]] std::string_view nameView() const { return {name, nameLength}; }
+    };
+
+    struct Slot {
+        std::uint32_t hash;
+        /// NO_ID - слот свободен
+        Id id;
+    };
+
+    struct Retired {
+        Id id;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    static constexpr Id NO_ID = UINT32_MAX;
+    static constexpr std::size_t MIN_SLOTS = 1024;
+
+    static std::uint32_t hash(Id parent, std::string_view name);
+
+    /// Слот с директорией name в parent или свободный слот, куда её положить. Вызывать под m_mutex
+    [[nodiscard]] std::size_t findSlot(Id parent, std::string_view name, std::uint32_t hash) const;
+
+    /// Освобождает слот, сдвигая назад следующие за ним записи той же цепочки пробирования.
+    /// Вызывать под исключительной блокировкой m_mutex
+    void eraseSlot(std::size_t index);
+
+    /// Удваивает таблицу. Вызывать под исключительной блокировкой m_mutex
+    void grow();
+
+    const std::chrono::milliseconds m_reuseDelay;
+
+    mutable std::shared_mutex m_mutex;
+    std::vector<Entry> m_entries;
+    /// Ссылки на записи, отдельно от m_entries: нужны только при подписке и снятии watch
+    std::vector<std::uint32_t> m_references;
+    /// Записи без ссылок в порядке освобождения
+    std::deque<Retired> m_retired;
+    StringArena m_names;
+    /// Линейное пробирование, размер - степень двойки, заполнена не больше чем на 3/4
+    std::vector<Slot> m_slots = std::vector<Slot>(MIN_SLOTS, Slot{0, NO_ID});
+};
@@ -0,0 +1,39 @@
+#include "StringArena.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::string_view StringArena::add(const std::string_view value) {
+    if (value.empty()) {
+        return {};
+    }
+    if (value.size() < m_free.size() && !m_free[value.size()].empty()) {
+        char *place = m_free[value.size()].back();
+        m_free[value.size()].pop_back();
+        std::memcpy(place, value.data(), value.size());
+        return {place, value.size()};
+    }
+    if (value.size() > m_available) {
+        // Остаток текущего блока пропадает, но строки короче блока в сотни раз, потери малы
+        const std::size_t size = std::max(BLOCK_BYTES, value.size());
+        m_blocks.push_back(std::make_unique_for_overwrite<char[]>(size));
+        m_position = m_blocks.back().get();
+        m_available = size;
+    }
+    std::memcpy(m_position, value.data(), value.size());
+    const std::string_view result{m_position, value.size()};
+    m_position += value.size();
+    m_available -= value.size();
+    return result;
+}
+
+void StringArena::release(const std::string_view value) {
+    if (value.empty() || value.size() > MAX_REUSED_LENGTH) {
+        return;
+    }
+    if (value.size() >= m_free.size()) {
+        m_free.resize(value.size() + 1);
+    }
+    // Строка лежит в блоке арены, а не в памяти вызывающего
+    m_free[value.size()].push_back(const_cast<char *>(value.data()));
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/// Хранилище строк, которые живут до конца жизни арены или до release. Строки копируются подряд в крупные блоки:
+/// без заголовка аллокации и без std::string на каждую строку. Возвращённые string_view не меняются, блоки
+/// не перемещаются. Место освобождённой строки достаётся следующей строке той же длины
+class StringArena {
+public:
+    StringArena() = default;
+
+    StringArena(const StringArena &) = delete;
+
+    StringArena &operator=(const StringArena &) = delete;
+
+    std::string_view add(std::string_view value);
+
+    /// value больше не используется. Длинные строки (полные пути корней) не переиспользуются
+    void release(std::string_view value);
+
+private:
+    static constexpr std::size_t BLOCK_BYTES = 64 << 10;
+    /// NAME_MAX: имя любой поддиректории помещается
+    static constexpr std::size_t MAX_REUSED_LENGTH = 255;
+
+    std::vector<std::unique_ptr<char[]> > m_blocks;
+    char *m_position = nullptr;
+    std::size_t m_available = 0;
+    /// Освобождённые места по длине строки
+    std::vector<std::vector<char *> > m_free;
+};
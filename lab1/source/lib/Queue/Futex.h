@@ -0,0 +1,17 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/// Тонкая обёртка над futex: ожидание, пока значение слова равно expected, и пробуждение ожидающих
+namespace futex {
+    inline void wait(std::atomic<std::uint32_t> &word, const std::uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    inline void wake(std::atomic<std::uint32_t> &word, const int count) {
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+}
@@ -0,0 +1,380 @@
+#pragma once
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <vector>
+
+#include "Futex.h"
+#include "Trace/Probes.h"
+
+/// Что делать производителю, если очередь заполнена
+enum class OverflowPolicy {
+    BLOCK,
+    DROP_OLDEST,
+    DROP_NEWEST,
+};
+
+/// Ограниченная lock-free очередь для многих производителей и одного потребителя.
+/// Кольцо ячеек с номерами последовательности (схема Д. Вьюкова); голова и хвост лежат в разных кэш-линиях.
+/// Потребитель засыпает на futex и будится только если действительно спит.
+/// Извлечение сделано через CAS, поэтому производитель при DROP_OLDEST может безопасно вытеснить старый элемент.
+/// Точки трассировки queue_push и queue_pop получают адрес очереди и число положенных или извлечённых элементов
+template<typename T>
+class MpscRingQueue {
+public:
+    /// false - элемент нельзя вытеснить при DROP_OLDEST (например, управляющее сообщение)
+    using Evictable = bool (*)(const T &value);
+
+    /// Без evictable вытесняется любой элемент. Если самый старый элемент вытеснять нельзя,
+    /// DROP_OLDEST отбрасывает новый
+    explicit MpscRingQueue(std::size_t capacity, OverflowPolicy policy = OverflowPolicy::BLOCK,
+                           Evictable evictable = nullptr);
+
+    MpscRingQueue(const MpscRingQueue &) = delete;
+
+    MpscRingQueue &operator=(const MpscRingQueue &) = delete;
+
+    /// Возвращает false, если элемент отброшен из-за переполнения
+    bool push(T value) { return push(std::move(value), m_policy.load(std::memory_order_relaxed)); }
+
+    bool push(T value, OverflowPolicy policy);
+
+    /// Кладёт все элементы, будит потребителя не более одного раза. Возвращает число принятых элементов
+    std::size_t pushBatch(std::span<const T> values);
+
+    /// Блокирует, пока очередь пуста
+    T pop();
+
+    bool try_pop(T &value);
+
+    /// Блокирует, пока очередь пуста, затем забирает до maxCount элементов
+    std::size_t popBatch(std::vector<T> &out, std::size_t maxCount);
+
+    /// Забирает до maxCount элементов, не блокируясь. Возвращает 0, если очередь пуста
+    std::size_t tryPopBatch(std::vector<T> &out, std::size_t maxCount);
+
+    void setOverflowPolicy(OverflowPolicy policy) { m_policy.store(policy, std::memory_order_relaxed); }
+
+    /// Будит производителей, ждущих места, и до open отказывает всем push и pushBatch: отказанные элементы
+    /// считаются в droppedNewest. Потребитель может дочитать то, что уже лежит в очереди. Нужен перед тем,
+    /// как потребитель перестаёт читать или ждёт поток, который может стоять на полной очереди
+    void close();
+
+    void open() { m_closed.store(false, std::memory_order_release); }
+
+    [[nodiscard]] bool isClosed() const { return m_closed.load(std::memory_order_acquire); }
+
+    [[nodiscard]] std::size_t capacity() const { return m_mask + 1; }
+
+    /// Приблизительное число элементов
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] std::uint64_t droppedOldest() const { return m_droppedOldest.load(std::memory_order_relaxed); }
+
+    [[nodiscard]] std::uint64_t droppedNewest() const { return m_droppedNewest.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t CACHE_LINE = 64;
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        /// Записывается до sequence: вытесняющий производитель читает его, не забирая value
+        std::atomic<bool> pinned;
+        T value;
+    };
+
+    /// Забирает value только при успехе
+    template<typename U>
+    bool tryEnqueue(U &&value);
+
+    bool tryDequeue(T &value);
+
+    /// Выбрасывает самый старый элемент. false, если его нельзя вытеснить; true и при пустой очереди
+    bool tryEvictOldest();
+
+    void wakeConsumer();
+
+    void wakeProducers();
+
+    void waitForData();
+
+    std::unique_ptr<Cell[]> m_cells;
+    std::size_t m_mask;
+    std::atomic<OverflowPolicy> m_policy;
+    Evictable m_evictable;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0};
+    alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0};
+
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> m_consumerSleeping{0};
+    alignas(CACHE_LINE) std::atomic<std::uint32_t> m_spaceEpoch{0};
+    std::atomic<std::uint32_t> m_producersWaiting{0};
+    std::atomic<bool> m_closed{false};
+
+    alignas(CACHE_LINE) std::atomic<std::uint64_t> m_droppedOldest{0};
+    std::atomic<std::uint64_t> m_droppedNewest{0};
+};
+
+template<typename T>
+MpscRingQueue<T>::MpscRingQueue(const std::size_t capacity, const OverflowPolicy policy, const Evictable evictable)
+    : m_cells{std::make_unique<Cell[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))},
+      m_mask{std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1},
+      m_policy{policy},
+      m_evictable{evictable} {
+    for (std::size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template<typename T>
+template<typename U>
+bool MpscRingQueue<T>::tryEnqueue(U &&value) {
+    std::size_t position = m_tail.load(std::memory_order_relaxed);
+    while (true) {
+        Cell &cell = m_cells[position & m_mask];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (diff == 0) {
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.pinned.store(m_evictable && !m_evictable(value), std::memory_order_relaxed);
+                cell.value = std::forward<U>(value);
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool MpscRingQueue<T>::tryDequeue(T &value) {
+    std::size_t position = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        Cell &cell = m_cells[position & m_mask];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                value = std::move(cell.value);
+                cell.value = T{};
+                cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            position = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template<typename T>
+bool MpscRingQueue<T>::push(T value, const OverflowPolicy policy) {
+    if (m_closed.load(std::memory_order_acquire)) {
+        m_droppedNewest.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    while (!tryEnqueue(std::move(value))) {
+        switch (policy) {
+            case OverflowPolicy::DROP_NEWEST:
+                m_droppedNewest.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            case OverflowPolicy::DROP_OLDEST:
+                if (!tryEvictOldest()) {
+                    m_droppedNewest.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                break;
+            case OverflowPolicy::BLOCK: {
+                const std::uint32_t epoch = m_spaceEpoch.load(std::memory_order_acquire);
+                m_producersWaiting.fetch_add(1, std::memory_order_seq_cst);
+                if (!tryEnqueue(std::move(value))) {
+                    // close сначала выставляет флаг, затем меняет эпоху: либо флаг виден здесь,
+                    // либо эпоха уже не равна epoch и futex::wait сразу вернётся
+                    if (!m_closed.load(std::memory_order_seq_cst)) {
+                        futex::wait(m_spaceEpoch, epoch);
+                    }
+                    m_producersWaiting.fetch_sub(1, std::memory_order_relaxed);
+                    if (m_closed.load(std::memory_order_acquire)) {
+                        m_droppedNewest.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    continue;
+                }
+                m_producersWaiting.fetch_sub(1, std::memory_order_relaxed);
+                DISK_MONITOR_PROBE2(queue_push, this, 1);
+                wakeConsumer();
+                return true;
+            }
+        }
+    }
+    DISK_MONITOR_PROBE2(queue_push, this, 1);
+    wakeConsumer();
+    return true;
+}
+
+template<typename T>
+std::size_t MpscRingQueue<T>::pushBatch(std::span<const T> values) {
+    if (m_closed.load(std::memory_order_acquire)) {
+        m_droppedNewest.fetch_add(values.size(), std::memory_order_relaxed);
+        return 0;
+    }
+    const OverflowPolicy policy = m_policy.load(std::memory_order_relaxed);
+    std::size_t accepted = 0;
+    // Элементы, положенные через push, он отмечает в точке трассировки сам
+    std::size_t enqueued = 0;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if (tryEnqueue(values[i])) {
+            ++accepted;
+            ++enqueued;
+            continue;
+        }
+        // Медленный путь: разбудить потребителя заранее, чтобы он освобождал место
+        wakeConsumer();
+        if (push(values[i], policy)) {
+            ++accepted;
+        } else if (m_closed.load(std::memory_order_acquire)) {
+            m_droppedNewest.fetch_add(values.size() - i - 1, std::memory_order_relaxed);
+            break;
+        }
+    }
+    DISK_MONITOR_PROBE2(queue_push, this, enqueued);
+    if (accepted) {
+        wakeConsumer();
+    }
+    return accepted;
+}
+
+template<typename T>
+bool MpscRingQueue<T>::tryEvictOldest() {
+    std::size_t position = m_head.load(std::memory_order_relaxed);
+    while (true) {
+        Cell &cell = m_cells[position & m_mask];
+        const std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+        if (diff < 0) {
+            return true;
+        }
+        if (diff > 0) {
+            position = m_head.load(std::memory_order_relaxed);
+            continue;
+        }
+        // Ячейку могли уже забрать и заполнить снова: тогда флаг устарел, и новый элемент отбрасывается зря,
+        // но управляющий элемент не теряется никогда
+        if (cell.pinned.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+            cell.value = T{};
+            cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+            m_droppedOldest.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+}
+
+template<typename T>
+void MpscRingQueue<T>::close() {
+    m_closed.store(true, std::memory_order_seq_cst);
+    m_spaceEpoch.fetch_add(1, std::memory_order_seq_cst);
+    futex::wake(m_spaceEpoch, INT32_MAX);
+}
+
+template<typename T>
+void MpscRingQueue<T>::wakeConsumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_consumerSleeping.load(std::memory_order_relaxed) && m_consumerSleeping.exchange(0)) {
+        futex::wake(m_consumerSleeping, 1);
+    }
+}
+
+template<typename T>
+void MpscRingQueue<T>::wakeProducers() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Будим заблокированных производителей только когда освободилась половина очереди,
+    // иначе каждый pop на заполненной очереди превращается в массовое пробуждение
+    if (m_producersWaiting.load(std::memory_order_relaxed) && size() <= capacity() / 2) {
+        m_spaceEpoch.fetch_add(1, std::memory_order_release);
+        futex::wake(m_spaceEpoch, INT32_MAX);
+    }
+}
+
+template<typename T>
+void MpscRingQueue<T>::waitForData() {
+    m_consumerSleeping.store(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    // Перепроверка после выставления флага: производитель, положивший элемент раньше, мог не увидеть флаг
+    if (m_cells[head & m_mask].sequence.load(std::memory_order_acquire) == head + 1) {
+        m_consumerSleeping.store(0, std::memory_order_relaxed);
+        return;
+    }
+    futex::wait(m_consumerSleeping, 1);
+    m_consumerSleeping.store(0, std::memory_order_relaxed);
+}
+
+template<typename T>
+T MpscRingQueue<T>::pop() {
+    T value;
+    while (!tryDequeue(value)) {
+        waitForData();
+    }
+    DISK_MONITOR_PROBE2(queue_pop, this, 1);
+    wakeProducers();
+    return value;
+}
+
+template<typename T>
+bool MpscRingQueue<T>::try_pop(T &value) {
+    if (!tryDequeue(value)) {
+        return false;
+    }
+    DISK_MONITOR_PROBE2(queue_pop, this, 1);
+    wakeProducers();
+    return true;
+}
+
+template<typename T>
+std::size_t MpscRingQueue<T>::popBatch(std::vector<T> &out, const std::size_t maxCount) {
+    T value;
+    while (!tryDequeue(value)) {
+        waitForData();
+    }
+    out.push_back(std::move(value));
+    std::size_t count = 1;
+    while (count < maxCount && tryDequeue(value)) {
+        out.push_back(std::move(value));
+        ++count;
+    }
+    DISK_MONITOR_PROBE2(queue_pop, this, count);
+    wakeProducers();
+    return count;
+}
+
+template<typename T>
+std::size_t MpscRingQueue<T>::tryPopBatch(std::vector<T> &out, const std::size_t maxCount) {
+    T value;
+    std::size_t count = 0;
+    while (count < maxCount && tryDequeue(value)) {
+        out.push_back(std::move(value));
+        ++count;
+    }
+    if (count) {
+        DISK_MONITOR_PROBE2(queue_pop, this, count);
+        wakeProducers();
+    }
+    return count;
+}
+
+template<typename T>
+std::size_t MpscRingQueue<T>::size() const {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
@@ -3,6 +3,8 @@
 #include <mutex>
 #include <condition_variable>
 
+#include "Trace/Probes.h"
+
 template<typename T>
 class ThreadSafeQueue {
 public:
@@ -11,6 +13,7 @@ public:
             std::lock_guard lock{m_mutex};
             m_queue.push(std::move(value));
         }
+        DISK_MONITOR_PROBE2(queue_push, this, 1);
         m_cv.notify_one();
     }
 
@@ -19,6 +22,7 @@ public:
         m_cv.wait(lock, [this] { return !m_queue.empty(); });
         T value = std::move(m_queue.front());
         m_queue.pop();
+        DISK_MONITOR_PROBE2(queue_pop, this, 1);
         return value;
     }
 
@@ -29,6 +33,7 @@ public:
         }
         value = std::move(m_queue.front());
         m_queue.pop();
+        DISK_MONITOR_PROBE2(queue_pop, this, 1);
         return true;
     }
 
@@ -0,0 +1,165 @@
+#include "LogRateLimiter.h"
+
+#include <algorithm>
+#include <format>
+#include <string_view>
+
+#include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Paths/DirectoryRegistry.h"
+#include "Reactor/MainReactor.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    constexpr std::array<std::string_view, FileChangedInd::ACTIONS_COUNT> ACTION_NAMES = {
+        "created", "deleted", "modified", "renamed", "moved in", "moved out", "finished writing", "attributes changed",
+    };
+
+    /// Запас таблицы SpaceSaving относительно числа показываемых имён: чем он больше, тем точнее верхние счётчики
+    constexpr std::size_t NAMES_PER_SHOWN = 8;
+}
+
+LogRateLimiter::Storm::Storm(const std::size_t namesCapacity, const std::int64_t nowNs)
+    : startNs{nowNs}, names{namesCapacity} {
+}
+
+LogRateLimiter::LogRateLimiter(const LogRateLimitConfig &config)
+    : m_config{config}, m_rate{config.rate}, m_burst{config.burst},
+      m_tickTimer{MainReactor::instance().addTimer([this] { tick(); })} {
+    SystemLogger::instance().info(std::format("Event log limited to {} lines/s per directory, {} lines/s in total",
+                                              m_config.rate, m_config.totalRate));
+}
+
+LogRateLimiter::~LogRateLimiter() {
+    MainReactor::instance().removeTimer(m_tickTimer);
+    const auto nowNs = monotonicNs();
+    std::vector<std::string> lines;
+    for (const auto &[directoryId, directory]: m_directories) {
+        if (directory.storm && directory.storm->events) {
+            lines.push_back(summary(directoryId, *directory.storm, nowNs));
+        }
+    }
+    Metrics::instance().stormDirectories.set(0);
+    log(lines);
+}
+
+bool LogRateLimiter::admit(const FileChangedInd &event) {
+    const auto nowNs = monotonicNs();
+    std::string started;
+    {
+        std::lock_guard lock{m_mutex};
+        auto it = m_directories.find(event.directoryId);
+        if (it == m_directories.end()) {
+            if (m_directories.empty()) {
+                Reactor::armTimer(m_tickTimer, 1s, 1s);
+            }
+            it = m_directories.emplace(event.directoryId, Directory{TokenBucket{m_rate, m_burst, nowNs}}).first;
+        }
+        auto &directory = it->second;
+        ++directory.recentEvents;
+        directory.lastEventNs = nowNs;
+        if (!directory.storm) {
+            if (directory.bucket.take(nowNs)) {
+                return true;
+            }
+            directory.storm = std::make_unique<Storm>(m_config.topNames * NAMES_PER_SHOWN, nowNs);
+            started = std::format("Event storm in directory {}: over {:.0f} events/s, logging summaries every {} s",
+                                  DirectoryRegistry::instance().path(event.directoryId).string(), m_rate,
+                                  m_config.summaryInterval.count());
+        }
+
+        auto &storm = *directory.storm;
+        ++storm.events;
+        storm.actions[static_cast<std::size_t>(event.action)] += event.count;
+        storm.names.add(event.fileName(), event.count);
+    }
+
+    Metrics::instance().eventLogsSuppressed.add();
+    if (!started.empty()) {
+        log({started});
+    }
+    return false;
+}
+
+void LogRateLimiter::tick() {
+    const auto nowNs = monotonicNs();
+    const auto intervalNs = std::chrono::nanoseconds{m_config.summaryInterval}.count();
+    // Затихшая директория с полным ведром ничем не отличается от новой
+    const auto forgetNs = std::max<std::int64_t>(intervalNs, static_cast<std::int64_t>(
+                                                     m_config.burst / m_config.rate * 1e9));
+    std::vector<std::string> lines;
+    {
+        std::lock_guard lock{m_mutex};
+        const auto active = std::ranges::count_if(m_directories, [](const auto &entry) {
+            return entry.second.recentEvents > 0;
+        });
+        m_rate = std::min(m_config.rate, m_config.totalRate / static_cast<double>(std::max<std::ptrdiff_t>(active, 1)));
+        m_burst = m_config.burst * m_rate / m_config.rate;
+
+        std::int64_t storms = 0;
+        for (auto it = m_directories.begin(); it != m_directories.end();) {
+            auto &[directoryId, directory] = *it;
+            directory.bucket.setLimits(m_rate, m_burst, nowNs);
+            directory.recentEvents = 0;
+            if (directory.storm && nowNs - directory.storm->startNs >= intervalNs) {
+                if (directory.storm->events) {
+                    lines.push_back(summary(directoryId, *directory.storm, nowNs));
+                }
+                // Гистерезис: шторм кончается, когда событий за период меньше половины бюджета, а не всего бюджета,
+                // иначе директория на границе бюджета переключалась бы каждый период
+                const double budget = m_rate * static_cast<double>(m_config.summaryInterval.count());
+                if (static_cast<double>(directory.storm->events) < budget / 2) {
+                    lines.push_back(std::format("Event storm in directory {} ended",
+                                                DirectoryRegistry::instance().path(directoryId).string()));
+                    directory.storm.reset();
+                    directory.bucket.fill(nowNs);
+                } else {
+                    directory.storm = std::make_unique<Storm>(m_config.topNames * NAMES_PER_SHOWN, nowNs);
+                }
+            }
+
+            if (!directory.storm && nowNs - directory.lastEventNs >= forgetNs) {
+                it = m_directories.erase(it);
+                continue;
+            }
+            storms += directory.storm ? 1 : 0;
+            ++it;
+        }
+        if (m_directories.empty()) {
+            Reactor::armTimer(m_tickTimer, {});
+        }
+        Metrics::instance().stormDirectories.set(storms);
+    }
+    log(lines);
+}
+
+std::string LogRateLimiter::summary(const std::uint32_t directoryId, const Storm &storm,
+                                    const std::int64_t nowNs) const {
+    auto line = std::format("Event storm in directory {}:", DirectoryRegistry::instance().path(directoryId).string());
+    const char *separator = " ";
+    for (std::size_t action = 0; action < storm.actions.size(); ++action) {
+        if (storm.actions[action]) {
+            line += std::format("{}{} {}", separator, storm.actions[action], ACTION_NAMES[action]);
+            separator = ", ";
+        }
+    }
+    line += std::format(" in {} s", std::max<std::int64_t>((nowNs - storm.startNs + 500'000'000) / 1'000'000'000, 1));
+
+    // Имена, встреченные по разу (rm -rf, распаковка архива), ничего не говорят о шторме
+    separator = ", top names: ";
+    for (const auto &entry: storm.names.top(m_config.topNames)) {
+        if (entry.count - entry.error > 1) {
+            line += std::format("{}{} ({})", separator, entry.key, entry.count - entry.error);
+            separator = ", ";
+        }
+    }
+    return line;
+}
+
+void LogRateLimiter::log(const std::vector<std::string> &lines) const {
+    auto &logger = SystemLogger::instance();
+    for (const auto &line: lines) {
+        logger.log(SystemLogger::INFO, line, SystemLogger::LOCAL0);
+    }
+}
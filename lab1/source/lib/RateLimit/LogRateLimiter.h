@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SpaceSaving.h"
+#include "TokenBucket.h"
+#include "Config/Config.h"
+#include "Observer/Messages.h"
+
+/// Ограничение числа строк лога о событиях. У каждой директории своё ведро маркеров; директория, исчерпавшая
+/// его (сборка, rm -rf), переходит в режим шторма: события не пишутся по одному, а раз в summaryInterval
+/// выходит сводка с числом событий по действиям и самыми частыми именами (SpaceSaving). Когда за период
+/// событий становится меньше половины бюджета, шторм заканчивается и директория снова пишется по событию.
+/// Бюджет директории - меньшее из rate и доли totalRate на каждую активную директорию, поэтому шторм,
+/// размазанный по множеству поддиректорий, тоже ограничивается. Сводки пишет таймер на потоке MainReactor
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(const LogRateLimitConfig &config);
+
+    /// Пишет сводки по незакончившимся штормам
+    ~LogRateLimiter();
+
+    LogRateLimiter(const LogRateLimiter &) = delete;
+
+    LogRateLimiter &operator=(const LogRateLimiter &) = delete;
+
+    /// true - событие пишется в лог как обычно, false - учтено в сводке шторма
+    bool admit(const FileChangedInd &event);
+
+private:
+    struct Storm {
+        explicit Storm(std::size_t namesCapacity, std::int64_t nowNs);
+
+        std::int64_t startNs;
+        std::uint64_t events = 0;
+        std::array<std::uint64_t, FileChangedInd::ACTIONS_COUNT> actions{};
+        SpaceSaving names;
+    };
+
+    struct Directory {
+        TokenBucket bucket;
+        /// Событий с прошлого тика, по ним считаются активные директории
+        std::uint64_t recentEvents = 0;
+        std::int64_t lastEventNs = 0;
+        /// nullptr - шторма нет
+        std::unique_ptr<Storm> storm;
+    };
+
+    /// Раз в секунду: пересчитывает бюджеты, пишет сводки и забывает затихшие директории
+    void tick();
+
+    /// Строка сводки. Вызывать под m_mutex
+    [[nodiscard]] std::string summary(std::uint32_t directoryId, const Storm &storm, std::int64_t nowNs) const;
+
+    void log(const std::vector<std::string> &lines) const;
+
+    LogRateLimitConfig m_config;
+    /// Текущий бюджет одной директории
+    double m_rate;
+    double m_burst;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::uint32_t, Directory> m_directories;
+    int m_tickTimer = -1;
+};
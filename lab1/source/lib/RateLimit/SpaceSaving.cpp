@@ -0,0 +1,40 @@
+#include "SpaceSaving.h"
+
+#include <algorithm>
+
+SpaceSaving::SpaceSaving(const std::size_t capacity) : m_capacity{std::max<std::size_t>(capacity, 1)} {
+    m_entries.reserve(m_capacity);
+    m_indexes.reserve(m_capacity);
+}
+
+void SpaceSaving::add(const std::string_view key, const std::uint64_t weight) {
+    if (const auto it = m_indexes.find(key); it != m_indexes.end()) {
+        m_entries[it->second].count += weight;
+        return;
+    }
+    if (m_entries.size() < m_capacity) {
+        m_indexes.emplace(key, m_entries.size());
+        m_entries.push_back(Entry{std::string{key}, weight, 0});
+        return;
+    }
+
+    // Таблица небольшая, линейный поиск минимума дешевле поддержки упорядоченной структуры
+    const auto rarest = std::ranges::min_element(m_entries, {}, &Entry::count);
+    auto node = m_indexes.extract(rarest->key);
+    node.key() = key;
+    m_indexes.insert(std::move(node));
+    rarest->key = key;
+    rarest->error = rarest->count;
+    rarest->count += weight;
+}
+
+std::vector<SpaceSaving::Entry> SpaceSaving::top(const std::size_t count) const {
+    std::vector<Entry> entries = m_entries;
+    const auto size = std::min(count, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(size), entries.end(),
+                      [](const Entry &left, const Entry &right) {
+                          return left.count - left.error > right.count - right.error;
+                      });
+    entries.resize(size);
+    return entries;
+}
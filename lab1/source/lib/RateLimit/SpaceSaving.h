@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Самые частые строки потока в памяти O(capacity), алгоритм Space-Saving (Metwally, Agrawal, El Abbadi).
+/// Новая строка при заполненной таблице вытесняет самую редкую и наследует её счётчик как погрешность.
+/// Строка, встретившаяся больше N / capacity раз из N, гарантированно в таблице,
+/// её count завышен не больше чем на error
+class SpaceSaving {
+public:
+    struct Entry {
+        std::string key;
+        std::uint64_t count = 0;
+        std::uint64_t error = 0;
+    };
+
+    explicit SpaceSaving(std::size_t capacity);
+
+    void add(std::string_view key, std::uint64_t weight = 1);
+
+    /// До count записей по убыванию гарантированной частоты count - error
+    [[nodiscard]] std::vector<Entry> top(std::size_t count) const;
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        std::size_t operator()(const std::string_view key) const { return std::hash<std::string_view>{}(key); }
+    };
+
+    std::size_t m_capacity;
+    std::vector<Entry> m_entries;
+    /// Значение - индекс в m_entries
+    std::unordered_map<std::string, std::size_t, Hash, std::equal_to<> > m_indexes;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+/// Ведро маркеров: пополняется со скоростью rate в секунду до burst, каждое действие забирает один маркер
+class TokenBucket {
+public:
+    TokenBucket(const double rate, const double burst, const std::int64_t nowNs)
+        : m_rate{rate}, m_burst{burst}, m_tokens{burst}, m_updatedNs{nowNs} {
+    }
+
+    /// false - маркеров нет, действие сверх бюджета
+    bool take(const std::int64_t nowNs) {
+        refill(nowNs);
+        if (m_tokens < 1) {
+            return false;
+        }
+        m_tokens -= 1;
+        return true;
+    }
+
+    /// Накопленные маркеры сохраняются, но не больше нового burst
+    void setLimits(const double rate, const double burst, const std::int64_t nowNs) {
+        refill(nowNs);
+        m_rate = rate;
+        m_burst = burst;
+        m_tokens = std::min(m_tokens, m_burst);
+    }
+
+    void fill(const std::int64_t nowNs) {
+        m_tokens = m_burst;
+        m_updatedNs = nowNs;
+    }
+
+    [[nodiscard]] double rate() const { return m_rate; }
+
+private:
+    void refill(const std::int64_t nowNs) {
+        if (nowNs > m_updatedNs) {
+            m_tokens = std::min(m_burst, m_tokens + m_rate * static_cast<double>(nowNs - m_updatedNs) / 1e9);
+            m_updatedNs = nowNs;
+        }
+    }
+
+    double m_rate;
+    double m_burst;
+    double m_tokens;
+    std::int64_t m_updatedNs;
+};
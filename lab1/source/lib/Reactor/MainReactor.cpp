@@ -0,0 +1,9 @@
+#include "MainReactor.h"
+
+MainReactor::MainReactor() : m_thread{&MainReactor::run, this} {
+}
+
+MainReactor::~MainReactor() {
+    stop();
+    m_thread.join();
+}
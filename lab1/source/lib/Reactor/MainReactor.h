@@ -0,0 +1,20 @@
+#pragma once
+#include <thread>
+
+#include "Reactor.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Общий цикл событий служебных подсистем на своём потоке: сигналы, слежение за конфигом, таймеры.
+/// Создавать после демонизации, уничтожать после всех, кто в нём зарегистрирован
+class MainReactor : public Reactor, public OnceInstantiated<MainReactor> {
+    friend class OnceInstantiated;
+
+public:
+    ~MainReactor() override;
+
+protected:
+    MainReactor();
+
+private:
+    std::thread m_thread;
+};
@@ -0,0 +1,187 @@
+#include "Reactor.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+Reactor::Reactor() {
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        perror("epoll_create1");
+        return;
+    }
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        perror("eventfd");
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event) < 0) {
+        perror("epoll_ctl");
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+}
+
+Reactor::~Reactor() {
+    for (const auto &[fd, registration]: m_handlers) {
+        if (registration->timer) {
+            close(fd);
+        }
+    }
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+    }
+}
+
+bool Reactor::add(const int fd, Handler handler, const std::uint32_t events) {
+    {
+        std::lock_guard lock{m_mutex};
+        m_handlers.insert_or_assign(fd, std::make_shared<Registration>(std::move(handler), false));
+    }
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        perror("epoll_ctl");
+        std::lock_guard lock{m_mutex};
+        m_handlers.erase(fd);
+        return false;
+    }
+    return true;
+}
+
+bool Reactor::modify(const int fd, const std::uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event) < 0) {
+        perror("epoll_ctl");
+        return false;
+    }
+    return true;
+}
+
+void Reactor::remove(const int fd) {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    std::shared_ptr<Registration> registration;
+    {
+        std::lock_guard lock{m_mutex};
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end()) {
+            return;
+        }
+        registration = std::move(it->second);
+        m_handlers.erase(it);
+    }
+    // На своём потоке ждать нечего: обработчик либо выполняется прямо сейчас (и это он вызвал remove),
+    // либо уже не найдёт себя в m_handlers. С другого потока он мог быть уже найден dispatch
+    if (std::this_thread::get_id() != m_runThread) {
+        std::lock_guard running{registration->running};
+        registration->removed = true;
+    }
+}
+
+int Reactor::addTimer(Handler handler) {
+    const int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    if (!add(timer, std::move(handler))) {
+        close(timer);
+        return -1;
+    }
+    std::lock_guard lock{m_mutex};
+    m_handlers[timer]->timer = true;
+    return timer;
+}
+
+void Reactor::removeTimer(const int timer) {
+    if (timer < 0) {
+        return;
+    }
+    remove(timer);
+    close(timer);
+}
+
+void Reactor::armTimer(const int timer, const std::chrono::nanoseconds delay, const std::chrono::nanoseconds interval) {
+    const auto toTimespec = [](const std::chrono::nanoseconds duration) {
+        return timespec{static_cast<time_t>(duration.count() / 1'000'000'000),
+                        static_cast<long>(duration.count() % 1'000'000'000)};
+    };
+    itimerspec spec{};
+    // Нулевое значение остановило бы таймер, поэтому уже наступивший срок - минимальная задержка
+    spec.it_value = delay.count() > 0 ? toTimespec(delay) : timespec{0, delay.count() < 0 ? 1 : 0};
+    spec.it_interval = toTimespec(interval);
+    timerfd_settime(timer, 0, &spec, nullptr);
+}
+
+void Reactor::run() {
+    m_runThread = std::this_thread::get_id();
+    constexpr int MAX_EVENTS = 16;
+    epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        const int n = epoll_wait(m_epollFd, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+
+        bool stopped = false;
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == m_wakeFd) {
+                std::uint64_t value;
+                stopped = read(m_wakeFd, &value, sizeof(value)) == sizeof(value) || stopped;
+                continue;
+            }
+            dispatch(events[i].data.fd);
+        }
+        if (stopped) {
+            break;
+        }
+    }
+    m_runThread = std::thread::id{};
+}
+
+void Reactor::stop() {
+    const std::uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+        perror("write");
+    }
+}
+
+void Reactor::dispatch(const int fd) {
+    std::shared_ptr<Registration> registration;
+    {
+        std::lock_guard lock{m_mutex};
+        const auto it = m_handlers.find(fd);
+        if (it == m_handlers.end()) {
+            return;
+        }
+        registration = it->second;
+    }
+    std::lock_guard running{registration->running};
+    if (registration->removed) {
+        return;
+    }
+    if (registration->timer) {
+        // Число срабатываний не важно, но без чтения timerfd так и останется готовым
+        std::uint64_t expirations;
+        if (read(fd, &expirations, sizeof(expirations)) < 0) {
+            return;
+        }
+    }
+    registration->handler();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <sys/epoll.h>
+
+/// Цикл событий на epoll. Обработчики дескрипторов и таймеров (timerfd) выполняются на потоке, вызвавшем run.
+/// Остановка и пробуждение - через eventfd, поэтому цикл спит, пока нет событий, и не опрашивает флаги
+class Reactor {
+public:
+    using Handler = std::function<void()>;
+
+    Reactor();
+
+    virtual ~Reactor();
+
+    Reactor(const Reactor &) = delete;
+
+    Reactor &operator=(const Reactor &) = delete;
+
+    [[nodiscard]] bool isOpen() const { return m_epollFd >= 0 && m_wakeFd >= 0; }
+
+    /// handler вызывается, когда fd готов к одному из events (по умолчанию к чтению). Можно вызывать с любого потока
+    bool add(int fd, Handler handler, std::uint32_t events = EPOLLIN);
+
+    /// Меняет ожидаемые события уже добавленного fd. Можно вызывать с любого потока
+    bool modify(int fd, std::uint32_t events);
+
+    /// После возврата обработчик fd не выполняется и больше не будет вызван. Дескриптор не закрывается.
+    /// С другого потока ждёт только сам этот обработчик, если он выполняется, а не всю пачку: остальные
+    /// обработчики могут стоять на очереди потока, вызвавшего remove. Нельзя вызывать с потока, которого
+    /// ждёт сам снимаемый обработчик
+    void remove(int fd);
+
+    /// Создаёт остановленный таймер, возвращает его дескриптор или -1
+    int addTimer(Handler handler);
+
+    /// Снимает таймер и закрывает его дескриптор
+    void removeTimer(int timer);
+
+    /// Взводит таймер на срабатывание через delay, затем каждые interval (нулевой - однократно).
+    /// Повторный вызов переносит срабатывание, нулевой delay останавливает таймер
+    static void armTimer(int timer, std::chrono::nanoseconds delay, std::chrono::nanoseconds interval = {});
+
+    /// Обрабатывает события, пока не вызван stop
+    void run();
+
+    /// Прерывает run. Можно вызывать с любого потока и из обработчиков
+    void stop();
+
+private:
+    struct Registration {
+        Registration(Handler handler, const bool timer) : handler{std::move(handler)}, timer{timer} {
+        }
+
+        Handler handler;
+        bool timer;
+        /// Захвачен, пока выполняется handler
+        std::mutex running;
+        /// Снят с другого потока: запись могла быть найдена до remove, но вызывать её уже нельзя. Под running
+        bool removed = false;
+    };
+
+    void dispatch(int fd);
+
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+
+    /// Защищает m_handlers
+    std::mutex m_mutex;
+    std::unordered_map<int, std::shared_ptr<Registration> > m_handlers;
+    std::atomic<std::thread::id> m_runThread;
+};
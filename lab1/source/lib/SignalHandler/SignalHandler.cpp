@@ -1,17 +1,12 @@
 #include "SignalHandler.h"
 
-#include <csignal>
 #include <cstring>
 #include <format>
-#include <syslog.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
 
 #include "Logger/SystemLogger.h"
-#include "Observer/Messages.h"
-
-/// Костыль, так как sa_handler принимает только Си-функцию
-void handleSignal(const int signal) {
-    SignalHandler::instance().handleSignal(signal);
-}
+#include "Observer/Message.h"
 
 SignalHandler::SignalHandler() {
     // Игнорируем SIGCHLD, чтобы не оставлять зомби (если мы форкаем дочерние процессы)
@@ -20,19 +15,45 @@ SignalHandler::SignalHandler() {
     sa_chld.sa_handler = SIG_IGN;
     sa_chld.sa_flags = SA_NOCLDWAIT;
     sigaction(SIGCHLD, &sa_chld, nullptr);
+    // Запись в закрытый клиентом сокет не должна завершать демон
+    signal(SIGPIPE, SIG_IGN);
+
+    sigemptyset(&m_signals);
+    for (const int sig: {SIGHUP, SIGTERM, SIGINT, SIGQUIT, SIGUSR1, SIGUSR2}) {
+        sigaddset(&m_signals, sig);
+    }
+    if (const int error = pthread_sigmask(SIG_BLOCK, &m_signals, nullptr); error != 0) {
+        SystemLogger::instance().warn(std::format("Cannot block signals: {}", strerror(error)));
+    }
+}
+
+SignalHandler::~SignalHandler() {
+    if (m_reactor) {
+        m_reactor->remove(m_signalFd);
+    }
+    if (m_signalFd >= 0) {
+        close(m_signalFd);
+    }
+}
+
+void SignalHandler::start(Reactor &reactor) {
+    if (m_signalFd >= 0) {
+        return;
+    }
+    m_signalFd = signalfd(-1, &m_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_signalFd < 0) {
+        SystemLogger::instance().error(std::format("signalfd failed: {}", strerror(errno)));
+        return;
+    }
+    if (reactor.add(m_signalFd, [this] { drainSignals(); })) {
+        m_reactor = &reactor;
+    }
+}
 
-    for (int sig = 1; sig < NSIG; ++sig) {
-        if (sig == SIGKILL || sig == SIGSTOP || sig == SIGCHLD) {
-            continue;
-        }
-        struct sigaction sa{};
-        std::memset(&sa, 0, sizeof(sa));
-        sa.sa_handler = ::handleSignal;
-        sigemptyset(&sa.sa_mask);
-        sa.sa_flags = 0;
-        if (sigaction(sig, &sa, nullptr) < 0) {
-            SystemLogger::instance().warn(std::format("sigaction({}) failed: {}", strsignal(sig), strerror(errno)));
-        }
+void SignalHandler::drainSignals() {
+    signalfd_siginfo info{};
+    while (read(m_signalFd, &info, sizeof(info)) == sizeof(info)) {
+        handleSignal(static_cast<int>(info.ssi_signo));
     }
 }
 
@@ -40,10 +61,10 @@ void SignalHandler::handleSignal(const int signal) {
     SystemLogger::instance().info(std::format("Received signal {}", strsignal(signal)));
     switch (signal) {
         case SIGHUP:
-            notify(std::make_shared<ReloadConfigRequest>());
+            notify(ReloadConfigRequest{});
             break;
         case SIGTERM:
-            notify(std::make_shared<StopRequest>());
+            notify(StopRequest{});
             break;
         default:
             SystemLogger::instance().warn(std::format("Unexpected signal {}, ignoring", strsignal(signal)));
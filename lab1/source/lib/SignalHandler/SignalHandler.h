@@ -1,10 +1,31 @@
 #pragma once
+#include <csignal>
+
 #include "Observer/Subject.h"
 #include "OnceInstantiated/OnceInstantiated.h"
+#include "Reactor/Reactor.h"
 
+/// Принимает сигналы через signalfd в обычном потоке, а не в обработчике сигнала: ни логгер, ни очередь
+/// сообщений не безопасны для вызова в контексте сигнала
 class SignalHandler : public Subject<>, public OnceInstantiated<SignalHandler> {
+    friend class OnceInstantiated;
+
 public:
-    explicit SignalHandler();
+    ~SignalHandler() override;
+
+    /// Начинает принимать сигналы в цикле reactor. До этого они остаются заблокированными и ждут в очереди ядра
+    void start(Reactor &reactor);
 
     void handleSignal(int signal);
+
+protected:
+    /// Блокирует принимаемые сигналы. Вызывать до создания потоков: они наследуют маску сигналов
+    SignalHandler();
+
+private:
+    void drainSignals();
+
+    sigset_t m_signals{};
+    int m_signalFd = -1;
+    Reactor *m_reactor = nullptr;
 };
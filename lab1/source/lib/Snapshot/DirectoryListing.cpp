@@ -0,0 +1,76 @@
+#include "DirectoryListing.h"
+
+#include <algorithm>
+
+void DirectoryListing::add(const std::string_view name, const Attributes &attributes) {
+    m_entries.push_back(makeEntry(name, attributes));
+}
+
+void DirectoryListing::sort() {
+    std::ranges::sort(m_entries, [this](const Entry &left, const Entry &right) {
+        return name(left) < name(right);
+    });
+}
+
+void DirectoryListing::upsert(const std::string_view name, const Attributes &attributes) {
+    const auto it = lowerBound(name);
+    if (it != m_entries.end() && this->name(*it) == name) {
+        const auto index = it - m_entries.begin();
+        m_entries[index].type = attributes.type;
+        m_entries[index].inode = attributes.inode;
+        m_entries[index].size = attributes.size;
+        m_entries[index].modifiedNs = attributes.modifiedNs;
+        return;
+    }
+    const auto index = it - m_entries.begin();
+    const auto entry = makeEntry(name, attributes);
+    m_entries.insert(m_entries.begin() + index, entry);
+}
+
+void DirectoryListing::erase(const std::string_view name) {
+    const auto it = lowerBound(name);
+    if (it == m_entries.end() || this->name(*it) != name) {
+        return;
+    }
+    m_deadNameBytes += it->nameLength;
+    m_entries.erase(it);
+    if (m_deadNameBytes > m_names.size() / 2) {
+        compactNames();
+    }
+}
+
+const DirectoryListing::Entry *DirectoryListing::find(const std::string_view name) const {
+    const auto it = lowerBound(name);
+    if (it == m_entries.end() || this->name(*it) != name) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::vector<DirectoryListing::Entry>::const_iterator DirectoryListing::lowerBound(const std::string_view name) const {
+    return std::lower_bound(m_entries.begin(), m_entries.end(), name,
+                            [this](const Entry &entry, const std::string_view value) {
+                                return this->name(entry) < value;
+                            });
+}
+
+DirectoryListing::Entry DirectoryListing::makeEntry(const std::string_view name, const Attributes &attributes) {
+    const auto offset = static_cast<std::uint32_t>(m_names.size());
+    m_names.append(name);
+    return {
+        attributes.inode, attributes.size, attributes.modifiedNs, offset, static_cast<std::uint16_t>(name.size()),
+        attributes.type
+    };
+}
+
+void DirectoryListing::compactNames() {
+    std::string names;
+    names.reserve(m_names.size() - m_deadNameBytes);
+    for (auto &entry: m_entries) {
+        const auto offset = static_cast<std::uint32_t>(names.size());
+        names.append(name(entry));
+        entry.nameOffset = offset;
+    }
+    m_names = std::move(names);
+    m_deadNameBytes = 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Содержимое одной директории в компактном виде: отсортированный по имени массив записей
+/// фиксированного размера и общий буфер имён. Поиск - двоичный, сравнение двух снимков - слиянием
+class DirectoryListing {
+public:
+    enum class Type : std::uint8_t {
+        FILE,
+        DIRECTORY,
+        OTHER,
+    };
+
+    struct Attributes {
+        Type type = Type::FILE;
+        std::uint64_t inode = 0;
+        std::uint64_t size = 0;
+        std::int64_t modifiedNs = 0;
+
+        bool operator==(const Attributes &) const = default;
+    };
+
+    struct Entry {
+        std::uint64_t inode;
+        std::uint64_t size;
+        std::int64_t modifiedNs;
+        std::uint32_t nameOffset;
+        std::uint16_t nameLength;
+        Type type;
+
+        [[nodiscard]] Attributes attributes() const { return {type, inode, size, modifiedNs}; }
+    };
+
+    static_assert(sizeof(Entry) == 32);
+
+    /// Добавление при построении снимка. После серии add нужно вызвать sort
+    void add(std::string_view name, const Attributes &attributes);
+
+    void sort();
+
+    void upsert(std::string_view name, const Attributes &attributes);
+
+    void erase(std::string_view name);
+
+    [[nodiscard]] const Entry *find(std::string_view name) const;
+
+    [[nodiscard]] std::string_view name(const Entry &entry) const {
+        return {m_names.data() + entry.nameOffset, entry.nameLength};
+    }
+
+    [[nodiscard]] const std::vector<Entry> &entries() const { return m_entries; }
+
+    [[nodiscard]] std::size_t memoryUsage() const {
+        return m_entries.capacity() * sizeof(Entry) + m_names.capacity();
+    }
+
+    /// Обходит различия между снимками: onCreated(name, attributes) для имён, которых нет в this,
+    /// onDeleted(name, attributes) для пропавших и onModified(name, attributes) для изменившихся файлов
+    template<typename OnCreated, typename OnDeleted, typename OnModified>
+    void diff(const DirectoryListing &current, OnCreated onCreated, OnDeleted onDeleted,
+              OnModified onModified) const;
+
+private:
+    std::vector<Entry>::const_iterator lowerBound(std::string_view name) const;
+
+    Entry makeEntry(std::string_view name, const Attributes &attributes);
+
+    /// Удалённые имена остаются в буфере, пока их не станет больше живых
+    void compactNames();
+
+    std::vector<Entry> m_entries;
+    std::string m_names;
+    std::size_t m_deadNameBytes = 0;
+};
+
+template<typename OnCreated, typename OnDeleted, typename OnModified>
+void DirectoryListing::diff(const DirectoryListing &current, OnCreated onCreated, OnDeleted onDeleted,
+                            OnModified onModified) const {
+    auto previous = m_entries.begin();
+    auto next = current.m_entries.begin();
+    while (previous != m_entries.end() || next != current.m_entries.end()) {
+        if (next == current.m_entries.end()) {
+            onDeleted(name(*previous), previous->attributes());
+            ++previous;
+            continue;
+        }
+        if (previous == m_entries.end()) {
+            onCreated(current.name(*next), next->attributes());
+            ++next;
+            continue;
+        }
+
+        const auto previousName = name(*previous);
+        const auto nextName = current.name(*next);
+        if (previousName < nextName) {
+            onDeleted(previousName, previous->attributes());
+            ++previous;
+        } else if (nextName < previousName) {
+            onCreated(nextName, next->attributes());
+            ++next;
+        } else {
+            if (next->type != Type::DIRECTORY && previous->attributes() != next->attributes()) {
+                onModified(nextName, next->attributes());
+            }
+            ++previous;
+            ++next;
+        }
+    }
+}
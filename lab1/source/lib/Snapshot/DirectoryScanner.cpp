@@ -0,0 +1,78 @@
+#include "DirectoryScanner.h"
+
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Filter/NameFilter.h"
+
+namespace {
+    constexpr unsigned STATX_MASK = STATX_TYPE | STATX_INO | STATX_SIZE | STATX_MTIME;
+
+    DirectoryListing::Attributes toAttributes(const struct statx &status) {
+        DirectoryListing::Type type = DirectoryListing::Type::OTHER;
+        if (S_ISREG(status.stx_mode)) {
+            type = DirectoryListing::Type::FILE;
+        } else if (S_ISDIR(status.stx_mode)) {
+            type = DirectoryListing::Type::DIRECTORY;
+        }
+        return {
+            type, status.stx_ino, status.stx_size,
+            static_cast<std::int64_t>(status.stx_mtime.tv_sec) * 1'000'000'000 + status.stx_mtime.tv_nsec
+        };
+    }
+}
+
+std::optional<DirectoryListing> DirectoryScanner::scan(const std::filesystem::path &directory,
+                                                       const NameFilter *filter) {
+    const int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) {
+        return std::nullopt;
+    }
+
+    DirectoryListing listing;
+    alignas(dirent64) char buffer[GETDENTS_BUFFER_SIZE];
+    while (true) {
+        const ssize_t length = getdents64(dirFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *entry = reinterpret_cast<const dirent64 *>(buffer + offset);
+            offset += entry->d_reclen;
+            if (std::strcmp(entry->d_name, ".") == 0 || std::strcmp(entry->d_name, "..") == 0) {
+                continue;
+            }
+            // Тип из getdents64 известен почти на всех файловых системах, тогда statx не нужен
+            if (filter && entry->d_type != DT_UNKNOWN && !filter->accepts(entry->d_name, entry->d_type == DT_DIR)) {
+                continue;
+            }
+
+            struct statx status{};
+            if (statx(dirFd, entry->d_name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_MASK, &status) != 0) {
+                // Файл удалён между getdents64 и statx
+                continue;
+            }
+            const auto attributes = toAttributes(status);
+            if (filter && entry->d_type == DT_UNKNOWN &&
+                !filter->accepts(entry->d_name, attributes.type == DirectoryListing::Type::DIRECTORY)) {
+                continue;
+            }
+            listing.add(entry->d_name, attributes);
+        }
+    }
+    close(dirFd);
+
+    listing.sort();
+    return listing;
+}
+
+std::optional<DirectoryListing::Attributes> DirectoryScanner::stat(const std::filesystem::path &path) {
+    struct statx status{};
+    if (statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_MASK, &status) != 0) {
+        return std::nullopt;
+    }
+    return toAttributes(status);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+
+#include "DirectoryListing.h"
+
+class NameFilter;
+
+/// Чтение директорий напрямую через getdents64 и statx относительно дескриптора директории,
+/// без промежуточных dirent-структур libc и построения полных путей
+class DirectoryScanner {
+public:
+    /// nullopt, если директорию не удалось открыть. Имена, отвергнутые filter, пропускаются без statx
+    static std::optional<DirectoryListing> scan(const std::filesystem::path &directory,
+                                                const NameFilter *filter = nullptr);
+
+    /// Атрибуты одного файла. nullopt, если файла уже нет
+    static std::optional<DirectoryListing::Attributes> stat(const std::filesystem::path &path);
+
+private:
+    static constexpr std::size_t GETDENTS_BUFFER_SIZE = 32 * 1024;
+};
@@ -0,0 +1,219 @@
+#include "SnapshotIndex.h"
+
+#include <mutex>
+#include <ranges>
+#include <unordered_set>
+
+#include "DirectoryScanner.h"
+#include "Paths/DirectoryRegistry.h"
+
+SnapshotIndex::SnapshotIndex() : m_updateThread{&SnapshotIndex::updateLoop, this} {
+}
+
+SnapshotIndex::~SnapshotIndex() {
+    {
+        std::lock_guard lock{m_updatesMutex};
+        m_running = false;
+    }
+    m_updatesCv.notify_all();
+    m_appliedCv.notify_all();
+    m_updateThread.join();
+}
+
+void SnapshotIndex::replace(const std::uint32_t directoryId, DirectoryListing listing) {
+    std::lock_guard lock{m_mutex};
+    m_listings.insert_or_assign(directoryId, std::move(listing));
+}
+
+void SnapshotIndex::remove(const std::uint32_t directoryId) {
+    std::lock_guard lock{m_mutex};
+    m_listings.erase(directoryId);
+}
+
+void SnapshotIndex::clear() {
+    std::lock_guard lock{m_mutex};
+    m_listings.clear();
+}
+
+void SnapshotIndex::apply(const std::span<const Message> messages) {
+    struct Update {
+        std::uint32_t directoryId;
+        std::string_view name;
+        /// Файла больше нет по этому имени
+        bool removed;
+        std::optional<DirectoryListing::Attributes> attributes;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const std::pair<std::uint32_t, std::string_view> &key) const {
+            return std::hash<std::string_view>{}(key.second) ^ (std::size_t{key.first} * 0x9e3779b97f4a7c15);
+        }
+    };
+
+    // Идём с конца: более ранние события о том же файле уже ничего не меняют
+    std::vector<Update> updates;
+    std::unordered_set<std::pair<std::uint32_t, std::string_view>, KeyHash> seen;
+    for (const auto &message: messages | std::views::reverse) {
+        const auto *event = std::get_if<FileChangedInd>(&message);
+        if (!event) {
+            continue;
+        }
+        if (seen.emplace(event->directoryId, event->fileName()).second) {
+            updates.push_back({event->directoryId, event->fileName(), event->removesFile(), std::nullopt});
+        }
+        // Переименование - это ещё и исчезновение прежнего имени
+        if (event->action == FileChangedInd::Action::RENAMED &&
+            seen.emplace(event->previousDirectoryId, event->previousName()).second) {
+            updates.push_back({event->previousDirectoryId, event->previousName(), true, std::nullopt});
+        }
+    }
+    if (updates.empty()) {
+        return;
+    }
+
+    // Атрибуты читаются без блокировки, чтобы не задерживать запросы
+    std::unordered_map<std::uint32_t, std::filesystem::path> directories;
+    for (auto &update: updates) {
+        if (update.removed) {
+            continue;
+        }
+        auto [directory, inserted] = directories.try_emplace(update.directoryId);
+        if (inserted) {
+            directory->second = DirectoryRegistry::instance().path(update.directoryId);
+        }
+        update.attributes = DirectoryScanner::stat(directory->second / update.name);
+    }
+
+    std::lock_guard lock{m_mutex};
+    for (const auto &[directoryId, name, removed, attributes]: updates) {
+        const auto listing = m_listings.find(directoryId);
+        if (listing == m_listings.end()) {
+            continue;
+        }
+        // Файл, пропавший до statx, скоро придёт событием DELETED
+        if (attributes) {
+            listing->second.upsert(name, *attributes);
+        } else {
+            listing->second.erase(name);
+        }
+    }
+}
+
+void SnapshotIndex::enqueue(const std::span<const Message> messages) {
+    std::unique_lock lock{m_updatesMutex};
+    if (m_pendingUpdates.size() >= MAX_PENDING_UPDATES) {
+        m_appliedCv.wait(lock, [this] { return !m_running || m_pendingUpdates.size() < MAX_PENDING_UPDATES; });
+    }
+    if (!m_running) {
+        return;
+    }
+    const bool wasEmpty = m_pendingUpdates.empty();
+    for (const auto &message: messages) {
+        if (std::holds_alternative<FileChangedInd>(message)) {
+            m_pendingUpdates.push_back(message);
+        }
+    }
+    lock.unlock();
+    if (wasEmpty) {
+        m_updatesCv.notify_one();
+    }
+}
+
+void SnapshotIndex::sync() {
+    std::unique_lock lock{m_updatesMutex};
+    m_appliedCv.wait(lock, [this] { return !m_running || (m_pendingUpdates.empty() && !m_applying); });
+}
+
+void SnapshotIndex::updateLoop() {
+    std::vector<Message> updates;
+    std::unique_lock lock{m_updatesMutex};
+    while (true) {
+        m_updatesCv.wait(lock, [this] { return !m_running || !m_pendingUpdates.empty(); });
+        if (!m_running) {
+            return;
+        }
+        // Всё накопленное забирается разом: чем больше пачка, тем больше повторов об одном файле схлопнет apply
+        updates.swap(m_pendingUpdates);
+        m_applying = true;
+        lock.unlock();
+        m_appliedCv.notify_all();
+
+        apply(updates);
+        updates.clear();
+
+        lock.lock();
+        m_applying = false;
+        m_appliedCv.notify_all();
+    }
+}
+
+std::optional<std::vector<SnapshotIndex::Difference> > SnapshotIndex::rescan(const std::uint32_t directoryId,
+                                                                             DirectoryListing current) {
+    std::lock_guard lock{m_mutex};
+    const auto listing = m_listings.find(directoryId);
+    if (listing == m_listings.end()) {
+        return std::nullopt;
+    }
+
+    std::vector<Difference> differences;
+    const auto isDirectory = [](const DirectoryListing::Attributes &attributes) {
+        return attributes.type == DirectoryListing::Type::DIRECTORY;
+    };
+    listing->second.diff(
+        current,
+        [&](const std::string_view name, const DirectoryListing::Attributes &attributes) {
+            differences.push_back({std::string{name}, FileChangedInd::Action::CREATED, isDirectory(attributes)});
+        },
+        [&](const std::string_view name, const DirectoryListing::Attributes &attributes) {
+            differences.push_back({std::string{name}, FileChangedInd::Action::DELETED, isDirectory(attributes)});
+        },
+        [&](const std::string_view name, const DirectoryListing::Attributes &) {
+            differences.push_back({std::string{name}, FileChangedInd::Action::MODIFIED, false});
+        });
+    listing->second = std::move(current);
+    return differences;
+}
+
+bool SnapshotIndex::contains(const std::uint32_t directoryId) const {
+    std::shared_lock lock{m_mutex};
+    return m_listings.contains(directoryId);
+}
+
+std::vector<SnapshotIndex::FileInfo> SnapshotIndex::list(const std::uint32_t directoryId) const {
+    std::vector<FileInfo> result;
+    std::shared_lock lock{m_mutex};
+    const auto listing = m_listings.find(directoryId);
+    if (listing == m_listings.end()) {
+        return result;
+    }
+    result.reserve(listing->second.entries().size());
+    for (const auto &entry: listing->second.entries()) {
+        result.push_back({std::string{listing->second.name(entry)}, entry.attributes()});
+    }
+    return result;
+}
+
+std::optional<DirectoryListing::Attributes> SnapshotIndex::find(const std::uint32_t directoryId,
+                                                                const std::string_view name) const {
+    std::shared_lock lock{m_mutex};
+    const auto listing = m_listings.find(directoryId);
+    if (listing == m_listings.end()) {
+        return std::nullopt;
+    }
+    const auto *entry = listing->second.find(name);
+    if (!entry) {
+        return std::nullopt;
+    }
+    return entry->attributes();
+}
+
+SnapshotIndex::Stats SnapshotIndex::stats() const {
+    Stats stats;
+    std::shared_lock lock{m_mutex};
+    stats.directories = m_listings.size();
+    for (const auto &listing: m_listings | std::views::values) {
+        stats.entries += listing.entries().size();
+        stats.memoryUsage += listing.memoryUsage();
+    }
+    return stats;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectoryListing.h"
+#include "Observer/Message.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Снимок содержимого наблюдаемых директорий. Строится при подписке на директории и дальше
+/// поддерживается по событиям FileChangedInd, поэтому запросы не обращаются к диску.
+/// Используется и как эталон для сверки после переполнения очереди inotify. Включается в конфиге (watcher.snapshot).
+/// События применяет свой поток обновления: statx по каждому файлу не задерживает поток чтения inotify
+class SnapshotIndex : public OnceInstantiated<SnapshotIndex> {
+    friend class OnceInstantiated;
+
+public:
+    ~SnapshotIndex();
+
+    struct FileInfo {
+        std::string name;
+        DirectoryListing::Attributes attributes;
+    };
+
+    struct Difference {
+        std::string name;
+        FileChangedInd::Action action;
+        bool isDirectory;
+    };
+
+    struct Stats {
+        std::size_t directories = 0;
+        std::size_t entries = 0;
+        std::size_t memoryUsage = 0;
+    };
+
+    void replace(std::uint32_t directoryId, DirectoryListing listing);
+
+    void remove(std::uint32_t directoryId);
+
+    void clear();
+
+    /// Применяет пачку событий. Для каждого файла учитывается только последнее событие, атрибуты читаются один раз
+    void apply(std::span<const Message> messages);
+
+    /// Ставит события пачки в очередь потока обновления. Ждёт, только если очередь переполнена
+    void enqueue(std::span<const Message> messages);
+
+    /// Ждёт, пока поток обновления применит всё, что было в очереди
+    void sync();
+
+    /// Заменяет снимок директории свежим и возвращает различия. nullopt, если директории нет в индексе
+    std::optional<std::vector<Difference> > rescan(std::uint32_t directoryId, DirectoryListing current);
+
+    [[nodiscard]] bool contains(std::uint32_t directoryId) const;
+
+    [[nodiscard]] std::vector<FileInfo> list(std::uint32_t directoryId) const;
+
+    [[nodiscard]] std::optional<DirectoryListing::Attributes> find(std::uint32_t directoryId,
+                                                                   std::string_view name) const;
+
+    [[nodiscard]] Stats stats() const;
+
+protected:
+    SnapshotIndex();
+
+private:
+    void updateLoop();
+
+    /// Предел очереди обновлений в событиях: дальше поток чтения ждёт, а не наращивает память
+    static constexpr std::size_t MAX_PENDING_UPDATES = 1 << 18;
+
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::uint32_t, DirectoryListing> m_listings;
+
+    std::mutex m_updatesMutex;
+    std::condition_variable m_updatesCv;
+    std::condition_variable m_appliedCv;
+    std::vector<Message> m_pendingUpdates;
+    /// Поток обновления применяет забранную из очереди пачку
+    bool m_applying = false;
+    bool m_running = true;
+    std::thread m_updateThread;
+};
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+/// Протокол сервера подписок. Клиент шлёт текстовые команды, по одной в строке:
+///   format json|binary          - формат потока событий, по умолчанию json
+///   subscribe <действия> <путь> - получать события внутри директории <путь> (включая поддиректории).
+///                                 <действия> - all или имена через запятую: created,deleted,modified,renamed,
+///                                 moved_in,moved_out,close_write,attrib
+/// Подписок может быть несколько, событие уходит клиенту один раз. Неверная команда закрывает соединение.
+/// В формате json каждое событие - одна строка:
+///   {"action":"renamed","path":"/a/new","previous":"/a/old","count":1,"time_ns":...}
+/// Если клиент не успевал читать и события для него были отброшены, перед следующим приходит {"lost":N}
+namespace subscription {
+    /// action записи о потерянных событиях, их число - в count
+    inline constexpr std::uint8_t LOST_ACTION = 0xff;
+
+    /// Запись формата binary. За заголовком следует путь длиной pathLength, затем прежний путь длиной
+    /// previousPathLength (только для renamed). Числа - в порядке байт хоста
+    struct EventHeader {
+        /// Размер записи вместе с заголовком
+        std::uint32_t size;
+        /// Сколько исходных событий объединено в это
+        std::uint32_t count;
+        /// Время обработки события, нс с начала эпохи
+        std::int64_t timestampNs;
+        std::uint16_t pathLength;
+        std::uint16_t previousPathLength;
+        /// Значение FileChangedInd::Action или LOST_ACTION
+        std::uint8_t action;
+        std::uint8_t reserved[3];
+    };
+
+    static_assert(sizeof(EventHeader) == 24);
+}
@@ -0,0 +1,402 @@
+#include "SubscriptionServer.h"
+
+#include <array>
+#include <cstring>
+#include <format>
+#include <ranges>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Logger/SystemLogger.h"
+#include "Paths/DirectoryRegistry.h"
+
+namespace {
+    /// Индекс - значение FileChangedInd::Action
+    constexpr std::array<std::string_view, FileChangedInd::ACTIONS_COUNT> ACTION_NAMES = {
+        "created", "deleted", "modified", "renamed", "moved_in", "moved_out", "close_write", "attrib",
+    };
+
+    void appendJsonString(std::string &out, const std::string_view value) {
+        out += '"';
+        for (const char c: value) {
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        out += std::format("\\u{:04x}", static_cast<unsigned>(c));
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+    void appendBinary(std::string &out, const std::uint8_t action, const std::uint32_t count,
+                      const std::int64_t timestampNs, const std::string_view path,
+                      const std::string_view previousPath) {
+        subscription::EventHeader header{};
+        header.size = static_cast<std::uint32_t>(sizeof(header) + path.size() + previousPath.size());
+        header.count = count;
+        header.timestampNs = timestampNs;
+        header.pathLength = static_cast<std::uint16_t>(path.size());
+        header.previousPathLength = static_cast<std::uint16_t>(previousPath.size());
+        header.action = action;
+        out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        out += path;
+        out += previousPath;
+    }
+}
+
+SubscriptionServer::SubscriptionServer(std::filesystem::path socketPath, const std::size_t maxClientBuffer,
+                                       const SlowClientPolicy policy) : m_socketPath{std::move(socketPath)},
+                                                                        m_maxClientBuffer{maxClientBuffer},
+                                                                        m_policy{policy},
+                                                                        m_metrics{Metrics::instance()} {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (m_socketPath.native().size() >= sizeof(address.sun_path)) {
+        SystemLogger::instance().error(std::format("Subscription socket path {} is too long", m_socketPath.string()));
+        return;
+    }
+    std::strncpy(address.sun_path, m_socketPath.c_str(), sizeof(address.sun_path) - 1);
+    unlink(m_socketPath.c_str());
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 ||
+        listen(m_listenFd, 64) < 0 || !m_reactor.add(m_listenFd, [this] { accept(); })) {
+        SystemLogger::instance().error(std::format("Cannot listen on subscription socket {}: {}",
+                                                   m_socketPath.string(), std::strerror(errno)));
+        if (m_listenFd >= 0) {
+            close(m_listenFd);
+            m_listenFd = -1;
+        }
+        return;
+    }
+
+    m_thread = std::thread{&Reactor::run, &m_reactor};
+    SystemLogger::instance().info(std::format("Serving event subscriptions on {}", m_socketPath.string()));
+}
+
+SubscriptionServer::~SubscriptionServer() {
+    if (m_thread.joinable()) {
+        m_reactor.stop();
+        m_thread.join();
+    }
+    for (const int fd: m_clients | std::views::keys) {
+        close(fd);
+    }
+    m_metrics.subscribers.set(0);
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+    }
+}
+
+void SubscriptionServer::publish(const FileChangedInd &event, const std::int64_t timestampNs) {
+    std::vector<int> disconnected;
+    {
+        std::lock_guard lock{m_mutex};
+        if (!m_wantedActions.test(static_cast<std::size_t>(event.action))) {
+            return;
+        }
+
+        const auto &registry = DirectoryRegistry::instance();
+        Encoded encoded{event, timestampNs, (registry.path(event.directoryId) / event.fileName()).string()};
+        if (event.action == FileChangedInd::Action::RENAMED) {
+            encoded.previousPath = (registry.path(event.previousDirectoryId) / event.previousName()).string();
+        }
+
+        for (auto &[fd, client]: m_clients) {
+            // Переименование видно подписчикам и старого, и нового расположения
+            if (!matches(client, event.action, encoded.path) &&
+                (encoded.previousPath.empty() || !matches(client, event.action, encoded.previousPath))) {
+                continue;
+            }
+            if (!enqueue(client, encode(encoded, client.format))) {
+                SystemLogger::instance().warn(std::format("Subscriber {} is too slow, disconnecting", fd));
+                disconnected.push_back(fd);
+            }
+        }
+    }
+    closeClients(disconnected);
+}
+
+void SubscriptionServer::flush() {
+    std::vector<int> disconnected;
+    {
+        std::lock_guard lock{m_mutex};
+        for (auto &[fd, client]: m_clients) {
+            // Если сокет был полон, остаток отправит поток Reactor, когда тот освободится
+            if (client.sent < client.output.size() && !client.waitingWrite && !send(fd, client)) {
+                disconnected.push_back(fd);
+            }
+        }
+    }
+    closeClients(disconnected);
+}
+
+bool SubscriptionServer::matches(const Client &client, const FileChangedInd::Action action,
+                                 const std::string_view path) {
+    return std::ranges::any_of(client.subscriptions, [&](const Subscription &subscription) {
+        if (!subscription.actions.test(static_cast<std::size_t>(action)) || !path.starts_with(subscription.prefix)) {
+            return false;
+        }
+        // Префикс совпадает только по границе компонента пути: /srv/a не включает /srv/ab
+        return path.size() == subscription.prefix.size() || subscription.prefix.ends_with('/') ||
+               path[subscription.prefix.size()] == '/';
+    });
+}
+
+const std::string &SubscriptionServer::encode(Encoded &encoded, const Format format) {
+    const auto &event = encoded.event;
+    if (format == Format::BINARY) {
+        if (!encoded.binary) {
+            encoded.binary.emplace();
+            appendBinary(*encoded.binary, static_cast<std::uint8_t>(event.action), event.count, encoded.timestampNs,
+                         encoded.path, encoded.previousPath);
+        }
+        return *encoded.binary;
+    }
+
+    if (!encoded.json) {
+        auto &json = encoded.json.emplace();
+        json += R"({"action":")";
+        json += ACTION_NAMES[static_cast<std::size_t>(event.action)];
+        json += R"(","path":)";
+        appendJsonString(json, encoded.path);
+        if (!encoded.previousPath.empty()) {
+            json += R"(,"previous":)";
+            appendJsonString(json, encoded.previousPath);
+        }
+        json += std::format(R"(,"count":{},"time_ns":{}}})", event.count, encoded.timestampNs);
+        json += '\n';
+    }
+    return *encoded.json;
+}
+
+std::string SubscriptionServer::encodeLost(const Format format, const std::uint64_t lost) {
+    if (format == Format::JSON) {
+        return std::format("{{\"lost\":{}}}\n", lost);
+    }
+    std::string record;
+    const auto count = static_cast<std::uint32_t>(std::min<std::uint64_t>(lost, UINT32_MAX));
+    appendBinary(record, subscription::LOST_ACTION, count, 0, {}, {});
+    return record;
+}
+
+void SubscriptionServer::accept() {
+    while (true) {
+        const int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        {
+            std::lock_guard lock{m_mutex};
+            m_clients.try_emplace(fd);
+            m_metrics.subscribers.set(static_cast<std::int64_t>(m_clients.size()));
+        }
+        if (!m_reactor.add(fd, [this, fd] { onClientReady(fd); })) {
+            closeClients({fd});
+        }
+    }
+}
+
+void SubscriptionServer::onClientReady(const int fd) {
+    bool connected;
+    {
+        std::lock_guard lock{m_mutex};
+        const auto it = m_clients.find(fd);
+        if (it == m_clients.end()) {
+            return;
+        }
+        auto &client = it->second;
+        connected = readCommands(fd, client) && (client.sent == client.output.size() || send(fd, client));
+    }
+    if (!connected) {
+        closeClients({fd});
+    }
+}
+
+bool SubscriptionServer::readCommands(const int fd, Client &client) {
+    char buffer[4096];
+    while (true) {
+        const ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+        if (length < 0) {
+            return errno == EAGAIN || errno == EINTR;
+        }
+        if (length == 0) {
+            return false;
+        }
+
+        client.input.append(buffer, static_cast<std::size_t>(length));
+        std::size_t start = 0;
+        for (std::size_t end; (end = client.input.find('\n', start)) != std::string::npos; start = end + 1) {
+            std::string_view command{client.input.data() + start, end - start};
+            if (command.ends_with('\r')) {
+                command.remove_suffix(1);
+            }
+            if (!command.empty() && !handleCommand(client, command)) {
+                SystemLogger::instance().warn(std::format("Subscriber {} sent invalid command \"{}\", disconnecting",
+                                                          fd, command));
+                return false;
+            }
+        }
+        client.input.erase(0, start);
+        if (client.input.size() > MAX_COMMAND_LENGTH) {
+            SystemLogger::instance().warn(std::format("Subscriber {} sent too long command, disconnecting", fd));
+            return false;
+        }
+    }
+}
+
+bool SubscriptionServer::handleCommand(Client &client, const std::string_view command) {
+    const auto space = command.find(' ');
+    const auto verb = command.substr(0, space);
+    const auto arguments = space == std::string_view::npos ? std::string_view{} : command.substr(space + 1);
+
+    if (verb == "format") {
+        if (arguments == "json") {
+            client.format = Format::JSON;
+        } else if (arguments == "binary") {
+            client.format = Format::BINARY;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    if (verb != "subscribe") {
+        return false;
+    }
+    const auto pathStart = arguments.find(' ');
+    if (pathStart == std::string_view::npos) {
+        return false;
+    }
+    Subscription subscription;
+    if (const auto actions = arguments.substr(0, pathStart); actions == "all") {
+        subscription.actions.set();
+    } else {
+        for (const auto name: actions | std::views::split(',')) {
+            const auto action = std::ranges::find(ACTION_NAMES, std::string_view{name.begin(), name.end()});
+            if (action == ACTION_NAMES.end()) {
+                return false;
+            }
+            subscription.actions.set(static_cast<std::size_t>(action - ACTION_NAMES.begin()));
+        }
+    }
+    const std::filesystem::path prefix{arguments.substr(pathStart + 1)};
+    if (!prefix.is_absolute()) {
+        return false;
+    }
+    subscription.prefix = prefix.lexically_normal().string();
+    // Из "/srv/" делаем "/srv", корень остаётся "/"
+    if (subscription.prefix.size() > 1 && subscription.prefix.ends_with('/')) {
+        subscription.prefix.pop_back();
+    }
+
+    m_wantedActions |= subscription.actions;
+    client.subscriptions.push_back(std::move(subscription));
+    return true;
+}
+
+bool SubscriptionServer::enqueue(Client &client, const std::string &record) {
+    const auto pending = client.output.size() - client.sent;
+    if (client.lost) {
+        // Сначала сообщаем о потерях, и только если за ними поместится и само событие
+        const auto lost = encodeLost(client.format, client.lost);
+        if (pending + lost.size() + record.size() > m_maxClientBuffer) {
+            ++client.lost;
+            m_metrics.subscriberEventsLost.add();
+            return true;
+        }
+        client.output += lost;
+        client.lost = 0;
+    } else if (pending + record.size() > m_maxClientBuffer) {
+        if (m_policy == SlowClientPolicy::DISCONNECT) {
+            return false;
+        }
+        ++client.lost;
+        m_metrics.subscriberEventsLost.add();
+        return true;
+    }
+
+    // Отправленное начало выбрасывается, когда его больше половины: не сдвигать данные на каждом событии
+    if (client.sent > client.output.size() / 2) {
+        client.output.erase(0, client.sent);
+        client.sent = 0;
+    }
+    client.output += record;
+    return true;
+}
+
+bool SubscriptionServer::send(const int fd, Client &client) {
+    while (true) {
+        while (client.sent < client.output.size()) {
+            const ssize_t written = ::send(fd, client.output.data() + client.sent,
+                                           client.output.size() - client.sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN) {
+                    return false;
+                }
+                if (!client.waitingWrite) {
+                    client.waitingWrite = m_reactor.modify(fd, EPOLLIN | EPOLLOUT);
+                }
+                return true;
+            }
+            client.sent += static_cast<std::size_t>(written);
+        }
+
+        client.output.clear();
+        client.sent = 0;
+        if (!client.lost) {
+            break;
+        }
+        // Буфер опустел: о потерях сообщаем сразу, не дожидаясь следующего события
+        client.output = encodeLost(client.format, client.lost);
+        client.lost = 0;
+    }
+
+    if (client.waitingWrite) {
+        client.waitingWrite = !m_reactor.modify(fd, EPOLLIN);
+    }
+    return true;
+}
+
+void SubscriptionServer::closeClients(const std::vector<int> &fds) {
+    if (fds.empty()) {
+        return;
+    }
+    std::vector<int> erased;
+    {
+        std::lock_guard lock{m_mutex};
+        for (const int fd: fds) {
+            if (m_clients.erase(fd)) {
+                erased.push_back(fd);
+            }
+        }
+        m_wantedActions.reset();
+        for (const auto &client: m_clients | std::views::values) {
+            for (const auto &subscription: client.subscriptions) {
+                m_wantedActions |= subscription.actions;
+            }
+        }
+        m_metrics.subscribers.set(static_cast<std::int64_t>(m_clients.size()));
+    }
+    // Обработчики Reactor берут только m_mutex, поэтому ожидание в remove не может зациклиться
+    for (const int fd: erased) {
+        m_reactor.remove(fd);
+        close(fd);
+    }
+}
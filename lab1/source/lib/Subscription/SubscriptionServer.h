@@ -0,0 +1,123 @@
+#pragma once
+#include <bitset>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "SubscriptionFormat.h"
+#include "Metrics/Metrics.h"
+#include "Observer/Messages.h"
+#include "Reactor/Reactor.h"
+
+/// Что делать с подписчиком, чей буфер заполнен
+enum class SlowClientPolicy {
+    /// Закрыть соединение
+    DISCONNECT,
+    /// Отбрасывать события, пока буфер не освободится, и затем сообщить, сколько потеряно
+    DROP,
+};
+
+/// Раздаёт события подписчикам через Unix-сокет (протокол - в SubscriptionFormat.h). Событие кодируется один раз
+/// на формат и копируется в буферы всех подходящих подписчиков. Подключения обслуживаются собственным Reactor
+/// на своём потоке, события ставятся в буферы из потока DiskMonitor
+class SubscriptionServer {
+public:
+    SubscriptionServer(std::filesystem::path socketPath, std::size_t maxClientBuffer, SlowClientPolicy policy);
+
+    ~SubscriptionServer();
+
+    SubscriptionServer(const SubscriptionServer &) = delete;
+
+    SubscriptionServer &operator=(const SubscriptionServer &) = delete;
+
+    [[nodiscard]] bool isOpen() const { return m_listenFd >= 0; }
+
+    /// Ставит событие в буферы подписчиков. timestampNs - время с начала эпохи
+    void publish(const FileChangedInd &event, std::int64_t timestampNs);
+
+    /// Отправляет накопленное в буферах. Вызывать после пачки publish
+    void flush();
+
+private:
+    enum class Format {
+        JSON,
+        BINARY,
+    };
+
+    struct Subscription {
+        std::string prefix;
+        std::bitset<FileChangedInd::ACTIONS_COUNT> actions;
+    };
+
+    struct Client {
+        Format format = Format::JSON;
+        std::vector<Subscription> subscriptions;
+        /// Начало ещё не законченной команды
+        std::string input;
+        /// Неотправленные данные начинаются с output[sent]
+        std::string output;
+        std::size_t sent = 0;
+        /// События, отброшенные при полном буфере и ещё не объявленные клиенту
+        std::uint64_t lost = 0;
+        /// Ждём готовности сокета к записи
+        bool waitingWrite = false;
+    };
+
+    /// Событие, закодированное в каждом из форматов по первому требованию
+    struct Encoded {
+        const FileChangedInd &event;
+        std::int64_t timestampNs;
+        std::string path;
+        std::string previousPath;
+        std::optional<std::string> json;
+        std::optional<std::string> binary;
+    };
+
+    /// Длиннее команды не бывают: путь ограничен PATH_MAX
+    static constexpr std::size_t MAX_COMMAND_LENGTH = 8192;
+
+    static bool matches(const Client &client, FileChangedInd::Action action, std::string_view path);
+
+    static const std::string &encode(Encoded &encoded, Format format);
+
+    static std::string encodeLost(Format format, std::uint64_t lost);
+
+    void accept();
+
+    void onClientReady(int fd);
+
+    /// Разбирает пришедшие команды. false - клиент отключился или прислал неверную команду
+    bool readCommands(int fd, Client &client);
+
+    bool handleCommand(Client &client, std::string_view command);
+
+    /// Кладёт запись в буфер клиента. false - буфер полон и клиента нужно отключить
+    bool enqueue(Client &client, const std::string &record);
+
+    /// Отправляет сколько примет сокет и ждёт готовности к записи, если осталось. false - соединение разорвано
+    bool send(int fd, Client &client);
+
+    /// Снимает отключённых клиентов с Reactor и закрывает их сокеты. Вызывать без m_mutex.
+    /// Клиента закрывает тот поток, который удалил его из m_clients, даже если решили оба
+    void closeClients(const std::vector<int> &fds);
+
+    std::filesystem::path m_socketPath;
+    const std::size_t m_maxClientBuffer;
+    const SlowClientPolicy m_policy;
+    Metrics &m_metrics;
+    int m_listenFd = -1;
+    Reactor m_reactor;
+
+    /// Защищает m_clients: publish и flush идут из потока DiskMonitor, остальное - из потока Reactor
+    std::mutex m_mutex;
+    std::unordered_map<int, Client> m_clients;
+    /// Объединение подписок всех клиентов: события, которые никому не нужны, не кодируются
+    std::bitset<FileChangedInd::ACTIONS_COUNT> m_wantedActions;
+
+    std::thread m_thread;
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Пул для обхода деревьев: задача может порождать новые задачи. Каждый поток берёт задачи с конца
+/// своей очереди (последние порождённые, их данные ещё в кэше), а опустевший поток крадёт с начала
+/// чужой - самые крупные поддеревья. run возвращает управление, когда выполнены все задачи
+template<typename Task>
+class WorkStealingPool {
+public:
+    class Context {
+    public:
+        void push(Task task) {
+            m_pool.push(m_worker, std::move(task));
+        }
+
+    private:
+        friend class WorkStealingPool;
+
+        Context(WorkStealingPool &pool, const std::size_t worker) : m_pool{pool}, m_worker{worker} {
+        }
+
+        WorkStealingPool &m_pool;
+        std::size_t m_worker;
+    };
+
+    template<typename Handler>
+    static void run(std::vector<Task> tasks, std::size_t threadsCount, Handler handler) {
+        threadsCount = std::max<std::size_t>(threadsCount, 1);
+        WorkStealingPool pool{threadsCount};
+        for (std::size_t i = 0; i < tasks.size(); ++i) {
+            pool.push(i % threadsCount, std::move(tasks[i]));
+        }
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadsCount);
+        for (std::size_t worker = 0; worker < threadsCount; ++worker) {
+            threads.emplace_back([&pool, &handler, worker] { pool.work(worker, handler); });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    explicit WorkStealingPool(const std::size_t threadsCount) : m_workers(threadsCount) {
+    }
+
+    void push(const std::size_t worker, Task task) {
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        std::lock_guard lock{m_workers[worker].mutex};
+        m_workers[worker].tasks.push_back(std::move(task));
+    }
+
+    bool take(const std::size_t worker, Task &task) {
+        {
+            auto &own = m_workers[worker];
+            std::lock_guard lock{own.mutex};
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < m_workers.size(); ++i) {
+            auto &victim = m_workers[(worker + i) % m_workers.size()];
+            std::lock_guard lock{victim.mutex};
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename Handler>
+    void work(const std::size_t worker, Handler &handler) {
+        Context context{*this, worker};
+        unsigned idleRounds = 0;
+        while (m_pending.load(std::memory_order_acquire) > 0) {
+            Task task;
+            if (!take(worker, task)) {
+                // Задачи ещё выполняются у других потоков и могут породить новые
+                if (++idleRounds < 64) {
+                    std::this_thread::yield();
+                } else {
+                    std::this_thread::sleep_for(std::chrono::microseconds{100});
+                }
+                continue;
+            }
+            idleRounds = 0;
+            handler(task, context);
+            m_pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+
+    std::vector<Worker> m_workers;
+    /// Добавленные, но ещё не выполненные задачи
+    std::atomic<std::size_t> m_pending{0};
+};
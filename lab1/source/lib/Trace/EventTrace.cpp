@@ -0,0 +1,109 @@
+#include "EventTrace.h"
+
+#include <cstring>
+#include <format>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "Logger/SystemLogger.h"
+
+using namespace trace_file;
+
+namespace {
+    std::uint32_t threadId() {
+        thread_local const auto id = static_cast<std::uint32_t>(gettid());
+        return id;
+    }
+}
+
+EventTrace::Ring::Ring(const std::filesystem::path &path, const std::uint64_t size, const std::uint64_t sampleEvery) {
+    const std::uint64_t capacity = std::max<std::uint64_t>(size / sizeof(Record), 1024);
+    // Как и кольцо событий, файл создаётся рядом и переименовывается: прежний файл может быть ещё отображён
+    const auto temporary = std::filesystem::path{path}.concat(".tmp");
+    const int fd = open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        SystemLogger::instance().error(std::format("Cannot create trace file {}: {}", temporary.string(),
+                                                   std::strerror(errno)));
+        return;
+    }
+    m_size = HEADER_SIZE + capacity * sizeof(Record);
+    void *address = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(m_size)) == 0) {
+        address = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (address == MAP_FAILED) {
+        SystemLogger::instance().error(std::format("Cannot map trace file {}: {}", temporary.string(),
+                                                   std::strerror(errno)));
+        unlink(temporary.c_str());
+        return;
+    }
+
+    m_header = static_cast<Header *>(address);
+    m_records = reinterpret_cast<Record *>(static_cast<char *>(address) + HEADER_SIZE);
+    m_header->version = VERSION;
+    m_header->headerSize = HEADER_SIZE;
+    m_header->capacity = capacity;
+    m_header->sampleEvery = sampleEvery;
+    std::memcpy(m_header->magic, MAGIC, sizeof(MAGIC));
+    if (rename(temporary.c_str(), path.c_str()) < 0) {
+        SystemLogger::instance().error(std::format("Cannot publish trace file {}: {}", path.string(),
+                                                   std::strerror(errno)));
+        munmap(address, m_size);
+        m_header = nullptr;
+        unlink(temporary.c_str());
+    }
+}
+
+EventTrace::Ring::~Ring() {
+    // Файл остаётся на диске для разбора после остановки
+    if (m_header) {
+        munmap(m_header, m_size);
+    }
+}
+
+void EventTrace::Ring::append(const std::uint64_t traceId, const Stage stage, const std::int64_t timestampNs,
+                              const std::uint32_t thread) {
+    const std::uint64_t slot = m_header->next.fetch_add(1, std::memory_order_relaxed);
+    auto &record = m_records[slot % m_header->capacity];
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.traceId = traceId;
+    record.timestampNs = timestampNs;
+    record.stage = static_cast<std::uint32_t>(stage);
+    record.thread = thread;
+    record.sequence.store(slot + 1, std::memory_order_release);
+}
+
+EventTrace::~EventTrace() {
+    m_sampleEvery.store(0, std::memory_order_relaxed);
+    m_ring.store(nullptr);
+}
+
+void EventTrace::configure(const TraceConfig &config) {
+    if (m_config == config) {
+        return;
+    }
+    m_config = config;
+    m_sampleEvery.store(0, std::memory_order_relaxed);
+    m_ring.store(nullptr);
+    if (m_config.file.empty()) {
+        return;
+    }
+
+    auto ring = std::make_shared<Ring>(m_config.file, m_config.size, m_config.sampleEvery);
+    if (!ring->isOpen()) {
+        return;
+    }
+    m_ring.store(std::move(ring));
+    m_sampleEvery.store(m_config.sampleEvery, std::memory_order_relaxed);
+    SystemLogger::instance().info(std::format("Tracing every {} event to {}", m_config.sampleEvery,
+                                              m_config.file.string()));
+}
+
+void EventTrace::record(const std::uint64_t traceId, const Stage stage, const std::int64_t timestampNs) {
+    if (const auto ring = m_ring.load()) {
+        ring->append(traceId, stage, timestampNs, threadId());
+    }
+}
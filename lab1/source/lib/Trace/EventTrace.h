@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+#include "TraceFormat.h"
+#include "Config/Config.h"
+#include "OnceInstantiated/OnceInstantiated.h"
+
+/// Сквозные идентификаторы событий и выборочная трассировка их пути. Каждое событие получает в шарде
+/// монотонный traceId (FileChangedInd::traceId). Для каждого sampleEvery-го события этапы пути с временными
+/// метками пишутся в кольцевой файл (формат - TraceFormat.h), который разбирает disk_monitor_trace.
+/// Пока трассировка выключена, стоимость - одна атомарная операция на пачку событий
+class EventTrace : public OnceInstantiated<EventTrace> {
+    friend class OnceInstantiated;
+
+public:
+    using Stage = trace_file::Stage;
+
+    ~EventTrace();
+
+    /// Открывает новый файл, если файл или размер изменились. Пустой file выключает трассировку
+    void configure(const TraceConfig &config);
+
+    /// Выделяет count идущих подряд идентификаторов и возвращает первый. Идентификаторы начинаются с 1
+    std::uint64_t assignIds(const std::size_t count) {
+        return m_nextId.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] bool enabled() const { return m_sampleEvery.load(std::memory_order_relaxed) != 0; }
+
+    /// Событие попадает в выборку трассировки
+    [[nodiscard]] bool sampled(const std::uint64_t traceId) const {
+        const auto every = m_sampleEvery.load(std::memory_order_relaxed);
+        return every && traceId && traceId % every == 0;
+    }
+
+    /// Пишет этап события. Вызывать только для sampled событий
+    void record(std::uint64_t traceId, Stage stage, std::int64_t timestampNs);
+
+protected:
+    EventTrace() = default;
+
+private:
+    /// Отображённый файл. Писатели держат shared_ptr, пока пишут, поэтому файл можно заменить на ходу
+    class Ring {
+    public:
+        Ring(const std::filesystem::path &path, std::uint64_t size, std::uint64_t sampleEvery);
+
+        ~Ring();
+
+        Ring(const Ring &) = delete;
+
+        Ring &operator=(const Ring &) = delete;
+
+        [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+
+        void append(std::uint64_t traceId, Stage stage, std::int64_t timestampNs, std::uint32_t thread);
+
+    private:
+        std::size_t m_size = 0;
+        trace_file::Header *m_header = nullptr;
+        trace_file::Record *m_records = nullptr;
+    };
+
+    std::atomic<std::uint64_t> m_nextId{1};
+    /// 0 - трассировка выключена
+    std::atomic<std::uint64_t> m_sampleEvery{0};
+    std::atomic<std::shared_ptr<Ring> > m_ring;
+    TraceConfig m_config;
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+/// Статические точки трассировки в формате SystemTap SDT (USDT), без sys/sdt.h и внешних библиотек.
+/// Точка - одна инструкция nop и запись в секции .note.stapsdt с её адресом и расположением аргументов.
+/// bpftrace, perf probe и stap находят точки провайдера disk_monitor в бинарнике и подставляют на место nop
+/// переход в свой обработчик, пока трассировка не подключена, точка ничего не стоит:
+///
+///     bpftrace -e 'usdt:./disk_monitor:disk_monitor:queue_pop { @batch = hist(arg1); }'
+///
+/// Аргументы передаются как 64-битные целые без знака, указатели - своим адресом
+#if defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+
+#define DISK_MONITOR_PROBE_NOTE(name, arguments) \
+    "990: nop\n" \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+    ".balign 4\n" \
+    ".4byte 992f-991f, 994f-993f, 3\n" \
+    "991: .asciz \"stapsdt\"\n" \
+    "992: .balign 4\n" \
+    "993: .8byte 990b\n" \
+    ".8byte _.stapsdt.base\n" \
+    ".8byte 0\n" \
+    ".asciz \"disk_monitor\"\n" \
+    ".asciz \"" #name "\"\n" \
+    ".asciz \"" arguments "\"\n" \
+    "994: .balign 4\n" \
+    ".popsection\n" \
+    ".ifndef _.stapsdt.base\n" \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+    ".weak _.stapsdt.base\n" \
+    ".hidden _.stapsdt.base\n" \
+    "_.stapsdt.base: .space 1\n" \
+    ".size _.stapsdt.base, 1\n" \
+    ".popsection\n" \
+    ".endif\n"
+
+namespace probes {
+    template<typename T>
+    constexpr std::uint64_t argument(const T value) {
+        if constexpr (std::is_pointer_v<T>) {
+            return reinterpret_cast<std::uintptr_t>(value);
+        } else {
+            return static_cast<std::uint64_t>(value);
+        }
+    }
+}
+
+#define DISK_MONITOR_PROBE_ARGUMENT(value) "nor"(probes::argument(value))
+
+#define DISK_MONITOR_PROBE1(name, a) \
+    __asm__ __volatile__(DISK_MONITOR_PROBE_NOTE(name, "8@%0") :: DISK_MONITOR_PROBE_ARGUMENT(a))
+
+#define DISK_MONITOR_PROBE2(name, a, b) \
+    __asm__ __volatile__(DISK_MONITOR_PROBE_NOTE(name, "8@%0 8@%1") \
+        :: DISK_MONITOR_PROBE_ARGUMENT(a), DISK_MONITOR_PROBE_ARGUMENT(b))
+
+#define DISK_MONITOR_PROBE3(name, a, b, c) \
+    __asm__ __volatile__(DISK_MONITOR_PROBE_NOTE(name, "8@%0 8@%1 8@%2") \
+        :: DISK_MONITOR_PROBE_ARGUMENT(a), DISK_MONITOR_PROBE_ARGUMENT(b), DISK_MONITOR_PROBE_ARGUMENT(c))
+
+#else
+
+#define DISK_MONITOR_PROBE1(name, a) static_cast<void>(a)
+#define DISK_MONITOR_PROBE2(name, a, b) (static_cast<void>(a), static_cast<void>(b))
+#define DISK_MONITOR_PROBE3(name, a, b, c) (static_cast<void>(a), static_cast<void>(b), static_cast<void>(c))
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+/// Формат файла трассировки. Файл - заголовок размером HEADER_SIZE, затем capacity записей Record по кругу.
+/// Писателей несколько (потоки шардов и DiskMonitor): запись занимает слот next.fetch_add(1) % capacity,
+/// обнуляет в нём sequence, заполняет поля и публикует sequence = номер слота + 1. Читатель берёт запись,
+/// если sequence ненулевой и не изменился за время копирования.
+///
+/// Каждая выбранная запись - одна точка пути события: traceId, этап и монотонное время в нс. Полная история
+/// события - все записи с его traceId, упорядоченные по этапам. Все числа - в порядке байт хоста
+namespace trace_file {
+    inline constexpr char MAGIC[8] = {'D', 'M', 'T', 'R', 'A', 'C', 'E', '1'};
+    inline constexpr std::uint32_t VERSION = 1;
+    inline constexpr std::uint64_t HEADER_SIZE = 4096;
+
+    enum class Stage : std::uint32_t {
+        /// Событие прочитано из inotify
+        READ,
+        /// Шард отдаёт пачку наблюдателям
+        PUBLISH,
+        /// Событие положено в очередь DiskMonitor
+        ENQUEUE,
+        /// Пачка с событием извлечена из очереди
+        DEQUEUE,
+        /// Начало обработки: журнал, подписчики, кольцо событий
+        HANDLE,
+        /// Строка лога записана. Нет, если событие не попало в лог
+        LOG,
+        /// Обработка закончена
+        DONE,
+    };
+
+    inline constexpr std::size_t STAGES_COUNT = 7;
+
+    inline constexpr std::array<std::string_view, STAGES_COUNT> STAGE_NAMES = {
+        "read", "publish", "enqueue", "dequeue", "handle", "log", "done",
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        /// Число записей в кольце
+        std::uint64_t capacity;
+        /// Трассируется каждое sampleEvery-е событие
+        std::uint64_t sampleEvery;
+        /// Номер следующего слота, монотонно растёт
+        alignas(64) std::atomic<std::uint64_t> next;
+    };
+
+    struct Record {
+        /// Номер слота + 1, 0 - запись пишется или слот пуст
+        std::atomic<std::uint64_t> sequence;
+        std::uint64_t traceId;
+        /// CLOCK_MONOTONIC, нс
+        std::int64_t timestampNs;
+        /// Значение Stage
+        std::uint32_t stage;
+        /// Идентификатор потока (gettid)
+        std::uint32_t thread;
+    };
+
+    static_assert(sizeof(Header) <= HEADER_SIZE);
+    static_assert(sizeof(Record) == 32);
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Trace records are shared between processes");
+}
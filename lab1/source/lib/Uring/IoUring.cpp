@@ -0,0 +1,198 @@
+#include "IoUring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace {
+    int setup(const unsigned entries, io_uring_params &params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    }
+
+    int enter(const int fd, const unsigned toSubmit, const unsigned minComplete, const unsigned flags,
+              const void *arg, const std::size_t argSize) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+    }
+
+    int registerRing(const int fd, const unsigned opcode, const void *arg, const unsigned count) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+    }
+
+    void *mapRing(const int fd, const std::size_t size, const std::uint64_t offset) {
+        void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                             static_cast<off_t>(offset));
+        return address == MAP_FAILED ? nullptr : address;
+    }
+}
+
+std::unique_ptr<IoUring> IoUring::create(const unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CLAMP;
+    const int fd = setup(entries, params);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<IoUring> ring{new IoUring};
+    ring->m_fd = fd;
+    // Ожидание с таймаутом без отдельного SQE требует IORING_ENTER_EXT_ARG (ядро 5.11)
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !ring->map(params)) {
+        return nullptr;
+    }
+
+    constexpr unsigned PROBE_OPS = 256;
+    std::vector<char> probeStorage(sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op));
+    auto *probe = reinterpret_cast<io_uring_probe *>(probeStorage.data());
+    if (registerRing(fd, IORING_REGISTER_PROBE, probe, PROBE_OPS) == 0) {
+        for (unsigned op = 0; op < probe->ops_len && op < PROBE_OPS; ++op) {
+            ring->m_supported.set(op, probe->ops[op].flags & IO_URING_OP_SUPPORTED);
+        }
+    }
+    return ring;
+}
+
+bool IoUring::map(const io_uring_params &params) {
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+
+    m_sqRing = mapRing(m_fd, m_sqRingSize, IORING_OFF_SQ_RING);
+    if (!m_sqRing) {
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_cqRing = m_sqRing;
+    } else if (m_cqRing = mapRing(m_fd, m_cqRingSize, IORING_OFF_CQ_RING); !m_cqRing) {
+        return false;
+    }
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe *>(mapRing(m_fd, m_sqesSize, IORING_OFF_SQES));
+    if (!m_sqes) {
+        return false;
+    }
+
+    auto *sq = static_cast<char *>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqePending = *m_sqTail;
+
+    auto *cq = static_cast<char *>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    return true;
+}
+
+IoUring::~IoUring() {
+    if (m_bufferRing) {
+        munmap(m_bufferRing, m_bufferRingSize);
+        munmap(m_buffers, std::size_t{m_bufferCount} * m_bufferSize);
+    }
+    if (m_sqes) {
+        munmap(m_sqes, m_sqesSize);
+    }
+    if (m_cqRing && m_cqRing != m_sqRing) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    if (m_sqRing) {
+        munmap(m_sqRing, m_sqRingSize);
+    }
+    if (m_fd >= 0) {
+        // Закрытие кольца отменяет всё, что ещё выполняется, в том числе многократное чтение
+        close(m_fd);
+    }
+}
+
+io_uring_sqe *IoUring::nextSqe() {
+    const unsigned head = std::atomic_ref{*m_sqHead}.load(std::memory_order_acquire);
+    if (m_sqePending - head >= m_sqEntries) {
+        return nullptr;
+    }
+    const unsigned index = m_sqePending & m_sqMask;
+    ++m_sqePending;
+    m_sqArray[index] = index;
+    auto *sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit(const unsigned waitFor, const std::optional<std::chrono::milliseconds> timeout) {
+    const unsigned toSubmit = m_sqePending - *m_sqTail;
+    std::atomic_ref{*m_sqTail}.store(m_sqePending, std::memory_order_release);
+
+    unsigned flags = waitFor ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    const void *argPtr = nullptr;
+    std::size_t argSize = 0;
+    if (timeout) {
+        ts.tv_sec = timeout->count() / 1000;
+        ts.tv_nsec = timeout->count() % 1000 * 1000000;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<std::uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argPtr = &arg;
+        argSize = sizeof(arg);
+    }
+
+    // Ядро сначала принимает SQE и только потом ждёт, поэтому прерванное ожидание не теряет отправленное
+    if (enter(m_fd, toSubmit, waitFor, flags, argPtr, argSize) < 0 && errno != ETIME && errno != EINTR) {
+        return -errno;
+    }
+    return 0;
+}
+
+bool IoUring::registerBufferRing(const std::uint16_t group, const std::uint16_t count, const std::uint32_t size) {
+    m_bufferRingSize = std::size_t{count} * sizeof(io_uring_buf);
+    void *ring = mmap(nullptr, m_bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+    void *buffers = mmap(nullptr, std::size_t{count} * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1, 0);
+    if (buffers == MAP_FAILED) {
+        munmap(ring, m_bufferRingSize);
+        return false;
+    }
+
+    io_uring_buf_reg registration{};
+    registration.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+    registration.ring_entries = count;
+    registration.bgid = group;
+    if (registerRing(m_fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0) {
+        munmap(ring, m_bufferRingSize);
+        munmap(buffers, std::size_t{count} * size);
+        return false;
+    }
+
+    m_bufferRing = static_cast<io_uring_buf_ring *>(ring);
+    m_buffers = static_cast<char *>(buffers);
+    m_bufferSize = size;
+    m_bufferCount = count;
+    for (std::uint16_t id = 0; id < count; ++id) {
+        recycleBuffer(id);
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(const std::uint16_t id) {
+    // bufs объявлен через __DECLARE_FLEX_ARRAY, и в C++ пустая структура перед ним сдвигает его на 8 байт.
+    // Ядро же видит массив с начала кольца, хвост наложен на resv первого элемента
+    auto &slot = reinterpret_cast<io_uring_buf *>(m_bufferRing)[m_bufferTail & (m_bufferCount - 1)];
+    slot.addr = reinterpret_cast<std::uint64_t>(buffer(id));
+    slot.len = m_bufferSize;
+    slot.bid = id;
+    ++m_bufferTail;
+    std::atomic_ref{m_bufferRing->tail}.store(m_bufferTail, std::memory_order_release);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <linux/io_uring.h>
+
+/// Минимальное кольцо io_uring на системных вызовах, без liburing. Используется одним потоком
+class IoUring {
+public:
+    /// IORING_OP_READ_MULTISHOT появился в ядре 6.7, заголовки старых ядер его не объявляют
+    static constexpr std::uint8_t OP_READ_MULTISHOT = 49;
+
+    /// nullptr, если io_uring недоступен: старое ядро, seccomp или kernel.io_uring_disabled
+    static std::unique_ptr<IoUring> create(unsigned entries);
+
+    ~IoUring();
+
+    IoUring(const IoUring &) = delete;
+
+    IoUring &operator=(const IoUring &) = delete;
+
+    [[nodiscard]] bool supports(std::uint8_t opcode) const { return m_supported.test(opcode); }
+
+    /// Готов к чтению в epoll, когда в очереди завершений есть CQE
+    [[nodiscard]] int fd() const { return m_fd; }
+
+    /// Обнулённый SQE в хвосте очереди отправки, nullptr - очередь заполнена и нужен submit
+    io_uring_sqe *nextSqe();
+
+    /// Отправляет подготовленные SQE и ждёт не меньше waitFor завершений, но не дольше timeout.
+    /// Истечение timeout и прерывание сигналом не считаются ошибкой. Возвращает -errno при ошибке
+    int submit(unsigned waitFor = 0, std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+
+    /// Разбирает все готовые CQE
+    template<typename Handler>
+    unsigned forEachCompletion(Handler &&handler) {
+        const unsigned tail = std::atomic_ref{*m_cqTail}.load(std::memory_order_acquire);
+        unsigned head = *m_cqHead;
+        const unsigned count = tail - head;
+        for (; head != tail; ++head) {
+            handler(m_cqes[head & m_cqMask]);
+        }
+        std::atomic_ref{*m_cqHead}.store(head, std::memory_order_release);
+        return count;
+    }
+
+    /// Регистрирует в ядре кольцо из count (степень двойки) буферов по size байт для IOSQE_BUFFER_SELECT
+    /// с группой group. Ядро само выбирает свободный буфер под каждое завершение
+    bool registerBufferRing(std::uint16_t group, std::uint16_t count, std::uint32_t size);
+
+    [[nodiscard]] char *buffer(const std::uint16_t id) const { return m_buffers + std::size_t{id} * m_bufferSize; }
+
+    /// Возвращает прочитанный буфер в кольцо
+    void recycleBuffer(std::uint16_t id);
+
+private:
+    IoUring() = default;
+
+    bool map(const io_uring_params &params);
+
+    int m_fd = -1;
+
+    void *m_sqRing = nullptr;
+    std::size_t m_sqRingSize = 0;
+    void *m_cqRing = nullptr;
+    std::size_t m_cqRingSize = 0;
+    io_uring_sqe *m_sqes = nullptr;
+    std::size_t m_sqesSize = 0;
+
+    unsigned *m_sqHead = nullptr;
+    unsigned *m_sqTail = nullptr;
+    unsigned *m_sqArray = nullptr;
+    unsigned m_sqMask = 0;
+    unsigned m_sqEntries = 0;
+    /// Хвост подготовленных, но ещё не отправленных SQE
+    unsigned m_sqePending = 0;
+
+    unsigned *m_cqHead = nullptr;
+    unsigned *m_cqTail = nullptr;
+    io_uring_cqe *m_cqes = nullptr;
+    unsigned m_cqMask = 0;
+
+    std::bitset<256> m_supported;
+
+    io_uring_buf_ring *m_bufferRing = nullptr;
+    std::size_t m_bufferRingSize = 0;
+    char *m_buffers = nullptr;
+    std::uint32_t m_bufferSize = 0;
+    std::uint16_t m_bufferCount = 0;
+    std::uint16_t m_bufferTail = 0;
+};
@@ -1,26 +1,48 @@
 #include <iostream>
 #include <ostream>
 
+#include "Coalescer/EventCoalescer.h"
+#include "Content/ContentFilter.h"
+#include "Config/ConfigFileWatcher.h"
 #include "Config/YamlConfigLoader.h"
 #include "Daemon/DiskMonitor.h"
 #include "DirectoriesWatcher/DirectoriesWatcher.h"
 #include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Paths/DirectoryRegistry.h"
+#include "Reactor/MainReactor.h"
 #include "SignalHandler/SignalHandler.h"
+#include "Snapshot/SnapshotIndex.h"
+#include "Trace/EventTrace.h"
 
 /// Если задана, программа будет запускаться как программа, а не как демон
 // #define DEBUG_MOD
 
 void onDaemonized() {
+    // Потоки создаются только после демонизации: fork переносит в потомка лишь вызвавший поток
+    MainReactor::create();
+    SignalHandler::instance().start(MainReactor::instance());
     DirectoriesWatcher::create();
-    DirectoriesWatcher::instance().attach(&DiskMonitor::instance());
-    SignalHandler::instance().attach(&DiskMonitor::instance());
+    EventCoalescer::create();
+    ContentFilter::create();
+    ConfigFileWatcher::create();
+    DirectoriesWatcher::instance().attach(&EventCoalescer::instance());
+    EventCoalescer::instance().attach(&ContentFilter::instance());
+    ContentFilter::instance().attach(&DiskMonitor::instance());
+    // Сигналы идут через те же стадии, что и события: StopRequest не обгоняет ожидающие в них события
+    SignalHandler::instance().attach(&EventCoalescer::instance());
+    ConfigFileWatcher::instance().attach(&DiskMonitor::instance());
 
-    DiskMonitor::instance().put(std::make_shared<ReloadConfigRequest>());
+    DiskMonitor::instance().put(ReloadConfigRequest{});
 }
 
 bool runDaemon(const std::filesystem::path &configPath) {
     const std::string name = "disk_monitor";
     SystemLogger::create(name);
+    DirectoryRegistry::create();
+    Metrics::create();
+    EventTrace::create();
+    SnapshotIndex::create();
     SignalHandler::create();
 
 #ifndef DEBUG_MOD
@@ -37,9 +59,17 @@ bool runDaemon(const std::filesystem::path &configPath) {
 
 void deleteSingletons() {
     SignalHandler::destroy();
+    ConfigFileWatcher::destroy();
+    DirectoriesWatcher::destroy();
+    EventCoalescer::destroy();
+    ContentFilter::destroy();
+    MainReactor::destroy();
     DiskMonitor::destroy();
+    SnapshotIndex::destroy();
+    EventTrace::destroy();
+    Metrics::destroy();
+    DirectoryRegistry::destroy();
     SystemLogger::destroy();
-    DirectoriesWatcher::destroy();
 }
 
 int main(int argc, char *argv[]) {
@@ -0,0 +1,118 @@
+#include <chrono>
+#include <ctime>
+#include <format>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+
+#include "Journal/JournalReader.h"
+
+namespace {
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " <journal_dir> [--from TIME] [--to TIME] [--prefix DIRECTORY]\n"
+                << "TIME is unix seconds or local time \"YYYY-MM-DD HH:MM:SS\"" << std::endl;
+    }
+
+    std::optional<std::int64_t> parseTime(const std::string &value) {
+        std::tm time{};
+        for (const char *format: {"%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d"}) {
+            time = {};
+            if (const char *end = strptime(value.c_str(), format, &time); end && *end == '\0') {
+                time.tm_isdst = -1;
+                return static_cast<std::int64_t>(std::mktime(&time)) * 1'000'000'000;
+            }
+        }
+        try {
+            std::size_t parsed = 0;
+            const std::int64_t seconds = std::stoll(value, &parsed);
+            if (parsed == value.size()) {
+                return seconds * 1'000'000'000;
+            }
+        } catch (...) {
+        }
+        return std::nullopt;
+    }
+
+    std::string formatTime(const std::int64_t timestampNs) {
+        const std::time_t seconds = timestampNs / 1'000'000'000;
+        std::tm local{};
+        localtime_r(&seconds, &local);
+        char buffer[32];
+        const std::size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+        return std::format("{}.{:06}", std::string_view{buffer, length}, timestampNs % 1'000'000'000 / 1000);
+    }
+
+    const char *actionName(const FileChangedInd::Action action) {
+        switch (action) {
+            case FileChangedInd::Action::CREATED:
+                return "Created";
+            case FileChangedInd::Action::DELETED:
+                return "Deleted";
+            case FileChangedInd::Action::MODIFIED:
+                return "Modified";
+            case FileChangedInd::Action::RENAMED:
+                return "Renamed";
+            case FileChangedInd::Action::MOVED_IN:
+                return "Moved in";
+            case FileChangedInd::Action::MOVED_OUT:
+                return "Moved out";
+            case FileChangedInd::Action::CLOSE_WRITE:
+                return "Closed after write";
+            case FileChangedInd::Action::ATTRIB:
+                return "Attributes changed";
+        }
+        return "Unknown";
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::int64_t from = std::numeric_limits<std::int64_t>::min();
+    std::int64_t to = std::numeric_limits<std::int64_t>::max();
+    std::filesystem::path prefix;
+
+    for (int i = 2; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        const std::string value = argv[++i];
+        if (option == "--from" || option == "--to") {
+            const auto time = parseTime(value);
+            if (!time) {
+                std::cerr << "Invalid time: " << value << std::endl;
+                return EXIT_FAILURE;
+            }
+            (option == "--from" ? from : to) = *time;
+        } else if (option == "--prefix") {
+            prefix = value;
+        } else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const JournalReader reader{argv[1]};
+    std::size_t matched = 0;
+    reader.query(from, to, prefix, [&](const JournalReader::Record &record) {
+        std::cout << formatTime(record.timestampNs) << ' ' << actionName(record.action) << ' ';
+        if (record.previousDirectory) {
+            std::cout << (std::filesystem::path{*record.previousDirectory} / record.previousName).string() << " -> ";
+        }
+        std::cout << (std::filesystem::path{record.directory} / record.fileName).string();
+        if (record.count > 1) {
+            std::cout << " (" << record.count << " events)";
+        }
+        std::cout << '\n';
+        ++matched;
+    });
+    std::cerr << matched << " records" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/// Формат кольца событий в разделяемой памяти. Файл (обычно в /dev/shm) - заголовок размером HEADER_SIZE,
+/// затем область данных из capacity байт (степень двойки). Писатель один - DiskMonitor, читателей сколько угодно,
+/// каждый отображает файл только для чтения и идёт по кольцу со своей скоростью.
+///
+/// Позиции - байтовые смещения от начала записи в кольцо, монотонно растут, в области данных им соответствует
+/// позиция & (capacity - 1). Записи выровнены на 8 байт и не переходят через конец области: хвост, в который
+/// запись не помещается, закрыт записью PADDING_ACTION, а если в нём не помещается даже заголовок - пропускается.
+///
+/// Перед записью в [p, p + n) писатель сдвигает tail за перезаписываемые записи и поднимает reserved до p + n,
+/// после записи - head до p + n. Читатель копирует запись по позиции pos и затем проверяет, что reserved не ушёл
+/// дальше pos + capacity: иначе запись могла быть перезаписана во время чтения, и читатель продолжает с tail.
+/// Пропущенные события видны по разрыву в sequence.
+///
+/// Все числа - в порядке байт хоста
+namespace event_ring {
+    inline constexpr char MAGIC[8] = {'D', 'M', 'R', 'I', 'N', 'G', '1', '\0'};
+    inline constexpr std::uint32_t VERSION = 1;
+    inline constexpr std::uint64_t HEADER_SIZE = 4096;
+
+    /// action записи-заполнителя до конца области данных
+    inline constexpr std::uint8_t PADDING_ACTION = 0xff;
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t headerSize;
+        std::uint64_t capacity;
+        /// Ненулевое - писатель завершился, новых записей не будет. Новый писатель создаёт новый файл
+        std::atomic<std::uint32_t> closed;
+
+        /// Конец последней опубликованной записи
+        alignas(64) std::atomic<std::uint64_t> head;
+        /// sequence записи, которая будет записана по head
+        std::atomic<std::uint64_t> nextSequence;
+        /// Нечётное, пока писатель меняет head и nextSequence: читатель берёт их согласованной парой
+        std::atomic<std::uint64_t> publishVersion;
+        /// Начало самой старой записи, которую ещё можно прочитать
+        std::atomic<std::uint64_t> tail;
+        /// Конец области, которую писатель начал перезаписывать
+        alignas(64) std::atomic<std::uint64_t> reserved;
+        /// Растёт после каждой пачки записей. Читатели ждут его изменения через futex
+        alignas(64) std::atomic<std::uint32_t> wakeCounter;
+    };
+
+    /// За заголовком следует путь длиной pathLength, затем прежний путь длиной previousPathLength (для renamed)
+    struct RecordHeader {
+        /// Номер события, с 0, без пропусков. У заполнителя не используется
+        std::uint64_t sequence;
+        /// Время обработки события, нс с начала эпохи
+        std::int64_t timestampNs;
+        /// Размер записи вместе с заголовком и выравниванием
+        std::uint32_t size;
+        /// Сколько исходных событий объединено в это
+        std::uint32_t count;
+        std::uint16_t pathLength;
+        std::uint16_t previousPathLength;
+        /// Значение FileChangedInd::Action: created, deleted, modified, renamed, moved_in, moved_out,
+        /// close_write, attrib - или PADDING_ACTION
+        std::uint8_t action;
+        std::uint8_t reserved[3];
+    };
+
+    constexpr std::uint64_t alignRecord(const std::uint64_t size) {
+        return (size + 7) & ~std::uint64_t{7};
+    }
+
+    static_assert(sizeof(Header) <= HEADER_SIZE);
+    static_assert(sizeof(RecordHeader) == 32);
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Ring positions are shared between processes");
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "EventRingFormat.h"
+
+namespace event_ring {
+    /// Читатель кольца событий disk_monitor, без зависимостей, кроме этого заголовка и EventRingFormat.h.
+    /// Чтение события - копирование из отображённой памяти, без системных вызовов; системный вызов нужен,
+    /// только чтобы уснуть в wait, когда новых событий нет. Объект используется одним потоком
+    class EventRingReader {
+    public:
+        struct Event {
+            std::uint64_t sequence;
+            std::int64_t timestampNs;
+            std::uint32_t count;
+            /// Значение FileChangedInd::Action, см. RecordHeader::action
+            std::uint8_t action;
+            /// Ссылаются на внутренний буфер читателя и действительны до следующего next
+            std::string_view path;
+            std::string_view previousPath;
+        };
+
+        /// fromOldest - начать с самого старого сохранившегося события, иначе только новые
+        explicit EventRingReader(const std::filesystem::path &path, const bool fromOldest = false) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+            struct stat status{};
+            if (fstat(fd, &status) == 0 && static_cast<std::uint64_t>(status.st_size) > HEADER_SIZE) {
+                m_size = static_cast<std::size_t>(status.st_size);
+                void *address = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+                m_mapping = address == MAP_FAILED ? nullptr : static_cast<const char *>(address);
+            }
+            ::close(fd);
+            if (!m_mapping) {
+                return;
+            }
+
+            m_header = reinterpret_cast<const Header *>(m_mapping);
+            if (std::memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0 || m_header->version != VERSION ||
+                m_header->headerSize + m_header->capacity > m_size ||
+                (m_header->capacity & (m_header->capacity - 1)) != 0) {
+                close();
+                return;
+            }
+            m_data = m_mapping + m_header->headerSize;
+            m_capacity = m_header->capacity;
+            if (fromOldest) {
+                m_position = m_header->tail.load(std::memory_order_acquire);
+                if (m_position == 0) {
+                    m_nextSequence = 0;
+                }
+                return;
+            }
+            // Номер следующей записи нужен, чтобы сосчитать потери, даже если писатель обгонит читателя
+            // до первого прочитанного события
+            while (true) {
+                const std::uint64_t version = m_header->publishVersion.load(std::memory_order_acquire);
+                m_position = m_header->head.load(std::memory_order_relaxed);
+                const std::uint64_t sequence = m_header->nextSequence.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (version % 2 == 0 && m_header->publishVersion.load(std::memory_order_relaxed) == version) {
+                    m_nextSequence = sequence;
+                    return;
+                }
+            }
+        }
+
+        ~EventRingReader() { close(); }
+
+        EventRingReader(const EventRingReader &) = delete;
+
+        EventRingReader &operator=(const EventRingReader &) = delete;
+
+        [[nodiscard]] bool isOpen() const { return m_header != nullptr; }
+
+        /// Писатель завершился: после последнего события ничего не придёт, нужно открыть файл заново
+        [[nodiscard]] bool writerClosed() const { return m_header->closed.load(std::memory_order_acquire) != 0; }
+
+        /// Сколько событий пропущено, потому что писатель обогнал читателя на целое кольцо
+        [[nodiscard]] std::uint64_t lost() const { return m_lost; }
+
+        /// Следующее событие или nullopt, если новых пока нет
+        std::optional<Event> next() {
+            while (true) {
+                const std::uint64_t head = m_header->head.load(std::memory_order_acquire);
+                if (m_position == head) {
+                    return std::nullopt;
+                }
+                if (head - m_position > m_capacity) {
+                    resync();
+                    continue;
+                }
+
+                const std::uint64_t offset = m_position & (m_capacity - 1);
+                if (m_capacity - offset < sizeof(RecordHeader)) {
+                    m_position += m_capacity - offset;
+                    continue;
+                }
+                RecordHeader record;
+                std::memcpy(&record, m_data + offset, sizeof(record));
+                const bool sane = record.size >= sizeof(RecordHeader) && record.size <= m_capacity - offset &&
+                                  sizeof(RecordHeader) + record.pathLength + record.previousPathLength <= record.size;
+                if (sane && record.action != PADDING_ACTION) {
+                    m_buffer.resize(record.pathLength + record.previousPathLength);
+                    std::memcpy(m_buffer.data(), m_data + offset + sizeof(RecordHeader), m_buffer.size());
+                }
+                // Скопированное годно, только если писатель за это время не начал перезаписывать это место
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (!sane || m_header->reserved.load(std::memory_order_relaxed) > m_position + m_capacity) {
+                    resync();
+                    continue;
+                }
+
+                m_position += record.size;
+                if (record.action == PADDING_ACTION) {
+                    continue;
+                }
+                if (m_nextSequence && record.sequence > *m_nextSequence) {
+                    m_lost += record.sequence - *m_nextSequence;
+                }
+                m_nextSequence = record.sequence + 1;
+                return Event{record.sequence, record.timestampNs, record.count, record.action,
+                             {m_buffer.data(), record.pathLength},
+                             {m_buffer.data() + record.pathLength, record.previousPathLength}};
+            }
+        }
+
+        /// Ждёт новых событий не дольше timeout. false - за это время ничего не пришло
+        bool wait(const std::chrono::milliseconds timeout) const {
+            const std::uint32_t counter = m_header->wakeCounter.load(std::memory_order_acquire);
+            if (m_header->head.load(std::memory_order_acquire) != m_position || writerClosed()) {
+                return true;
+            }
+            const timespec ts{static_cast<time_t>(timeout.count() / 1000),
+                              static_cast<long>(timeout.count() % 1000 * 1000000)};
+            // Без FUTEX_PRIVATE_FLAG: будит другой процесс через общую страницу
+            syscall(SYS_futex, &m_header->wakeCounter, FUTEX_WAIT, counter, &ts, nullptr, 0);
+            return m_header->head.load(std::memory_order_acquire) != m_position;
+        }
+
+    private:
+        /// Читатель отстал на целое кольцо: продолжает с самой старой сохранившейся записи
+        void resync() {
+            m_position = m_header->tail.load(std::memory_order_acquire);
+        }
+
+        void close() {
+            if (m_mapping) {
+                munmap(const_cast<char *>(m_mapping), m_size);
+            }
+            m_mapping = nullptr;
+            m_header = nullptr;
+        }
+
+        const char *m_mapping = nullptr;
+        std::size_t m_size = 0;
+        const Header *m_header = nullptr;
+        const char *m_data = nullptr;
+        std::uint64_t m_capacity = 0;
+        std::uint64_t m_position = 0;
+        std::optional<std::uint64_t> m_nextSequence;
+        std::uint64_t m_lost = 0;
+        std::vector<char> m_buffer;
+    };
+}
@@ -0,0 +1,71 @@
+#include <array>
+#include <iostream>
+#include <string_view>
+#include <thread>
+
+#include <disk_monitor/EventRingReader.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+    constexpr std::array<std::string_view, 8> ACTION_NAMES = {
+        "created", "deleted", "modified", "renamed", "moved_in", "moved_out", "close_write", "attrib",
+    };
+
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " <ring file> [--from-oldest]" << std::endl;
+    }
+}
+
+/// Печатает события из кольца по мере поступления. Пример потребителя event_ring::EventRingReader
+int main(int argc, char *argv[]) {
+    if (argc < 2 || argc > 3 || (argc == 3 && std::string_view{argv[2]} != "--from-oldest")) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    bool fromOldest = argc == 3;
+
+    while (true) {
+        event_ring::EventRingReader reader{argv[1], fromOldest};
+        if (!reader.isOpen()) {
+            if (!fromOldest) {
+                std::cerr << "Cannot open event ring " << argv[1] << std::endl;
+                return EXIT_FAILURE;
+            }
+            // Кольцо ещё не создано заново
+            std::this_thread::sleep_for(500ms);
+            continue;
+        }
+
+        std::uint64_t reportedLost = 0;
+        while (true) {
+            // closed проверяется до чтения: записи, сделанные до закрытия, ещё будут прочитаны
+            const bool closed = reader.writerClosed();
+            while (const auto event = reader.next()) {
+                if (reader.lost() != reportedLost) {
+                    std::cout << "... " << reader.lost() - reportedLost << " events lost\n";
+                    reportedLost = reader.lost();
+                }
+                std::cout << event->sequence << ' '
+                        << (event->action < ACTION_NAMES.size() ? ACTION_NAMES[event->action] : "unknown") << ' ';
+                if (!event->previousPath.empty()) {
+                    std::cout << event->previousPath << " -> ";
+                }
+                std::cout << event->path;
+                if (event->count > 1) {
+                    std::cout << " (" << event->count << " events)";
+                }
+                std::cout << '\n';
+            }
+            std::cout.flush();
+            if (closed) {
+                break;
+            }
+            reader.wait(1000ms);
+        }
+
+        // Монитор перезапущен или перечитал конфиг: новое кольцо читается с начала
+        std::cerr << "Event ring closed, reopening" << std::endl;
+        fromOldest = true;
+    }
+}
@@ -0,0 +1,100 @@
+#include <chrono>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Paths/DirectoryRegistry.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    class DirectoryRegistryTest : public testing::Test {
+    protected:
+        void TearDown() override {
+            DirectoryRegistry::destroy();
+        }
+    };
+}
+
+TEST_F(DirectoryRegistryTest, InternIsStableWhileReferenced) {
+    auto &registry = DirectoryRegistry::create();
+    const auto root = registry.intern(std::filesystem::path{"/data"});
+    const auto logs = registry.intern(root, "logs");
+    EXPECT_EQ(registry.intern(root, "logs"), logs);
+    EXPECT_EQ(registry.find(root, "logs"), logs);
+    EXPECT_FALSE(registry.find(root, "cache"));
+    EXPECT_EQ(registry.path(logs), "/data/logs");
+    EXPECT_TRUE(registry.isWithin(logs, root));
+
+    // Вторая ссылка от повторного intern держит запись
+    registry.release(logs);
+    EXPECT_EQ(registry.find(root, "logs"), logs);
+    registry.release(logs);
+    EXPECT_FALSE(registry.find(root, "logs"));
+}
+
+TEST_F(DirectoryRegistryTest, ChildKeepsParentAlive) {
+    auto &registry = DirectoryRegistry::create();
+    const auto root = registry.intern(std::filesystem::path{"/data"});
+    const auto logs = registry.intern(root, "logs");
+    registry.release(root);
+    EXPECT_EQ(registry.find(DirectoryRegistry::NO_PARENT, "/data"), root);
+    EXPECT_EQ(registry.path(logs), "/data/logs");
+
+    registry.release(logs);
+    EXPECT_FALSE(registry.find(root, "logs"));
+    EXPECT_FALSE(registry.find(DirectoryRegistry::NO_PARENT, "/data"));
+}
+
+TEST_F(DirectoryRegistryTest, ReleasedIdIsReusedOnlyAfterDelay) {
+    auto &registry = DirectoryRegistry::create(1h);
+    const auto root = registry.intern(std::filesystem::path{"/data"});
+    const auto old = registry.intern(root, "old");
+    registry.release(old);
+    // Сообщения с прежним идентификатором ещё в пути и должны находить свой путь
+    const auto fresh = registry.intern(root, "new");
+    EXPECT_NE(fresh, old);
+    EXPECT_EQ(registry.path(old), "/data/old");
+}
+
+TEST_F(DirectoryRegistryTest, ReusedIdGetsNewGeneration) {
+    auto &registry = DirectoryRegistry::create(0ms);
+    const auto root = registry.intern(std::filesystem::path{"/data"});
+    const auto old = registry.intern(root, "old");
+    const auto generation = registry.generation(old);
+    registry.release(old);
+
+    const auto fresh = registry.intern(root, "new");
+    EXPECT_EQ(fresh, old);
+    EXPECT_NE(registry.generation(fresh), generation);
+    EXPECT_EQ(registry.path(fresh), "/data/new");
+    EXPECT_FALSE(registry.find(root, "old"));
+}
+
+TEST_F(DirectoryRegistryTest, ReleaseKeepsOtherEntriesFindable) {
+    auto &registry = DirectoryRegistry::create(0ms);
+    const auto root = registry.intern(std::filesystem::path{"/data"});
+    // Больше MIN_SLOTS: таблица растёт, а удаления сдвигают записи в цепочках пробирования
+    std::vector<DirectoryRegistry::Id> ids;
+    for (int i = 0; i < 5000; ++i) {
+        ids.push_back(registry.intern(root, "dir" + std::to_string(i)));
+    }
+    for (int i = 0; i < 5000; i += 3) {
+        registry.release(ids[i]);
+    }
+    for (int i = 0; i < 5000; ++i) {
+        const auto found = registry.find(root, "dir" + std::to_string(i));
+        if (i % 3 == 0) {
+            EXPECT_FALSE(found) << i;
+        } else {
+            EXPECT_EQ(found, ids[i]) << i;
+        }
+    }
+
+    // Освобождённые идентификаторы достаются новым директориям, а не наращивают таблицу
+    for (int i = 0; i < 5000; i += 3) {
+        const auto id = registry.intern(root, "again" + std::to_string(i));
+        EXPECT_LT(id, ids.back() + 1);
+        EXPECT_EQ(registry.path(id), "/data/again" + std::to_string(i));
+    }
+}
@@ -0,0 +1,61 @@
+#include <optional>
+#include <gtest/gtest.h>
+
+#include "Coalescer/EventCoalescer.h"
+
+namespace {
+    using Action = FileChangedInd::Action;
+
+    std::optional<Action> merge(const std::optional<Action> current, const Action next) {
+        return EventCoalescer::merge(current, next);
+    }
+}
+
+TEST(EventCoalescerMerge, FirstEventIsKept) {
+    for (const auto action: {Action::CREATED, Action::DELETED, Action::MODIFIED, Action::MOVED_IN,
+                             Action::MOVED_OUT, Action::CLOSE_WRITE, Action::ATTRIB}) {
+        EXPECT_EQ(merge(std::nullopt, action), action);
+    }
+}
+
+TEST(EventCoalescerMerge, AppearedAndVanishedCancelOut) {
+    EXPECT_EQ(merge(Action::CREATED, Action::DELETED), std::nullopt);
+    EXPECT_EQ(merge(Action::CREATED, Action::MOVED_OUT), std::nullopt);
+    EXPECT_EQ(merge(Action::MOVED_IN, Action::DELETED), std::nullopt);
+}
+
+TEST(EventCoalescerMerge, ChangesOfNewFileStayCreation) {
+    EXPECT_EQ(merge(Action::CREATED, Action::MODIFIED), Action::CREATED);
+    EXPECT_EQ(merge(Action::CREATED, Action::CLOSE_WRITE), Action::CREATED);
+    EXPECT_EQ(merge(Action::MOVED_IN, Action::ATTRIB), Action::MOVED_IN);
+}
+
+TEST(EventCoalescerMerge, RecreatedFileIsModification) {
+    EXPECT_EQ(merge(Action::DELETED, Action::CREATED), Action::MODIFIED);
+    EXPECT_EQ(merge(Action::MOVED_OUT, Action::MOVED_IN), Action::MODIFIED);
+    EXPECT_EQ(merge(Action::DELETED, Action::DELETED), Action::DELETED);
+}
+
+TEST(EventCoalescerMerge, RemovalOverridesChanges) {
+    EXPECT_EQ(merge(Action::MODIFIED, Action::DELETED), Action::DELETED);
+    EXPECT_EQ(merge(Action::ATTRIB, Action::MOVED_OUT), Action::MOVED_OUT);
+    EXPECT_EQ(merge(Action::CLOSE_WRITE, Action::DELETED), Action::DELETED);
+}
+
+TEST(EventCoalescerMerge, MostSignificantChangeWins) {
+    EXPECT_EQ(merge(Action::ATTRIB, Action::MODIFIED), Action::MODIFIED);
+    EXPECT_EQ(merge(Action::MODIFIED, Action::ATTRIB), Action::MODIFIED);
+    EXPECT_EQ(merge(Action::MODIFIED, Action::CLOSE_WRITE), Action::CLOSE_WRITE);
+    EXPECT_EQ(merge(Action::CLOSE_WRITE, Action::MODIFIED), Action::CLOSE_WRITE);
+    EXPECT_EQ(merge(Action::ATTRIB, Action::ATTRIB), Action::ATTRIB);
+}
+
+TEST(EventCoalescerMerge, ChainsLikeWindow) {
+    // Создан, записан, удалён и снова создан за одно окно
+    std::optional<Action> action;
+    for (const auto next: {Action::CREATED, Action::MODIFIED, Action::CLOSE_WRITE, Action::DELETED}) {
+        action = merge(action, next);
+    }
+    EXPECT_EQ(action, std::nullopt);
+    EXPECT_EQ(merge(action, Action::CREATED), Action::CREATED);
+}
@@ -0,0 +1,217 @@
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Queue/MpscRingQueue.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    std::vector<int> drain(MpscRingQueue<int> &queue) {
+        std::vector<int> values;
+        while (queue.tryPopBatch(values, 1024)) {
+        }
+        return values;
+    }
+}
+
+TEST(MpscRingQueue, CapacityIsRoundedUpToPowerOfTwo) {
+    EXPECT_EQ(MpscRingQueue<int>{5}.capacity(), 8u);
+    EXPECT_EQ(MpscRingQueue<int>{8}.capacity(), 8u);
+    EXPECT_EQ(MpscRingQueue<int>{0}.capacity(), 2u);
+}
+
+TEST(MpscRingQueue, KeepsOrderAcrossWraparound) {
+    MpscRingQueue<int> queue{4};
+    int next = 0;
+    int expected = 0;
+    // Позиции много раз проходят через конец кольца, очередь то полная, то пустая
+    for (int round = 0; round < 100; ++round) {
+        const int pushes = round % 4 + 1;
+        for (int i = 0; i < pushes; ++i) {
+            ASSERT_TRUE(queue.push(next++));
+        }
+        for (int i = 0; i < pushes; ++i) {
+            int value = -1;
+            ASSERT_TRUE(queue.try_pop(value));
+            EXPECT_EQ(value, expected++);
+        }
+        int value;
+        EXPECT_FALSE(queue.try_pop(value));
+    }
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(MpscRingQueue, DropNewestRejectsAndCounts) {
+    MpscRingQueue<int> queue{4, OverflowPolicy::DROP_NEWEST};
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_EQ(queue.push(i), i < 4);
+    }
+    EXPECT_EQ(queue.droppedNewest(), 3u);
+    EXPECT_EQ(queue.droppedOldest(), 0u);
+    EXPECT_EQ(drain(queue), (std::vector{0, 1, 2, 3}));
+}
+
+TEST(MpscRingQueue, DropOldestEvictsAndCounts) {
+    MpscRingQueue<int> queue{4, OverflowPolicy::DROP_OLDEST};
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    EXPECT_EQ(queue.droppedOldest(), 3u);
+    EXPECT_EQ(queue.droppedNewest(), 0u);
+    EXPECT_EQ(drain(queue), (std::vector{3, 4, 5, 6}));
+}
+
+TEST(MpscRingQueue, DropOldestKeepsPinnedElements) {
+    // Отрицательные - управляющие, их вытеснять нельзя
+    MpscRingQueue<int> queue{4, OverflowPolicy::DROP_OLDEST, [](const int &value) { return value >= 0; }};
+    EXPECT_TRUE(queue.push(-1));
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(queue.push(i));
+    }
+    // Самый старый закреплён: новые отбрасываются, пока его не заберут
+    EXPECT_FALSE(queue.push(3));
+    EXPECT_EQ(queue.pushBatch(std::vector{4, 5}), 0u);
+    EXPECT_EQ(queue.droppedNewest(), 3u);
+    EXPECT_EQ(queue.droppedOldest(), 0u);
+
+    int value = 0;
+    ASSERT_TRUE(queue.try_pop(value));
+    EXPECT_EQ(value, -1);
+    EXPECT_TRUE(queue.push(-2));
+    // Теперь вытесняются обычные элементы перед закреплённым, а дальше снова отбрасываются новые
+    EXPECT_TRUE(queue.push(6));
+    EXPECT_TRUE(queue.push(7));
+    EXPECT_TRUE(queue.push(8));
+    EXPECT_FALSE(queue.push(9));
+    EXPECT_EQ(queue.droppedOldest(), 3u);
+    EXPECT_EQ(drain(queue), (std::vector{-2, 6, 7, 8}));
+}
+
+TEST(MpscRingQueue, PolicyCanBeChanged) {
+    MpscRingQueue<int> queue{2};
+    queue.setOverflowPolicy(OverflowPolicy::DROP_NEWEST);
+    EXPECT_TRUE(queue.push(1));
+    EXPECT_TRUE(queue.push(2));
+    EXPECT_FALSE(queue.push(3));
+    // Явная политика сильнее установленной
+    queue.setOverflowPolicy(OverflowPolicy::BLOCK);
+    EXPECT_TRUE(queue.push(4, OverflowPolicy::DROP_OLDEST));
+    EXPECT_EQ(drain(queue), (std::vector{2, 4}));
+}
+
+TEST(MpscRingQueue, BlockWaitsForSpace) {
+    MpscRingQueue<int> queue{2};
+    ASSERT_TRUE(queue.push(0));
+    ASSERT_TRUE(queue.push(1));
+    auto producer = std::async(std::launch::async, [&] { return queue.push(2); });
+    EXPECT_EQ(producer.wait_for(50ms), std::future_status::timeout);
+
+    // Производителей будят, когда освободилась половина очереди
+    EXPECT_EQ(queue.pop(), 0);
+    ASSERT_EQ(producer.wait_for(5s), std::future_status::ready);
+    EXPECT_TRUE(producer.get());
+    EXPECT_EQ(drain(queue), (std::vector{1, 2}));
+}
+
+TEST(MpscRingQueue, PushBatchAndPopBatch) {
+    MpscRingQueue<int> queue{16};
+    const std::vector values{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    EXPECT_EQ(queue.pushBatch(values), values.size());
+    EXPECT_EQ(queue.size(), values.size());
+
+    std::vector<int> out;
+    EXPECT_EQ(queue.popBatch(out, 4), 4u);
+    EXPECT_EQ(out, (std::vector{0, 1, 2, 3}));
+    EXPECT_EQ(queue.tryPopBatch(out, 100), 6u);
+    EXPECT_EQ(out, values);
+    EXPECT_EQ(queue.tryPopBatch(out, 100), 0u);
+}
+
+TEST(MpscRingQueue, PushBatchHonoursOverflowPolicy) {
+    MpscRingQueue<int> newest{4, OverflowPolicy::DROP_NEWEST};
+    EXPECT_EQ(newest.pushBatch(std::vector{0, 1, 2, 3, 4, 5}), 4u);
+    EXPECT_EQ(newest.droppedNewest(), 2u);
+    EXPECT_EQ(drain(newest), (std::vector{0, 1, 2, 3}));
+
+    MpscRingQueue<int> oldest{4, OverflowPolicy::DROP_OLDEST};
+    EXPECT_EQ(oldest.pushBatch(std::vector{0, 1, 2, 3, 4, 5}), 6u);
+    EXPECT_EQ(oldest.droppedOldest(), 2u);
+    EXPECT_EQ(drain(oldest), (std::vector{2, 3, 4, 5}));
+}
+
+TEST(MpscRingQueue, CloseReleasesBlockedProducers) {
+    MpscRingQueue<int> queue{2};
+    ASSERT_TRUE(queue.push(0));
+    ASSERT_TRUE(queue.push(1));
+    auto single = std::async(std::launch::async, [&] { return queue.push(2); });
+    auto batch = std::async(std::launch::async, [&] { return queue.pushBatch(std::vector{3, 4, 5}); });
+    EXPECT_EQ(single.wait_for(50ms), std::future_status::timeout);
+    EXPECT_EQ(batch.wait_for(0ms), std::future_status::timeout);
+
+    queue.close();
+    ASSERT_EQ(single.wait_for(5s), std::future_status::ready);
+    ASSERT_EQ(batch.wait_for(5s), std::future_status::ready);
+    EXPECT_FALSE(single.get());
+    EXPECT_EQ(batch.get(), 0u);
+    EXPECT_EQ(queue.droppedNewest(), 4u);
+
+    // Закрытая очередь отказывает и при свободном месте, но уже положенное можно дочитать
+    EXPECT_EQ(drain(queue), (std::vector{0, 1}));
+    EXPECT_FALSE(queue.push(6));
+    EXPECT_EQ(queue.pushBatch(std::vector{7, 8}), 0u);
+    EXPECT_EQ(queue.droppedNewest(), 7u);
+
+    queue.open();
+    EXPECT_TRUE(queue.push(9));
+    EXPECT_EQ(drain(queue), (std::vector{9}));
+}
+
+TEST(MpscRingQueue, ManyProducersOneConsumer) {
+    constexpr std::uint64_t PRODUCERS = 4;
+    constexpr std::uint64_t PER_PRODUCER = 100'000;
+    MpscRingQueue<std::uint64_t> queue{256};
+
+    std::vector<std::thread> producers;
+    for (std::uint64_t producer = 0; producer < PRODUCERS; ++producer) {
+        producers.emplace_back([&, producer] {
+            std::vector<std::uint64_t> batch;
+            for (std::uint64_t i = 0; i < PER_PRODUCER; ++i) {
+                const auto value = producer << 32 | i;
+                // Половина через push, половина пачками: оба пути конкурируют за одни ячейки
+                if (producer % 2) {
+                    queue.push(value);
+                    continue;
+                }
+                batch.push_back(value);
+                if (batch.size() == 64 || i + 1 == PER_PRODUCER) {
+                    queue.pushBatch(batch);
+                    batch.clear();
+                }
+            }
+        });
+    }
+
+    std::vector<std::uint64_t> next(PRODUCERS, 0);
+    std::vector<std::uint64_t> out;
+    std::uint64_t received = 0;
+    while (received < PRODUCERS * PER_PRODUCER) {
+        out.clear();
+        received += queue.popBatch(out, 128);
+        for (const auto value: out) {
+            const auto producer = value >> 32;
+            ASSERT_LT(producer, PRODUCERS);
+            // Порядок каждого производителя сохраняется
+            ASSERT_EQ(value & 0xffffffff, next[producer]++);
+        }
+    }
+    for (auto &producer: producers) {
+        producer.join();
+    }
+    EXPECT_EQ(next, std::vector<std::uint64_t>(PRODUCERS, PER_PRODUCER));
+    EXPECT_EQ(queue.droppedNewest() + queue.droppedOldest(), 0u);
+    EXPECT_EQ(queue.size(), 0u);
+}
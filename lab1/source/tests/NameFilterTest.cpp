@@ -0,0 +1,145 @@
+#include <optional>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "Filter/NameFilter.h"
+
+namespace {
+    using Patterns = std::vector<NameFilter::Pattern>;
+
+    NameFilter compile(const Patterns &include, const Patterns &exclude = {}) {
+        std::string error;
+        auto filter = NameFilter::compile(include, exclude, error);
+        EXPECT_TRUE(filter) << error;
+        return filter ? std::move(*filter) : *NameFilter::compile({}, {}, error);
+    }
+
+    /// Файлы, подходящие под единственный include
+    bool matches(const NameFilter::Pattern &pattern, const std::string &name) {
+        return compile({pattern}).accepts(name, false);
+    }
+
+    NameFilter::Pattern glob(std::string text) {
+        return {std::move(text), false};
+    }
+
+    NameFilter::Pattern regex(std::string text) {
+        return {std::move(text), true};
+    }
+}
+
+TEST(NameFilter, GlobStarAndQuestionMark) {
+    EXPECT_TRUE(matches(glob("*.log"), "app.log"));
+    EXPECT_TRUE(matches(glob("*.log"), ".log"));
+    EXPECT_FALSE(matches(glob("*.log"), "app.log.1"));
+    EXPECT_TRUE(matches(glob("a*b*c"), "abc"));
+    EXPECT_TRUE(matches(glob("a*b*c"), "a-b-b-c"));
+    EXPECT_FALSE(matches(glob("a*b*c"), "a-c"));
+
+    EXPECT_TRUE(matches(glob("file?.txt"), "file1.txt"));
+    EXPECT_FALSE(matches(glob("file?.txt"), "file.txt"));
+    EXPECT_FALSE(matches(glob("file?.txt"), "file12.txt"));
+}
+
+TEST(NameFilter, GlobClasses) {
+    EXPECT_TRUE(matches(glob("[a-c]x"), "bx"));
+    EXPECT_FALSE(matches(glob("[a-c]x"), "dx"));
+
+    EXPECT_FALSE(matches(glob("[!a-c]x"), "ax"));
+    EXPECT_FALSE(matches(glob("[!a-c]x"), "cx"));
+    EXPECT_TRUE(matches(glob("[!a-c]x"), "dx"));
+    EXPECT_TRUE(matches(glob("[!a-c]x"), "-x"));
+
+    // ] первым символом - литерал
+    EXPECT_TRUE(matches(glob("[]]"), "]"));
+    EXPECT_FALSE(matches(glob("[]]"), "["));
+    EXPECT_TRUE(matches(glob("[]a]"), "a"));
+    EXPECT_TRUE(matches(glob("[!]]"), "a"));
+    EXPECT_FALSE(matches(glob("[!]]"), "]"));
+
+    EXPECT_TRUE(matches(glob("\\*"), "*"));
+    EXPECT_FALSE(matches(glob("\\*"), "a"));
+}
+
+TEST(NameFilter, RegexOperators) {
+    EXPECT_TRUE(matches(regex("cat|dog"), "cat"));
+    EXPECT_TRUE(matches(regex("cat|dog"), "dog"));
+    EXPECT_FALSE(matches(regex("cat|dog"), "cow"));
+    EXPECT_TRUE(matches(regex("(ab|cd)+x"), "abcdabx"));
+
+    EXPECT_TRUE(matches(regex("a+b"), "aaab"));
+    EXPECT_FALSE(matches(regex("a+b"), "b"));
+    EXPECT_TRUE(matches(regex("colou?r"), "color"));
+    EXPECT_TRUE(matches(regex("colou?r"), "colour"));
+    EXPECT_FALSE(matches(regex("colou?r"), "colouur"));
+
+    EXPECT_TRUE(matches(regex("\\d+\\.\\w+"), "2024.log"));
+    EXPECT_FALSE(matches(regex("\\d+\\.\\w+"), "x2024.log"));
+    EXPECT_TRUE(matches(regex("a.c"), "abc"));
+    EXPECT_FALSE(matches(regex("a.c"), "ac"));
+}
+
+TEST(NameFilter, RegexAnchorsAndFullMatch) {
+    // Шаблон всегда совпадает с именем целиком, якоря по краям ничего не меняют
+    for (const auto *text: {"abc", "^abc", "abc$", "^abc$"}) {
+        EXPECT_TRUE(matches(regex(text), "abc")) << text;
+        EXPECT_FALSE(matches(regex(text), "xabc")) << text;
+        EXPECT_FALSE(matches(regex(text), "abcx")) << text;
+    }
+}
+
+TEST(NameFilter, RegexEscapedTrailingDollar) {
+    EXPECT_TRUE(matches(regex("price\\$"), "price$"));
+    EXPECT_FALSE(matches(regex("price\\$"), "price"));
+    // Экранирована косая, $ остаётся якорем
+    EXPECT_TRUE(matches(regex("dir\\\\$"), "dir\\"));
+    EXPECT_FALSE(matches(regex("dir\\\\$"), "dir\\$"));
+}
+
+TEST(NameFilter, ExcludeWinsOverInclude) {
+    const auto filter = compile({glob("*.log")}, {glob("debug*")});
+    EXPECT_TRUE(filter.accepts("app.log", false));
+    EXPECT_FALSE(filter.accepts("debug.log", false));
+    EXPECT_FALSE(filter.accepts("app.txt", false));
+}
+
+TEST(NameFilter, DirectoriesBypassInclude) {
+    const auto filter = compile({glob("*.log")}, {glob("tmp")});
+    EXPECT_TRUE(filter.accepts("src", true));
+    EXPECT_FALSE(filter.accepts("src", false));
+    // exclude действует и на директории
+    EXPECT_FALSE(filter.accepts("tmp", true));
+}
+
+TEST(NameFilter, ExcludeOnlyAcceptsEverythingElse) {
+    const auto filter = compile({}, {regex(".*\\.swp"), glob("~*")});
+    EXPECT_TRUE(filter.accepts("notes.txt", false));
+    EXPECT_FALSE(filter.accepts(".notes.txt.swp", false));
+    EXPECT_FALSE(filter.accepts("~lock", false));
+}
+
+TEST(NameFilter, RejectsInvalidPatterns) {
+    std::string error;
+    EXPECT_FALSE(NameFilter::compile({glob("[abc")}, {}, error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_FALSE(NameFilter::compile({regex("(ab")}, {}, error));
+    EXPECT_FALSE(NameFilter::compile({regex("ab)")}, {}, error));
+    EXPECT_FALSE(NameFilter::compile({glob("[z-a]")}, {}, error));
+}
+
+TEST(NameFilter, RejectsTooManyStates) {
+    // Детерминированный автомат для "a за 13 символов от конца" помнит последние 13 символов: 2^13 состояний
+    std::string text = "[ab]*a";
+    for (int i = 0; i < 13; ++i) {
+        text += "[ab]";
+    }
+    std::string error;
+    EXPECT_FALSE(NameFilter::compile({regex(text)}, {}, error));
+    EXPECT_NE(error.find(std::to_string(NameFilter::MAX_STATES)), std::string::npos) << error;
+
+    const auto small = compile({regex("[ab]*a[ab][ab]")});
+    EXPECT_LE(small.states(), NameFilter::MAX_STATES);
+    EXPECT_TRUE(small.accepts("bbabb", false));
+    EXPECT_FALSE(small.accepts("bbbab", false));
+}
@@ -0,0 +1,62 @@
+#include <string>
+#include <gtest/gtest.h>
+
+#include "RateLimit/SpaceSaving.h"
+
+TEST(SpaceSaving, CountsExactlyWithinCapacity) {
+    SpaceSaving counter{4};
+    counter.add("a", 3);
+    counter.add("b");
+    counter.add("a");
+    counter.add("c", 2);
+
+    const auto top = counter.top(10);
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_EQ(top[0].key, "a");
+    EXPECT_EQ(top[0].count, 4u);
+    EXPECT_EQ(top[1].key, "c");
+    EXPECT_EQ(top[2].key, "b");
+    for (const auto &entry: top) {
+        EXPECT_EQ(entry.error, 0u);
+    }
+    EXPECT_EQ(counter.top(1).size(), 1u);
+}
+
+TEST(SpaceSaving, NewKeyReplacesRarestAndInheritsItsCount) {
+    SpaceSaving counter{2};
+    counter.add("a", 5);
+    counter.add("b", 2);
+    counter.add("c");
+
+    const auto top = counter.top(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0].key, "a");
+    EXPECT_EQ(top[1].key, "c");
+    EXPECT_EQ(top[1].count, 3u);
+    EXPECT_EQ(top[1].error, 2u);
+}
+
+TEST(SpaceSaving, KeepsHeavyHittersWithBoundedError) {
+    constexpr std::size_t CAPACITY = 8;
+    SpaceSaving counter{CAPACITY};
+    std::uint64_t total = 0;
+    // Два частых ключа среди потока уникальных
+    for (int i = 0; i < 1000; ++i) {
+        counter.add("hot");
+        counter.add("warm", i % 2);
+        counter.add("noise" + std::to_string(i));
+        total += 2 + i % 2;
+    }
+
+    const auto top = counter.top(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0].key, "hot");
+    EXPECT_EQ(top[1].key, "warm");
+    for (const auto &entry: top) {
+        // count завышен не больше чем на error, error не больше N / capacity
+        const std::uint64_t real = entry.key == "hot" ? 1000 : 500;
+        EXPECT_GE(entry.count, real);
+        EXPECT_LE(entry.count - entry.error, real);
+        EXPECT_LE(entry.error, total / CAPACITY);
+    }
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "DirectoriesWatcher/WatchIndex.h"
+
+TEST(WatchIndex, AddAndFind) {
+    WatchIndex index;
+    EXPECT_TRUE(index.add(1, 10, true, 1));
+    EXPECT_TRUE(index.add(5, 50, false, 1));
+    // Тот же wd inotify возвращает для уже наблюдаемой директории
+    EXPECT_FALSE(index.add(1, 11, false, 1));
+    EXPECT_FALSE(index.add(-1, 0, false, -1));
+
+    // Ещё не опубликованный wd находится через рабочую копию
+    const auto entry = index.find(1);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(entry->directoryId, 10u);
+    EXPECT_TRUE(entry->recursive);
+    EXPECT_EQ(entry->rootWd, 1);
+    EXPECT_EQ(index.findLatest(5)->directoryId, 50u);
+    EXPECT_FALSE(index.find(2));
+    EXPECT_FALSE(index.find(-1));
+    EXPECT_EQ(index.size(), 2u);
+}
+
+TEST(WatchIndex, RemovalIsPublishedForLockFreeFind) {
+    WatchIndex index;
+    index.add(3, 30, false, 3);
+    index.quiescent();
+    ASSERT_TRUE(index.find(3));
+
+    index.remove(3);
+    // Удаление сразу видно под блокировкой, а без неё - после публикации
+    EXPECT_FALSE(index.findLatest(3));
+    index.quiescent();
+    EXPECT_FALSE(index.find(3));
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_TRUE(index.add(3, 31, false, 3));
+    EXPECT_EQ(index.findLatest(3)->directoryId, 31u);
+}
+
+TEST(WatchIndex, UpdateKeepsDirectory) {
+    WatchIndex index;
+    index.add(7, 70, false, 7);
+    index.update(7, true, 2);
+    index.update(8, true, 2);
+    const auto entry = index.findLatest(7);
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(entry->directoryId, 70u);
+    EXPECT_TRUE(entry->recursive);
+    EXPECT_EQ(entry->rootWd, 2);
+    EXPECT_FALSE(index.findLatest(8));
+}
+
+TEST(WatchIndex, SpansChunks) {
+    WatchIndex index;
+    const int wds[] = {1, 1023, 1024, 5000, 70000};
+    for (const int wd: wds) {
+        EXPECT_TRUE(index.add(wd, static_cast<std::uint32_t>(wd) * 2, false, 1));
+    }
+    index.quiescent();
+    for (const int wd: wds) {
+        ASSERT_TRUE(index.find(wd)) << wd;
+        EXPECT_EQ(index.find(wd)->directoryId, static_cast<std::uint32_t>(wd) * 2);
+    }
+    auto descriptors = index.descriptors();
+    std::ranges::sort(descriptors);
+    EXPECT_EQ(descriptors, (std::vector<int>{std::begin(wds), std::end(wds)}));
+
+    index.clear();
+    index.quiescent();
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_FALSE(index.find(5000));
+    EXPECT_TRUE(index.descriptors().empty());
+}
+
+TEST(WatchIndex, ForEachRemovesAndUpdates) {
+    WatchIndex index;
+    for (int wd = 1; wd <= 6; ++wd) {
+        index.add(wd, static_cast<std::uint32_t>(wd), false, 1);
+    }
+    int visited = 0;
+    index.forEach([&visited](const int wd, const WatchIndex::Entry &entry) {
+        ++visited;
+        WatchIndex::Change change;
+        if (wd % 2) {
+            change.remove = true;
+        } else {
+            auto updated = entry;
+            updated.recursive = true;
+            change.update = updated;
+        }
+        return change;
+    });
+    EXPECT_EQ(visited, 6);
+    EXPECT_EQ(index.size(), 3u);
+    index.quiescent();
+    for (int wd = 1; wd <= 6; ++wd) {
+        const auto entry = index.find(wd);
+        EXPECT_EQ(entry.has_value(), wd % 2 == 0) << wd;
+        if (entry) {
+            EXPECT_TRUE(entry->recursive);
+        }
+    }
+}
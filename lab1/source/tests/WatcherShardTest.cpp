@@ -0,0 +1,125 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+#include "DirectoriesWatcher/DirectoriesWatcher.h"
+#include "Logger/SystemLogger.h"
+#include "Metrics/Metrics.h"
+#include "Paths/DirectoryRegistry.h"
+#include "Reactor/MainReactor.h"
+#include "Snapshot/SnapshotIndex.h"
+#include "Trace/EventTrace.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+    struct Recorder : Observer {
+        std::mutex mutex;
+        std::vector<std::pair<std::string, FileChangedInd::Action> > events;
+
+        void put(const Message &message) override {
+            if (const auto *event = std::get_if<FileChangedInd>(&message)) {
+                std::lock_guard lock{mutex};
+                events.emplace_back(event->fileName(), event->action);
+            }
+        }
+
+        /// Действия с файлом name по порядку, когда их наберётся count или выйдет время
+        std::vector<FileChangedInd::Action> actionsOf(const std::string &name, const std::size_t count) {
+            const auto deadline = std::chrono::steady_clock::now() + 2s;
+            while (true) {
+                std::vector<FileChangedInd::Action> actions;
+                {
+                    std::lock_guard lock{mutex};
+                    for (const auto &[fileName, action]: events) {
+                        if (fileName == name) {
+                            actions.push_back(action);
+                        }
+                    }
+                }
+                if (actions.size() >= count || std::chrono::steady_clock::now() > deadline) {
+                    return actions;
+                }
+                std::this_thread::sleep_for(10ms);
+            }
+        }
+    };
+
+    class WatcherShardTest : public testing::Test {
+    protected:
+        void SetUp() override {
+            m_root = std::filesystem::temp_directory_path() / ("disk_monitor_test_" + std::to_string(getpid()));
+            std::filesystem::remove_all(m_root);
+            std::filesystem::create_directories(m_root / "watched");
+            std::filesystem::create_directories(m_root / "archive");
+
+            SystemLogger::create(std::string{"disk_monitor_tests"});
+            DirectoryRegistry::create();
+            Metrics::create();
+            EventTrace::create();
+            SnapshotIndex::create();
+            MainReactor::create();
+            DirectoriesWatcher::create().attach(&m_recorder);
+            DirectoriesWatcher::instance().reloadPaths({{m_root / "watched", false, false, {}, nullptr}});
+        }
+
+        void TearDown() override {
+            DirectoriesWatcher::destroy();
+            MainReactor::destroy();
+            SnapshotIndex::destroy();
+            EventTrace::destroy();
+            Metrics::destroy();
+            DirectoryRegistry::destroy();
+            SystemLogger::destroy();
+            std::filesystem::remove_all(m_root);
+        }
+
+        std::filesystem::path m_root;
+        Recorder m_recorder;
+    };
+}
+
+TEST_F(WatcherShardTest, MovedOutKeepsItsPlaceBeforeRecreation) {
+    using Action = FileChangedInd::Action;
+    std::ofstream{m_root / "watched" / "app.log"};
+    ASSERT_EQ(m_recorder.actionsOf("app.log", 1), std::vector{Action::CREATED});
+
+    // Ротация лога: файл уходит из-под наблюдения, и сразу создаётся новый с тем же именем.
+    // Пары к IN_MOVED_FROM нет, но MOVED_OUT не должен отстать от CREATED нового файла
+    std::filesystem::rename(m_root / "watched" / "app.log", m_root / "archive" / "app.log.1");
+    std::ofstream{m_root / "watched" / "app.log"};
+    EXPECT_EQ(m_recorder.actionsOf("app.log", 3), (std::vector{Action::CREATED, Action::MOVED_OUT, Action::CREATED}));
+}
+
+TEST_F(WatcherShardTest, MovePairBecomesRename) {
+    using Action = FileChangedInd::Action;
+    std::ofstream{m_root / "watched" / "draft"};
+    std::filesystem::rename(m_root / "watched" / "draft", m_root / "watched" / "final");
+    EXPECT_EQ(m_recorder.actionsOf("final", 1), std::vector{Action::RENAMED});
+    EXPECT_EQ(m_recorder.actionsOf("draft", 1), std::vector{Action::CREATED});
+}
+
+TEST_F(WatcherShardTest, SnapshotFollowsEventsWhenEnabled) {
+    WatcherConfig config;
+    config.snapshot = true;
+    DirectoriesWatcher::instance().configure(config);
+    DirectoriesWatcher::instance().reloadPaths({{m_root / "watched", false, false, {}, nullptr}});
+    const auto found = DirectoryRegistry::instance().find(DirectoryRegistry::NO_PARENT,
+                                                          (m_root / "watched").native());
+    ASSERT_TRUE(found.has_value());
+    const auto directoryId = *found;
+    ASSERT_TRUE(SnapshotIndex::instance().contains(directoryId));
+
+    std::ofstream{m_root / "watched" / "data"} << "12345";
+    ASSERT_EQ(m_recorder.actionsOf("data", 2).size(), 2u);
+    SnapshotIndex::instance().sync();
+    const auto attributes = SnapshotIndex::instance().find(directoryId, "data");
+    ASSERT_TRUE(attributes.has_value());
+    EXPECT_EQ(attributes->size, 5u);
+}
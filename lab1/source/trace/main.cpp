@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Trace/TraceFormat.h"
+
+using namespace trace_file;
+
+namespace {
+    void printUsage(const char *program) {
+        std::cerr << "Usage: " << program << " <trace_file> [--slowest N]\n"
+                << "Prints per-stage latency quantiles of traced events and timelines of the N slowest ones"
+                << std::endl;
+    }
+
+    /// Путь одного события, 0 - этап не записан или уже затёрт в кольце
+    struct Timeline {
+        std::array<std::int64_t, STAGES_COUNT> timestampsNs{};
+        std::array<std::uint32_t, STAGES_COUNT> threads{};
+
+        [[nodiscard]] bool has(const Stage stage) const { return timestampsNs[static_cast<std::size_t>(stage)]; }
+
+        [[nodiscard]] std::int64_t at(const Stage stage) const {
+            return timestampsNs[static_cast<std::size_t>(stage)];
+        }
+
+        [[nodiscard]] bool complete() const { return has(Stage::READ) && has(Stage::DONE); }
+
+        [[nodiscard]] std::int64_t total() const { return at(Stage::DONE) - at(Stage::READ); }
+    };
+
+    std::string formatUs(const std::int64_t ns) {
+        return std::format("{:.1f}", static_cast<double>(ns) / 1e3);
+    }
+
+    void printQuantiles(const std::string &name, std::vector<std::int64_t> &values) {
+        if (values.empty()) {
+            return;
+        }
+        std::ranges::sort(values);
+        const auto quantile = [&](const double q) {
+            const auto index = static_cast<std::size_t>(q * static_cast<double>(values.size()));
+            return values[std::min(values.size() - 1, index)];
+        };
+        std::cout << std::format("{:<20} {:>8} {:>10} {:>10} {:>10} {:>10}\n", name, values.size(),
+                                 formatUs(quantile(0.5)), formatUs(quantile(0.9)), formatUs(quantile(0.99)),
+                                 formatUs(values.back()));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::size_t slowest = 10;
+    for (int i = 2; i < argc; ++i) {
+        const std::string option = argv[i];
+        if (option != "--slowest" || i + 1 >= argc) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        try {
+            slowest = std::stoull(argv[++i]);
+        } catch (const std::exception &) {
+            std::cerr << "Invalid value for --slowest: " << argv[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Cannot open " << argv[1] << ": " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    struct stat status{};
+    void *address = MAP_FAILED;
+    if (fstat(fd, &status) == 0 && static_cast<std::uint64_t>(status.st_size) >= HEADER_SIZE) {
+        address = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    const auto *header = static_cast<const Header *>(address);
+    if (address == MAP_FAILED || std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION ||
+        header->headerSize + header->capacity * sizeof(Record) > static_cast<std::uint64_t>(status.st_size)) {
+        std::cerr << argv[1] << " is not a disk_monitor trace file" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Файл может писаться прямо сейчас: запись берётся, только если sequence не изменился за время копирования
+    const auto *records = reinterpret_cast<const Record *>(static_cast<const char *>(address) + header->headerSize);
+    std::unordered_map<std::uint64_t, Timeline> timelines;
+    std::size_t recordsCount = 0;
+    for (std::uint64_t i = 0; i < header->capacity; ++i) {
+        const auto &record = records[i];
+        const auto sequence = record.sequence.load(std::memory_order_acquire);
+        const auto traceId = record.traceId;
+        const auto timestampNs = record.timestampNs;
+        const auto stage = record.stage;
+        const auto thread = record.thread;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!sequence || record.sequence.load(std::memory_order_relaxed) != sequence || stage >= STAGES_COUNT) {
+            continue;
+        }
+        auto &timeline = timelines[traceId];
+        timeline.timestampsNs[stage] = timestampNs;
+        timeline.threads[stage] = thread;
+        ++recordsCount;
+    }
+
+    std::vector<std::pair<std::uint64_t, const Timeline *> > complete;
+    std::array<std::vector<std::int64_t>, STAGES_COUNT> deltas;
+    for (const auto &[traceId, timeline]: timelines) {
+        // Этап считается от предыдущего записанного: LOG есть не у всех событий
+        std::int64_t previous = 0;
+        for (std::size_t stage = 0; stage < STAGES_COUNT; ++stage) {
+            if (!timeline.timestampsNs[stage]) {
+                continue;
+            }
+            if (previous) {
+                deltas[stage].push_back(timeline.timestampsNs[stage] - previous);
+            }
+            previous = timeline.timestampsNs[stage];
+        }
+        if (timeline.complete()) {
+            complete.emplace_back(traceId, &timeline);
+        }
+    }
+
+    std::cout << std::format("{}: every {} event, {} records, {} events, {} complete\n\n", argv[1],
+                             header->sampleEvery, recordsCount, timelines.size(), complete.size());
+    std::cout << std::format("{:<20} {:>8} {:>10} {:>10} {:>10} {:>10}\n", "stage, us", "count", "p50", "p90",
+                             "p99", "max");
+    for (std::size_t stage = 1; stage < STAGES_COUNT; ++stage) {
+        printQuantiles(std::string{"-> "} + std::string{STAGE_NAMES[stage]}, deltas[stage]);
+    }
+    std::vector<std::int64_t> totals;
+    for (const auto &[traceId, timeline]: complete) {
+        totals.push_back(timeline->total());
+    }
+    printQuantiles("read -> done", totals);
+
+    std::ranges::sort(complete, [](const auto &left, const auto &right) {
+        return left.second->total() > right.second->total();
+    });
+    complete.resize(std::min(complete.size(), slowest));
+    for (const auto &[traceId, timeline]: complete) {
+        std::cout << std::format("\nEvent {}: {} us\n", traceId, formatUs(timeline->total()));
+        for (std::size_t stage = 0; stage < STAGES_COUNT; ++stage) {
+            if (timeline->timestampsNs[stage]) {
+                std::cout << std::format("  {:<8} {:>11} us  thread {}\n", STAGE_NAMES[stage],
+                                         "+" + formatUs(timeline->timestampsNs[stage] - timeline->at(Stage::READ)),
+                                         timeline->threads[stage]);
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}